@@ -0,0 +1,11 @@
+// Included before any declaration, #extension has to come first
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 2, binding = 0) uniform sampler2D textures[];
+
+layout(push_constant) uniform TextureIndices {
+        uint color;
+        uint normal;
+        uint gbuffer;
+        uint depth;
+} textureIndices;
\ No newline at end of file
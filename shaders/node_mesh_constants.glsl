@@ -1,28 +1,23 @@
 /* https://developer.nvidia.com/blog/introduction-turing-mesh-shaders/
 	"We recommend using up to 64 vertices and 126 primitives"
 */
-//#define VERTEX_DIMENSION_COUNT 10
-//#define QUAD_DIMENSION_COUNT 9 // 10 - 1
-//#define VERTEX_COUNT 100 // 10 * 10
-//#define PRIMITIVE_COUNT 162 // 9 * 9 * 2
-//#define HALF_PRIMITIVE_COUNT 81 // 9 * 9
 
-#define VERTEX_DIMENSION_COUNT 8
-#define QUAD_DIMENSION_COUNT 7 // 8 -1
-#define VERTEX_COUNT 64 // 8 * 8
-#define PRIMITIVE_COUNT 98 // 7 * 7 * 2
-#define HALF_PRIMITIVE_COUNT 49
+// Specialized per FbrNodeMeshDensity, see nodeMeshDensities in fbr_pipelines.c
+layout(constant_id = 0) const uint VERTEX_DIMENSION_COUNT = 8;
+// screen pixels between grid vertices
+layout(constant_id = 1) const uint SCALE = 4;
 
-//#define VERTEX_DIMENSION_COUNT 4
-//#define QUAD_DIMENSION_COUNT 3 // 4 - 1
-//#define VERTEX_COUNT 16 // 4 * 4
-//#define PRIMITIVE_COUNT 18 // 3 * 3 * 2
-//#define HALF_PRIMITIVE_COUNT 9
+const uint QUAD_DIMENSION_COUNT = VERTEX_DIMENSION_COUNT - 1;
+const uint VERTEX_COUNT = VERTEX_DIMENSION_COUNT * VERTEX_DIMENSION_COUNT;
+const uint HALF_PRIMITIVE_COUNT = QUAD_DIMENSION_COUNT * QUAD_DIMENSION_COUNT;
+const uint PRIMITIVE_COUNT = HALF_PRIMITIVE_COUNT * 2;
 
-#define SCALE 4
+// max_vertices and max_primitives must be literals so they cover the densest variant
+#define MAX_VERTEX_COUNT 100 // 10 * 10
+#define MAX_PRIMITIVE_COUNT 162 // 9 * 9 * 2
 
 struct MeshTaskPayload
 {
     vec4 ulClipPos, urClipPos, lrClipPos, llClipPos;
     vec3 ulNDC, urNDC, lrNDC, llNDC;
-};
\ No newline at end of file
+};
@@ -1,5 +1,7 @@
 #version 450
 
+#include "bindless.glsl"
+
 #include "global_ubo.glsl"
 
 layout (set = 3, binding = 1) uniform NodeUBO {
@@ -7,10 +9,6 @@ layout (set = 3, binding = 1) uniform NodeUBO {
     mat4 proj;
 } nodeUBO;
 
-layout (set = 3, binding = 2) uniform sampler2D color;
-layout (set = 3, binding = 3) uniform sampler2D normal;
-layout (set = 3, binding = 4) uniform sampler2D depth;
-
 layout (location = 0) in vec3 inNormal;
 layout (location = 1) in vec2 inUV;
 layout (location = 2) in vec4 inWorldPos;
@@ -21,9 +19,9 @@ layout (location = 2) out vec4 outGBuffer;
 
 void main()
 {
-    vec4 color = texture(color, inUV);
-    vec4 nodeNormal = texture(normal, inUV);
-    float nodeDepth = texture(depth, inUV).r;
+    vec4 color = texture(textures[textureIndices.color], inUV);
+    vec4 nodeNormal = texture(textures[textureIndices.normal], inUV);
+    float nodeDepth = texture(textures[textureIndices.depth], inUV).r;
 
     vec4 clipPos = vec4(inUV * 2.0 - 1.0,  nodeDepth, 1.0);
     vec4 eyePos = inverse(nodeUBO.proj) * clipPos;
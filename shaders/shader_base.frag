@@ -1,5 +1,7 @@
 #version 450
 
+#include "bindless.glsl"
+
 #define FRAME_WIDTH 1920
 #define FRAME_HEIGHT 1080
 
@@ -7,8 +9,6 @@
 
 //layout(set = 1, binding = 0) uniform sampler2D normal;
 
-layout(set = 2, binding = 0) uniform sampler2D texSampler;
-
 layout(set = 3, binding = 0) uniform ObjectUBO {
     mat4 model;
 } objectUBO;
@@ -30,7 +30,7 @@ void main()
     vec3 ndcPos = eyePos.xyz / eyePos.w;
     vec4 worldPos = globalUBO.invView * vec4(ndcPos, 1.0);
 
-    outColor = texture(texSampler, inUV);
+    outColor = texture(textures[textureIndices.color], inUV);
 //    outColor = worldPos;
 
     // Is this right?! https://github.com/SaschaWillems/Vulkan/blob/master/data/shaders/glsl/subpasses/gbuffer.frag
@@ -13,12 +13,24 @@
 #include "fbr_pipelines.h"
 #include "fbr_transform.h"
 #include "fbr_swap.h"
+#include "fbr_trace.h"
 
 static void initWindow(FbrApp *pApp) {
     FBR_LOG_MESSAGE("initWindow");
 
+#ifdef GLFW_PLATFORM_NULL
+    // glfw 3.4 can run with no display at all
+    if (pApp->settings.headless) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
     glfwInit();
 
+    if (pApp->settings.headless) {
+        FBR_LOG_MESSAGE("headless, no window!");
+        return;
+    }
+
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
     glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
@@ -48,10 +60,7 @@ static void initEntities(FbrApp *pApp, long long externalTextureTest) {
 
         fbrCreateCamera(pVulkan,
                         &pApp->pCamera);
-        fbrCreateSetGlobal(pApp->pVulkan,
-                           pApp->pDescriptors,
-                           pApp->pCamera,
-                           &pApp->pDescriptors->setGlobal);
+        pApp->pCamera->predictPose = pApp->settings.predictPose;
 //        fbrCreateSetPass(pApp->pVulkan,
 //                             pApp->pDescriptors->setLayoutPass,
 //                             pApp->pSwap->pFramebuffers[0]->pNormalTexture,
@@ -71,14 +80,10 @@ static void initEntities(FbrApp *pApp, long long externalTextureTest) {
                                  false,
                                  "textures/test.jpg",
                                  &pApp->pTestQuadTexture);
-        fbrCreateSetMaterial(pApp->pVulkan,
-                           pApp->pDescriptors,
-                           pApp->pTestQuadTexture,
-                           &pApp->testQuadMaterialSet);
-        fbrCreateSetObject(pApp->pVulkan,
-                             pApp->pDescriptors,
-                             pApp->pTestQuadTransform,
-                             &pApp->testQuadObjectSet);
+        fbrAcquireTextureIndex(pApp->pVulkan,
+                               pApp->pDescriptors,
+                               pApp->pTestQuadTexture->imageView,
+                               &pApp->testQuadTextureIndex);
 
         // Comp Node Quad
         fbrCreateNode(pApp, "TestNode", &pApp->pTestNode);
@@ -86,25 +91,11 @@ static void initEntities(FbrApp *pApp, long long externalTextureTest) {
 //                     (vec3) {1, 0, 0},
 //                     pApp->pTestNode->pTransform->pos);
         fbrUpdateTransformUBO(pApp->pTestNode->pTransform);
-        for (int i = 0; i < FBR_FRAMEBUFFER_COUNT; ++i) {
-            fbrCreateSetNode(pApp->pVulkan,
-                             pApp->pDescriptors,
-                             pApp->pTestNode->pTransform,
-                             pApp->pTestNode->pCompositingCamera,
-                             pApp->pTestNode->pFramebuffers[i]->pColorTexture,
-                             pApp->pTestNode->pFramebuffers[i]->pNormalTexture,
-                             pApp->pTestNode->pFramebuffers[i]->pDepthTexture,
-                             &pApp->pCompMaterialSets[i]);
-
-            fbrCreateSetMeshComposite(pApp->pVulkan,
-                             pApp->pDescriptors,
-                             pApp->pTestNode->pCompositingCamera,
-                             pApp->pTestNode->pFramebuffers[i]->pColorTexture->imageView,
-                             pApp->pTestNode->pFramebuffers[i]->pNormalTexture->imageView,
-                             pApp->pTestNode->pFramebuffers[i]->pGBufferTexture->imageView,
-                             pApp->pTestNode->pFramebuffers[i]->pDepthTexture->imageView,
-                             &pApp->pDescriptors->setMeshComposites[i]);
-        }
+        // the compute composite samples the node's framebuffers, not the parent's
+        fbrCreateSetsComputeComposite(pApp->pVulkan,
+                                      pApp->pDescriptors,
+                                      pApp->pTestNode->pFramebuffers,
+                                      pApp->pSwap);
 
 
 //        VkImageView pSourceTextures[FBR_FRAMEBUFFER_COUNT];
@@ -258,10 +249,6 @@ static void initEntities(FbrApp *pApp, long long externalTextureTest) {
         while(fbrIPCPollDeque(pApp, pApp->pNodeParent->pReceiverIPC) != 0) {
             FBR_LOG_DEBUG("Wait Message", pApp->pNodeParent->pReceiverIPC->pRingBuffer->tail, pApp->pNodeParent->pReceiverIPC->pRingBuffer->head);
         }
-        fbrCreateSetGlobal(pApp->pVulkan,
-                           pApp->pDescriptors,
-                           pApp->pCamera,
-                           &pApp->pDescriptors->setGlobal);
 //        fbrCreateSetPass(pApp->pVulkan,
 //                         pApp->pDescriptors->setLayoutPass,
 //                         pApp->pNodeParent->pFramebuffers[0]->pNormalTexture,
@@ -279,24 +266,28 @@ static void initEntities(FbrApp *pApp, long long externalTextureTest) {
                                  false,
                                  "textures/uvgrid.jpg",
                                  &pApp->pTestQuadTexture);
-        fbrCreateSetMaterial(pApp->pVulkan,
-                             pApp->pDescriptors,
-                             pApp->pTestQuadTexture,
-                             &pApp->testQuadMaterialSet);
-        fbrCreateSetObject(pApp->pVulkan,
-                           pApp->pDescriptors,
-                           pApp->pTestQuadTransform,
-                           &pApp->testQuadObjectSet);
+        fbrAcquireTextureIndex(pApp->pVulkan,
+                               pApp->pDescriptors,
+                               pApp->pTestQuadTexture->imageView,
+                               &pApp->testQuadTextureIndex);
     }
 }
 
-void fbrCreateApp(FbrApp **ppAllocApp, bool isChild, long long externalTextureTest) {
+void fbrCreateApp(FbrApp **ppAllocApp, const FbrSettings *pSettings, long long externalTextureTest) {
     *ppAllocApp = calloc(1, sizeof(FbrApp));
     FbrApp *pApp = *ppAllocApp;
     pApp->pTime = calloc(1, sizeof(FbrTime));
     pApp->pTime->currentTime =  glfwGetTime();
     pApp->pTime->lastTime =  glfwGetTime();
-    pApp->isChild = isChild;
+    pApp->settings = *pSettings;
+    pApp->isChild = pSettings->isChild;
+
+    // before any node is spawned so it can open the buffer by name
+    if (pApp->isChild) {
+        fbrImportTrace(&pApp->pTrace);
+    } else {
+        fbrCreateTrace(&pApp->pTrace);
+    }
 
     initWindow(pApp);
 
@@ -316,7 +307,9 @@ void fbrCreateApp(FbrApp **ppAllocApp, bool isChild, long long externalTextureTe
             fbrCreateFrameBuffer(pApp->pVulkan, false, FBR_COLOR_BUFFER_FORMAT, extent, &pApp->pFramebuffers[i]);
         }
         fbrCreateTexture(pApp->pVulkan, VK_FORMAT_R16G16B16A16_SFLOAT /*todo change this?*/, extent, VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, false, &pApp->pComputeTexture);
-        fbrInitInput(pApp);
+        if (!pApp->settings.headless) {
+            fbrInitInput(pApp);
+        }
     }
 
 
@@ -339,23 +332,25 @@ void fbrCleanup(FbrApp *pApp) {
         fbrDestroyNodeParent(pVulkan, pApp->pNodeParent);
     }
     else{
-        fbrDestroyNode(pVulkan, pApp->pTestNode);
+        fbrDestroyNode(pVulkan, pApp->pDescriptors, pApp->pTestNode);
         fbrDestroyCamera(pVulkan, pApp->pCamera);
-        fbrDestroyPipelines(pVulkan, pApp->pPipelines);
-        vkFreeDescriptorSets(pVulkan->device, pApp->pVulkan->descriptorPool, 1, &pApp->pCompMaterialSets[0]);
-        vkFreeDescriptorSets(pVulkan->device, pApp->pVulkan->descriptorPool, 1, &pApp->pCompMaterialSets[1]);
     }
 
+    fbrDestroyPipelines(pVulkan, pApp->pPipelines);
+
+    fbrReleaseTextureIndex(pApp->pDescriptors, pApp->testQuadTextureIndex);
     fbrDestroyTexture(pVulkan, pApp->pTestQuadTexture);
     fbrCleanupMesh(pVulkan, pApp->pTestQuadMesh);
-    vkFreeDescriptorSets(pVulkan->device, pApp->pVulkan->descriptorPool, 1, &pApp->testQuadMaterialSet);
-    vkFreeDescriptorSets(pVulkan->device, pApp->pVulkan->descriptorPool, 1, &pApp->testQuadObjectSet);
 
     fbrDestroyDescriptors(pVulkan, pApp->pDescriptors);
 
     fbrCleanupVulkan(pVulkan);
 
-    glfwDestroyWindow(pApp->pWindow);
+    fbrDestroyTrace(pApp->pTrace);
+
+    if (pApp->pWindow != NULL) {
+        glfwDestroyWindow(pApp->pWindow);
+    }
 
     free(pApp);
 
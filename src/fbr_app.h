@@ -25,6 +25,14 @@ typedef struct FbrDescriptors FbrDescriptors;
 typedef struct FbrPipelines FbrPipelines;
 typedef struct FbrTransform FbrTransform;
 typedef struct FbrSwap FbrSwap;
+typedef struct FbrUploadQueue FbrUploadQueue;
+typedef struct FbrMemoryAllocator FbrMemoryAllocator;
+typedef struct FbrDescriptorAllocator FbrDescriptorAllocator;
+typedef struct FbrProfiler FbrProfiler;
+typedef struct FbrTrace FbrTrace;
+typedef struct FbrBenchmark FbrBenchmark;
+typedef struct FbrDynamicUniformBufferObject FbrDynamicUniformBufferObject;
+typedef struct FbrAssetLoader FbrAssetLoader;
 
 typedef enum FbrIPCTargetType FbrIPCTargetType;
 
@@ -41,9 +49,35 @@ typedef enum FbrReprojectionGeometry {
     MeshShader
 } FbrReprojectionGeometry;
 
+// Reprojection grid resolution of the MeshShader path, each has its own prebuilt pipeline
+typedef enum FbrNodeMeshDensity {
+    FBR_NODE_MESH_DENSITY_LOW,
+    FBR_NODE_MESH_DENSITY_MEDIUM,
+    FBR_NODE_MESH_DENSITY_HIGH,
+    FBR_NODE_MESH_DENSITY_COUNT,
+} FbrNodeMeshDensity;
+
+// Matches TextureIndices in bindless.glsl
+typedef struct FbrTextureIndices {
+    uint32_t colorIndex;
+    uint32_t normalIndex;
+    uint32_t gbufferIndex;
+    uint32_t depthIndex;
+} FbrTextureIndices;
+
 typedef struct FbrSettings {
     bool isChild;
     FbrReprojectionGeometry reprojectionGeometry;
+    // time each supported geometry at startup and keep the fastest, replaces reprojectionGeometry
+    bool calibrateReprojection;
+    // no window or surface, an offscreen image ring stands in for the swapchain, nodes inherit it
+    bool headless;
+    // parent stops after this many frames, 0 runs until the window closes
+    uint32_t frameCount;
+    // camera path file, or "orbit", the parent drives the camera from it and writes a report, NULL for input
+    const char *pBenchmarkPath;
+    // node cameras and the composite view are extrapolated to when their frame is expected on screen
+    bool predictPose;
 } FbrSettings;
 
 typedef struct FbrApp {
@@ -57,6 +91,10 @@ typedef struct FbrApp {
     FbrSwap *pSwap;
     FbrCamera *pCamera;
     FbrTime *pTime;
+    // shared with every node process, exported by the compositor on cleanup
+    FbrTrace *pTrace;
+    // only while a benchmark runs
+    FbrBenchmark *pBenchmark;
 
     FbrFramebuffer *pFramebuffers[FBR_FRAMEBUFFER_COUNT];
     FbrTexture *pComputeTexture;
@@ -65,10 +103,8 @@ typedef struct FbrApp {
     FbrMesh *pTestQuadMesh;
     FbrTexture *pTestQuadTexture;
     FbrTransform *pTestQuadTransform;
-    VkDescriptorSet testQuadMaterialSet;
-    VkDescriptorSet testQuadObjectSet;
+    uint32_t testQuadTextureIndex;
 
-    VkDescriptorSet pCompMaterialSets[2];
 
     // go in fbrvulkan?
     FbrDescriptors *pDescriptors;
@@ -79,7 +115,7 @@ typedef struct FbrApp {
     FbrNodeParent *pNodeParent;
 } FbrApp;
 
-void fbrCreateApp(FbrApp **ppAllocApp, bool isChild, long long externalTextureTest);
+void fbrCreateApp(FbrApp **ppAllocApp, const FbrSettings *pSettings, long long externalTextureTest);
 
 void fbrCleanup(FbrApp *pApp);
 
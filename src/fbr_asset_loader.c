@@ -0,0 +1,204 @@
+#include "fbr_asset_loader.h"
+#include "fbr_texture.h"
+#include "fbr_upload.h"
+#include "fbr_vulkan.h"
+#include "fbr_trace.h"
+#include "fbr_log.h"
+
+#include <stb_image.h>
+#include <string.h>
+
+static void decodeJob(FbrAssetJob *pJob) {
+    fbrTraceBegin("texture decode");
+    int channels;
+    pJob->pPixels = stbi_load(pJob->pPath, &pJob->width, &pJob->height, &channels, STBI_rgb_alpha);
+    fbrTraceEnd("texture decode");
+}
+
+static void freeJob(FbrAssetJob *pJob) {
+    stbi_image_free(pJob->pPixels);
+    free(pJob->pPath);
+    free(pJob);
+}
+
+// On failure the texture just keeps its placeholder
+static void uploadJob(const FbrVulkan *pVulkan, FbrAssetJob *pJob) {
+    FbrTexture *pTexture = pJob->pTexture;
+    if (pJob->pPixels == NULL) {
+        FBR_LOG_MESSAGE("Failed to decode texture!", pJob->pPath);
+    } else if ((uint32_t) pJob->width != pTexture->extent.width || (uint32_t) pJob->height != pTexture->extent.height) {
+        FBR_LOG_MESSAGE("Decoded texture size doesn't match its header!", pJob->pPath);
+    } else {
+        const VkExtent2D extent = {pJob->width, pJob->height};
+        FBR_VK_CHECK(fbrReuploadImage(pVulkan,
+                                      pJob->pPixels,
+                                      (VkDeviceSize) extent.width * extent.height * 4,
+                                      pTexture->image,
+                                      extent,
+                                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                      VK_ACCESS_SHADER_READ_BIT,
+                                      &pTexture->uploadToken));
+    }
+    pTexture->loading = false;
+    freeJob(pJob);
+}
+
+static void finishJobs(const FbrVulkan *pVulkan, FbrAssetLoader *pAssetLoader, FbrAssetJob *pJobs) {
+    while (pJobs != NULL) {
+        FbrAssetJob *pNext = pJobs->pNext;
+        uploadJob(pVulkan, pJobs);
+        pJobs = pNext;
+
+        pAssetLoader->pendingCount--;
+        if (pAssetLoader->pendingCount == 0) {
+            const double ms = (double) (fbrGetTraceTimestamp() - pAssetLoader->startTimestamp) * 1000.0 / (double) fbrGetTraceFrequency();
+            FBR_LOG_MESSAGE("Textures loaded ms.", ms);
+        }
+    }
+}
+
+#ifdef WIN32
+static DWORD WINAPI runAssetWorker(LPVOID pParam)
+{
+    FbrAssetLoader *pAssetLoader = pParam;
+    AcquireSRWLockExclusive(&pAssetLoader->lock);
+    for (;;) {
+        while (pAssetLoader->pQueuedHead == NULL && !pAssetLoader->stopping)
+            SleepConditionVariableSRW(&pAssetLoader->jobQueued, &pAssetLoader->lock, INFINITE, 0);
+        if (pAssetLoader->stopping)
+            break;
+
+        FbrAssetJob *pJob = pAssetLoader->pQueuedHead;
+        pAssetLoader->pQueuedHead = pJob->pNext;
+        if (pAssetLoader->pQueuedHead == NULL)
+            pAssetLoader->pQueuedTail = NULL;
+        ReleaseSRWLockExclusive(&pAssetLoader->lock);
+
+        decodeJob(pJob);
+
+        AcquireSRWLockExclusive(&pAssetLoader->lock);
+        pJob->pNext = pAssetLoader->pDecoded;
+        pAssetLoader->pDecoded = pJob;
+        WakeConditionVariable(&pAssetLoader->jobDecoded);
+    }
+    ReleaseSRWLockExclusive(&pAssetLoader->lock);
+    return 0;
+}
+
+static FbrAssetJob *takeDecodedJobs(FbrAssetLoader *pAssetLoader, bool wait)
+{
+    AcquireSRWLockExclusive(&pAssetLoader->lock);
+    while (wait && pAssetLoader->pDecoded == NULL)
+        SleepConditionVariableSRW(&pAssetLoader->jobDecoded, &pAssetLoader->lock, INFINITE, 0);
+    FbrAssetJob *pJobs = pAssetLoader->pDecoded;
+    pAssetLoader->pDecoded = NULL;
+    ReleaseSRWLockExclusive(&pAssetLoader->lock);
+    return pJobs;
+}
+
+static void freeJobs(FbrAssetJob *pJobs)
+{
+    while (pJobs != NULL) {
+        FbrAssetJob *pNext = pJobs->pNext;
+        freeJob(pJobs);
+        pJobs = pNext;
+    }
+}
+#endif
+
+VkResult fbrCreateAssetLoader(const FbrVulkan *pVulkan, FbrAssetLoader **ppAllocAssetLoader) {
+    *ppAllocAssetLoader = calloc(1, sizeof(FbrAssetLoader));
+    FbrAssetLoader *pAssetLoader = *ppAllocAssetLoader;
+
+#ifdef WIN32
+    InitializeSRWLock(&pAssetLoader->lock);
+    InitializeConditionVariable(&pAssetLoader->jobQueued);
+    InitializeConditionVariable(&pAssetLoader->jobDecoded);
+
+    // leave a core for the main thread
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    uint32_t threadCount = systemInfo.dwNumberOfProcessors > 1 ? systemInfo.dwNumberOfProcessors - 1 : 1;
+    if (threadCount > FBR_ASSET_LOADER_MAX_THREAD_COUNT)
+        threadCount = FBR_ASSET_LOADER_MAX_THREAD_COUNT;
+
+    for (uint32_t i = 0; i < threadCount; ++i) {
+        const HANDLE thread = CreateThread(NULL, 0, runAssetWorker, pAssetLoader, 0, NULL);
+        if (thread == NULL) {
+            FBR_LOG_ERROR("Failed to start asset loader thread!");
+            break;
+        }
+        pAssetLoader->pThreads[pAssetLoader->threadCount++] = thread;
+    }
+    FBR_LOG_MESSAGE("Created asset loader.", pAssetLoader->threadCount);
+#endif
+
+    return FBR_SUCCESS;
+}
+
+void fbrDestroyAssetLoader(const FbrVulkan *pVulkan, FbrAssetLoader *pAssetLoader) {
+#ifdef WIN32
+    AcquireSRWLockExclusive(&pAssetLoader->lock);
+    pAssetLoader->stopping = true;
+    ReleaseSRWLockExclusive(&pAssetLoader->lock);
+    WakeAllConditionVariable(&pAssetLoader->jobQueued);
+
+    for (uint32_t i = 0; i < pAssetLoader->threadCount; ++i) {
+        WaitForSingleObject(pAssetLoader->pThreads[i], INFINITE);
+        CloseHandle(pAssetLoader->pThreads[i]);
+    }
+
+    // destroying a loading texture finishes its load, so these only remain if nothing waited on them
+    freeJobs(pAssetLoader->pQueuedHead);
+    freeJobs(pAssetLoader->pDecoded);
+#endif
+
+    free(pAssetLoader);
+}
+
+void fbrQueueTextureDecode(const FbrVulkan *pVulkan, FbrTexture *pTexture, const char *pPath) {
+    FbrAssetLoader *pAssetLoader = pVulkan->pAssetLoader;
+    FbrAssetJob *pJob = calloc(1, sizeof(FbrAssetJob));
+    pJob->pPath = strdup(pPath);
+    pJob->pTexture = pTexture;
+    pTexture->loading = true;
+    if (pAssetLoader->pendingCount++ == 0)
+        pAssetLoader->startTimestamp = fbrGetTraceTimestamp();
+
+#ifdef WIN32
+    if (pAssetLoader->threadCount > 0) {
+        AcquireSRWLockExclusive(&pAssetLoader->lock);
+        if (pAssetLoader->pQueuedTail != NULL) {
+            pAssetLoader->pQueuedTail->pNext = pJob;
+        } else {
+            pAssetLoader->pQueuedHead = pJob;
+        }
+        pAssetLoader->pQueuedTail = pJob;
+        ReleaseSRWLockExclusive(&pAssetLoader->lock);
+        WakeConditionVariable(&pAssetLoader->jobQueued);
+        return;
+    }
+#endif
+
+    decodeJob(pJob);
+    finishJobs(pVulkan, pAssetLoader, pJob);
+}
+
+void fbrUpdateAssetLoader(const FbrVulkan *pVulkan) {
+    FbrAssetLoader *pAssetLoader = pVulkan->pAssetLoader;
+    if (pAssetLoader->pendingCount == 0)
+        return;
+#ifdef WIN32
+    finishJobs(pVulkan, pAssetLoader, takeDecodedJobs(pAssetLoader, false));
+#endif
+}
+
+void fbrFinishAssetLoads(const FbrVulkan *pVulkan) {
+    FbrAssetLoader *pAssetLoader = pVulkan->pAssetLoader;
+#ifdef WIN32
+    while (pAssetLoader->pendingCount > 0)
+        finishJobs(pVulkan, pAssetLoader, takeDecodedJobs(pAssetLoader, true));
+#endif
+}
@@ -0,0 +1,56 @@
+#ifndef FABRIC_ASSET_LOADER_H
+#define FABRIC_ASSET_LOADER_H
+
+#include "fbr_app.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#define FBR_ASSET_LOADER_MAX_THREAD_COUNT 8
+
+// One image to decode. Owned by the loader from fbrQueueTextureDecode until its pixels are uploaded.
+typedef struct FbrAssetJob {
+    struct FbrAssetJob *pNext;
+    char *pPath;
+    FbrTexture *pTexture;
+    // written by the worker, NULL if decoding failed
+    uint8_t *pPixels;
+    int width;
+    int height;
+} FbrAssetJob;
+
+// Worker threads decode images off the main thread, the main thread hands them to the upload queue
+typedef struct FbrAssetLoader {
+    // queued, decoding or decoded but not yet uploaded, only touched by the main thread
+    uint32_t pendingCount;
+    int64_t startTimestamp;
+#ifdef WIN32
+    SRWLOCK lock;
+    CONDITION_VARIABLE jobQueued;
+    CONDITION_VARIABLE jobDecoded;
+    // guarded by lock, queued is oldest first, decoded in any order
+    FbrAssetJob *pQueuedHead;
+    FbrAssetJob *pQueuedTail;
+    FbrAssetJob *pDecoded;
+    bool stopping;
+    uint32_t threadCount;
+    HANDLE pThreads[FBR_ASSET_LOADER_MAX_THREAD_COUNT];
+#endif
+} FbrAssetLoader;
+
+VkResult fbrCreateAssetLoader(const FbrVulkan *pVulkan, FbrAssetLoader **ppAllocAssetLoader);
+
+void fbrDestroyAssetLoader(const FbrVulkan *pVulkan, FbrAssetLoader *pAssetLoader);
+
+// Decodes pPath on a worker and uploads it into pTexture, which must already be sized to the image and readable.
+// Without worker threads this decodes and uploads inline.
+void fbrQueueTextureDecode(const FbrVulkan *pVulkan, FbrTexture *pTexture, const char *pPath);
+
+// Call on the main thread before fbrSubmitUploads, uploads everything decoded since the last call.
+void fbrUpdateAssetLoader(const FbrVulkan *pVulkan);
+
+// Blocks until every queued image is uploaded.
+void fbrFinishAssetLoads(const FbrVulkan *pVulkan);
+
+#endif //FABRIC_ASSET_LOADER_H
@@ -0,0 +1,344 @@
+#include "fbr_benchmark.h"
+#include "fbr_camera.h"
+#include "fbr_vulkan.h"
+#include "fbr_swap.h"
+#include "fbr_trace.h"
+#include "fbr_log.h"
+#include "fbr_pose_predictor.h"
+
+#include "stb_ds.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+static int compareKeyframeTime(const void *pA, const void *pB) {
+    const float a = ((const FbrBenchmarkKeyframe *) pA)->time;
+    const float b = ((const FbrBenchmarkKeyframe *) pB)->time;
+    return (a > b) - (a < b);
+}
+
+static int compareFloat(const void *pA, const void *pB) {
+    const float a = *(const float *) pA;
+    const float b = *(const float *) pB;
+    return (a > b) - (a < b);
+}
+
+static VkResult loadPath(FbrBenchmark *pBenchmark, const char *pPath) {
+    FILE *file = fopen(pPath, "r");
+    if (file == NULL) {
+        FBR_LOG_ERROR("Can't open benchmark path!");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    char pLine[256];
+    while (fgets(pLine, sizeof(pLine), file) != NULL) {
+        FbrBenchmarkKeyframe keyframe;
+        if (pLine[0] == '#')
+            continue;
+        if (sscanf(pLine, "%f %f %f %f %f %f",
+                   &keyframe.time,
+                   &keyframe.pos[0],
+                   &keyframe.pos[1],
+                   &keyframe.pos[2],
+                   &keyframe.yaw,
+                   &keyframe.pitch) != 6)
+            continue;
+        arrput(pBenchmark->pKeyframes, keyframe);
+    }
+    fclose(file);
+
+    if (arrlen(pBenchmark->pKeyframes) == 0) {
+        FBR_LOG_ERROR("Benchmark path has no keyframes!");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    qsort(pBenchmark->pKeyframes, arrlen(pBenchmark->pKeyframes), sizeof(FbrBenchmarkKeyframe), compareKeyframeTime);
+
+    FBR_LOG_MESSAGE("Loaded benchmark path.", pPath, arrlen(pBenchmark->pKeyframes));
+
+    return VK_SUCCESS;
+}
+
+// Plays the path forward then back again, so looping never jumps from the last keyframe to the first
+static void samplePath(const FbrBenchmark *pBenchmark, float time, vec3 pos, float *pYaw, float *pPitch) {
+    const FbrBenchmarkKeyframe *pKeyframes = pBenchmark->pKeyframes;
+    const int keyframeCount = (int) arrlen(pKeyframes);
+    const float duration = pKeyframes[keyframeCount - 1].time;
+    if (duration > 0) {
+        time = fmodf(time, 2.0f * duration);
+        if (time > duration)
+            time = 2.0f * duration - time;
+    }
+
+    int index = 0;
+    while (index < keyframeCount - 1 && pKeyframes[index + 1].time <= time)
+        index++;
+
+    const FbrBenchmarkKeyframe *pFrom = &pKeyframes[index];
+    const FbrBenchmarkKeyframe *pTo = &pKeyframes[index < keyframeCount - 1 ? index + 1 : index];
+    const float span = pTo->time - pFrom->time;
+    const float t = span > 0 ? (time - pFrom->time) / span : 0;
+
+    glm_vec3_lerp((float *) pFrom->pos, (float *) pTo->pos, t, pos);
+    *pYaw = glm_lerp(pFrom->yaw, pTo->yaw, t);
+    *pPitch = glm_lerp(pFrom->pitch, pTo->pitch, t);
+}
+
+// Circles the origin at the camera's starting distance, always looking at the center
+static void sampleOrbit(float time, vec3 pos, float *pYaw, float *pPitch) {
+    const float angle = GLM_PIf + 2.0f * GLM_PIf * time / FBR_BENCHMARK_ORBIT_PERIOD;
+    pos[0] = FBR_BENCHMARK_ORBIT_RADIUS * sinf(angle);
+    pos[1] = 0;
+    pos[2] = FBR_BENCHMARK_ORBIT_RADIUS * cosf(angle);
+    *pYaw = glm_deg(angle);
+    *pPitch = 0;
+}
+
+static void samplePose(const FbrBenchmark *pBenchmark, float time, vec3 pos, versor rot) {
+    float yaw;
+    float pitch;
+    if (pBenchmark->pKeyframes != NULL) {
+        samplePath(pBenchmark, time, pos, &yaw, &pitch);
+    } else {
+        sampleOrbit(time, pos, &yaw, &pitch);
+    }
+
+    versor yawRot;
+    versor pitchRot;
+    glm_quatv(yawRot, glm_rad(yaw), GLM_YUP);
+    glm_quatv(pitchRot, glm_rad(pitch), GLM_XUP);
+    glm_quat_mul(yawRot, pitchRot, rot);
+}
+
+static void updateCamera(const FbrBenchmark *pBenchmark, FbrCamera *pCamera) {
+    const float time = (float) (pBenchmark->frameIndex * FBR_BENCHMARK_TIME_STEP);
+    samplePose(pBenchmark, time, pCamera->pTransform->pos, pCamera->pTransform->rot);
+    glm_quat_look(pCamera->pTransform->pos, pCamera->pTransform->rot, pCamera->bufferData.view);
+    glm_mat4_inv(pCamera->bufferData.view, pCamera->bufferData.invView);
+}
+
+static float ticksToMs(const FbrBenchmark *pBenchmark, int64_t ticks) {
+    return (float) ((double) ticks * 1000.0 / (double) pBenchmark->timestampFrequency);
+}
+
+static bool isWarmingUp(const FbrBenchmark *pBenchmark) {
+    return pBenchmark->frameIndex < FBR_BENCHMARK_WARMUP_FRAME_COUNT;
+}
+
+VkResult fbrCreateBenchmark(const char *pPath, uint32_t frameCount, FbrBenchmark **ppAllocBenchmark) {
+    *ppAllocBenchmark = calloc(1, sizeof(FbrBenchmark));
+    FbrBenchmark *pBenchmark = *ppAllocBenchmark;
+    pBenchmark->pPathName = strdup(pPath);
+    pBenchmark->frameCount = frameCount > 0 ? frameCount : FBR_BENCHMARK_DEFAULT_FRAME_COUNT;
+    pBenchmark->timestampFrequency = fbrGetTraceFrequency();
+
+    if (strcmp(pPath, FBR_BENCHMARK_ORBIT_PATH) != 0)
+        FBR_ACK(loadPath(pBenchmark, pPath));
+
+    return VK_SUCCESS;
+}
+
+void fbrDestroyBenchmark(FbrBenchmark *pBenchmark) {
+    free(pBenchmark->pPathName);
+    arrfree(pBenchmark->pKeyframes);
+    arrfree(pBenchmark->pFrameTimes);
+    arrfree(pBenchmark->pNodeLatencies);
+    for (int i = 0; i < FBR_PROFILER_ZONE_COUNT; ++i) {
+        arrfree(pBenchmark->pZoneTimes[i]);
+    }
+    free(pBenchmark);
+}
+
+uint32_t fbrGetBenchmarkLoopFrameCount(const FbrBenchmark *pBenchmark) {
+    return pBenchmark->frameCount + FBR_BENCHMARK_WARMUP_FRAME_COUNT;
+}
+
+void fbrBeginBenchmarkFrame(FbrBenchmark *pBenchmark, const FbrVulkan *pVulkan, FbrCamera *pCamera) {
+    const int64_t timestamp = fbrGetTraceTimestamp();
+    if (!isWarmingUp(pBenchmark)) {
+        arrput(pBenchmark->pFrameTimes, ticksToMs(pBenchmark, timestamp - pBenchmark->lastFrameTimestamp));
+
+        const FbrProfiler *pProfiler = pVulkan->pProfiler;
+        for (int zone = 0; zone < FBR_PROFILER_ZONE_COUNT; ++zone) {
+            if (pProfiler->collectedZones & (1u << zone))
+                arrput(pBenchmark->pZoneTimes[zone], pProfiler->pCollectedMs[zone]);
+        }
+    }
+    pBenchmark->lastFrameTimestamp = timestamp;
+
+    updateCamera(pBenchmark, pCamera);
+    pBenchmark->frameIndex++;
+}
+
+void fbrBenchmarkNodeCameraWrite(FbrBenchmark *pBenchmark) {
+    pBenchmark->cameraWriteTimestamp = fbrGetTraceTimestamp();
+}
+
+void fbrBenchmarkNodeFrameAcquired(FbrBenchmark *pBenchmark) {
+    if (pBenchmark->cameraWriteTimestamp == 0 || isWarmingUp(pBenchmark))
+        return;
+    arrput(pBenchmark->pNodeLatencies, ticksToMs(pBenchmark, fbrGetTraceTimestamp() - pBenchmark->cameraWriteTimestamp));
+}
+
+// Nearest rank on a sorted array
+static float getPercentile(const float *pSorted, size_t count, double percentile) {
+    size_t rank = (size_t) ceil(percentile / 100.0 * (double) count);
+    if (rank < 1)
+        rank = 1;
+    return pSorted[rank - 1];
+}
+
+static void writeMetric(FILE *file, const char *pName, const float *pSamples, bool last) {
+    const size_t count = arrlen(pSamples);
+    fprintf(file, "    \"%s\": {\"count\": %zu", pName, count);
+    if (count > 0) {
+        float *pSorted = malloc(count * sizeof(float));
+        memcpy(pSorted, pSamples, count * sizeof(float));
+        qsort(pSorted, count, sizeof(float), compareFloat);
+        double sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += pSorted[i];
+        }
+        fprintf(file, ", \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f",
+                pSorted[0],
+                sum / (double) count,
+                getPercentile(pSorted, count, 50),
+                getPercentile(pSorted, count, 90),
+                getPercentile(pSorted, count, 95),
+                getPercentile(pSorted, count, 99),
+                pSorted[count - 1]);
+        free(pSorted);
+    }
+    fprintf(file, "}%s\n", last ? "" : ",");
+}
+
+void fbrWriteBenchmarkReport(const FbrBenchmark *pBenchmark, const FbrApp *pApp, const char *pReprojectionName, const char *pPath) {
+    FILE *file = fopen(pPath, "w");
+    if (file == NULL) {
+        FBR_LOG_ERROR("Can't open benchmark report for writing!");
+        return;
+    }
+
+    // everything needed to tell apart runs that aren't comparable, all times in milliseconds
+    fputs("{\n", file);
+    fprintf(file, "  \"build\": \"%s %s\",\n", __DATE__, __TIME__);
+    fprintf(file, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(file, "  \"reprojection\": \"%s\",\n", pReprojectionName);
+    fprintf(file, "  \"headless\": %s,\n", pApp->settings.headless ? "true" : "false");
+    fprintf(file, "  \"width\": %u,\n", pApp->pSwap->extent.width);
+    fprintf(file, "  \"height\": %u,\n", pApp->pSwap->extent.height);
+    fputs("  \"path\": ", file);
+    fbrWriteJSONString(file, pBenchmark->pPathName);
+    fputs(",\n", file);
+    fprintf(file, "  \"frames\": %u,\n", pBenchmark->frameCount);
+    fprintf(file, "  \"warmupFrames\": %u,\n", FBR_BENCHMARK_WARMUP_FRAME_COUNT);
+    fputs("  \"metrics\": {\n", file);
+    writeMetric(file, "frameTime", pBenchmark->pFrameTimes, false);
+    writeMetric(file, "nodeLatency", pBenchmark->pNodeLatencies, false);
+    for (int zone = 0; zone < FBR_PROFILER_ZONE_COUNT; ++zone) {
+        char pName[64];
+        snprintf(pName, sizeof(pName), "gpu %s", fbrGetProfilerZoneName(zone));
+        writeMetric(file, pName, pBenchmark->pZoneTimes[zone], zone == FBR_PROFILER_ZONE_COUNT - 1);
+    }
+    fputs("  }\n}\n", file);
+    fclose(file);
+
+    FBR_LOG_MESSAGE("Wrote benchmark report.", pPath);
+}
+
+// stb_ds arrays, one per lead time
+typedef struct FbrPredictionErrors {
+    float *pPredictedPositions;
+    float *pPredictedRotations;
+    float *pHeldPositions;
+    float *pHeldRotations;
+} FbrPredictionErrors;
+
+static float rotationErrorDegrees(versor a, versor b) {
+    const float dot = fabsf(glm_quat_dot(a, b));
+    return glm_deg(2.0f * acosf(dot < 1.0f ? dot : 1.0f));
+}
+
+VkResult fbrMeasurePredictionError(const char *pPath, uint32_t frameCount, const char *pReportPath) {
+    FbrBenchmark *pBenchmark;
+    const VkResult result = fbrCreateBenchmark(pPath, frameCount, &pBenchmark);
+    if (result != VK_SUCCESS) {
+        fbrDestroyBenchmark(pBenchmark);
+        return result;
+    }
+
+    // path time stands in for the trace clock, in microseconds
+    const int64_t frequency = 1000000;
+    FbrPosePredictor predictor;
+    fbrInitPosePredictor(&predictor, frequency);
+
+    const uint32_t pLeadFrames[] = FBR_BENCHMARK_PREDICTION_LEAD_FRAMES;
+    FbrPredictionErrors pErrors[COUNT(pLeadFrames)] = {};
+    for (uint32_t frame = 0; frame < pBenchmark->frameCount; ++frame) {
+        const double time = frame * FBR_BENCHMARK_TIME_STEP;
+        vec3 pos;
+        versor rot;
+        samplePose(pBenchmark, (float) time, pos, rot);
+        fbrPushPoseSample(&predictor, (int64_t) (time * (double) frequency), pos, rot);
+
+        for (int lead = 0; lead < COUNT(pLeadFrames); ++lead) {
+            const double targetTime = time + pLeadFrames[lead] * FBR_BENCHMARK_TIME_STEP;
+            vec3 targetPos;
+            versor targetRot;
+            samplePose(pBenchmark, (float) targetTime, targetPos, targetRot);
+
+            vec3 predictedPos;
+            versor predictedRot;
+            if (!fbrPredictPose(&predictor, (int64_t) (targetTime * (double) frequency), predictedPos, predictedRot))
+                continue;
+
+            // held is what the target would show without prediction, the error prediction has to beat
+            arrput(pErrors[lead].pPredictedPositions, glm_vec3_distance(predictedPos, targetPos) * 1000.0f);
+            arrput(pErrors[lead].pPredictedRotations, rotationErrorDegrees(predictedRot, targetRot));
+            arrput(pErrors[lead].pHeldPositions, glm_vec3_distance(pos, targetPos) * 1000.0f);
+            arrput(pErrors[lead].pHeldRotations, rotationErrorDegrees(rot, targetRot));
+        }
+    }
+
+    FILE *file = fopen(pReportPath, "w");
+    if (file == NULL) {
+        FBR_LOG_ERROR("Can't open prediction report for writing!");
+    } else {
+        // positions in millimeters, rotations in degrees
+        fputs("{\n", file);
+        fprintf(file, "  \"build\": \"%s %s\",\n", __DATE__, __TIME__);
+        fputs("  \"path\": ", file);
+        fbrWriteJSONString(file, pBenchmark->pPathName);
+        fputs(",\n", file);
+        fprintf(file, "  \"frames\": %u,\n", pBenchmark->frameCount);
+        fprintf(file, "  \"frameMs\": %.4f,\n", FBR_BENCHMARK_TIME_STEP * 1000.0);
+        fprintf(file, "  \"velocityWindowMs\": %.4f,\n", FBR_POSE_PREDICTOR_VELOCITY_WINDOW_MS);
+        fprintf(file, "  \"maxHorizonMs\": %.4f,\n", FBR_POSE_PREDICTOR_MAX_HORIZON_MS);
+        fputs("  \"metrics\": {\n", file);
+        for (int lead = 0; lead < COUNT(pLeadFrames); ++lead) {
+            char pName[64];
+            snprintf(pName, sizeof(pName), "predicted position %u frames", pLeadFrames[lead]);
+            writeMetric(file, pName, pErrors[lead].pPredictedPositions, false);
+            snprintf(pName, sizeof(pName), "predicted rotation %u frames", pLeadFrames[lead]);
+            writeMetric(file, pName, pErrors[lead].pPredictedRotations, false);
+            snprintf(pName, sizeof(pName), "held position %u frames", pLeadFrames[lead]);
+            writeMetric(file, pName, pErrors[lead].pHeldPositions, false);
+            snprintf(pName, sizeof(pName), "held rotation %u frames", pLeadFrames[lead]);
+            writeMetric(file, pName, pErrors[lead].pHeldRotations, lead == COUNT(pLeadFrames) - 1);
+        }
+        fputs("  }\n}\n", file);
+        fclose(file);
+        FBR_LOG_MESSAGE("Wrote prediction report.", pReportPath);
+    }
+
+    for (int lead = 0; lead < COUNT(pLeadFrames); ++lead) {
+        arrfree(pErrors[lead].pPredictedPositions);
+        arrfree(pErrors[lead].pPredictedRotations);
+        arrfree(pErrors[lead].pHeldPositions);
+        arrfree(pErrors[lead].pHeldRotations);
+    }
+    fbrDestroyBenchmark(pBenchmark);
+
+    return VK_SUCCESS;
+}
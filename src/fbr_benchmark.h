@@ -0,0 +1,69 @@
+#ifndef FABRIC_BENCHMARK_H
+#define FABRIC_BENCHMARK_H
+
+#include "fbr_app.h"
+#include "fbr_profiler.h"
+#include "fbr_cglm.h"
+
+// Path name which makes a procedural orbit of the origin instead of reading a file
+#define FBR_BENCHMARK_ORBIT_PATH "orbit"
+#define FBR_BENCHMARK_DEFAULT_FRAME_COUNT 1000
+// run before any sample is kept so pipeline creation and first uploads don't skew the report
+#define FBR_BENCHMARK_WARMUP_FRAME_COUNT 60
+// the path advances by this much every frame no matter how long the frame took, so every run sees the same views
+#define FBR_BENCHMARK_TIME_STEP (1.0 / 90.0)
+#define FBR_BENCHMARK_ORBIT_RADIUS 2.0f
+#define FBR_BENCHMARK_ORBIT_PERIOD 10.0f
+#define FBR_BENCHMARK_REPORT_PATH "./fabric_benchmark.json"
+#define FBR_BENCHMARK_PREDICTION_REPORT_PATH "./fabric_prediction.json"
+// how far ahead prediction error is measured, in frames of FBR_BENCHMARK_TIME_STEP
+#define FBR_BENCHMARK_PREDICTION_LEAD_FRAMES {1, 2, 3}
+
+// One line per keyframe in a path file: time px py pz yaw pitch, angles in degrees, # starts a comment
+typedef struct FbrBenchmarkKeyframe {
+    float time;
+    vec3 pos;
+    float yaw;
+    float pitch;
+} FbrBenchmarkKeyframe;
+
+typedef struct FbrBenchmark {
+    char *pPathName;
+    // stb_ds array sorted by time, NULL for the orbit
+    FbrBenchmarkKeyframe *pKeyframes;
+    uint32_t frameCount;
+    uint32_t frameIndex;
+
+    int64_t lastFrameTimestamp;
+    int64_t cameraWriteTimestamp;
+    int64_t timestampFrequency;
+
+    // stb_ds arrays of milliseconds, only filled after warmup
+    float *pFrameTimes;
+    float *pNodeLatencies;
+    float *pZoneTimes[FBR_PROFILER_ZONE_COUNT];
+} FbrBenchmark;
+
+VkResult fbrCreateBenchmark(const char *pPath, uint32_t frameCount, FbrBenchmark **ppAllocBenchmark);
+
+void fbrDestroyBenchmark(FbrBenchmark *pBenchmark);
+
+// Total frames the parent loop should run, warmup included.
+uint32_t fbrGetBenchmarkLoopFrameCount(const FbrBenchmark *pBenchmark);
+
+// Call once per frame after fbrBeginProfilerFrame. Samples the last frame and moves the camera along the path.
+void fbrBeginBenchmarkFrame(FbrBenchmark *pBenchmark, const FbrVulkan *pVulkan, FbrCamera *pCamera);
+
+// The parent wrote the camera a node renders its next frame with.
+void fbrBenchmarkNodeCameraWrite(FbrBenchmark *pBenchmark);
+
+// A new node frame arrived, latency is measured from the camera write before it.
+void fbrBenchmarkNodeFrameAcquired(FbrBenchmark *pBenchmark);
+
+void fbrWriteBenchmarkReport(const FbrBenchmark *pBenchmark, const FbrApp *pApp, const char *pReprojectionName, const char *pPath);
+
+// Offline, no vulkan. Plays the path through the pose predictor at the benchmark frame rate and reports
+// how far its predictions land from where the path really is, next to the error of not predicting at all.
+VkResult fbrMeasurePredictionError(const char *pPath, uint32_t frameCount, const char *pReportPath);
+
+#endif //FABRIC_BENCHMARK_H
@@ -1,27 +1,28 @@
 #include "fbr_buffer.h"
 #include "fbr_vulkan.h"
+#include "fbr_upload.h"
 #include "fbr_log.h"
 
+#include "stb_ds.h"
+
 #if WIN32
 #include <vulkan/vulkan_win32.h>
 #define FBR_EXTERNAL_MEMORY_HANDLE_TYPE VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_WIN32_BIT_KHR
 #endif
 
-//static void setDynamicAlignment(const FbrVulkan *pVulkan, uint32_t bufferSize, uint32_t dynamicCount, FbrUniformBufferObject *pBuffer)
-//{
-//    pBuffer->bufferSize = bufferSize;
-//    pBuffer->dynamicCount = dynamicCount;
-//    if (pBuffer->dynamicCount != FBR_NO_DYNAMIC_BUFFER) {
-//        // https://github.com/SaschaWillems/Vulkan/blob/master/examples/dynamicuniformbuffer/README.md
-//        size_t minUboAlignment = pVulkan->physicalDeviceProperties.limits.minUniformBufferOffsetAlignment;
-//        pBuffer->dynamicAlignment = pBuffer->bufferSize;
-//        if (minUboAlignment > 0) {
-//            pBuffer->dynamicAlignment = (pBuffer->dynamicAlignment + minUboAlignment - 1) & ~(minUboAlignment - 1);
-//        }
-//        pBuffer->bufferSize = pBuffer->dynamicAlignment * pBuffer->dynamicCount;
-//        FBR_LOG_DEBUG("Creating Dynamic Buffer.", pBuffer->dynamicAlignment, pBuffer->bufferSize);
-//    }
-//}
+static void setDynamicAlignment(const FbrVulkan *pVulkan, VkDeviceSize slotSize, uint32_t dynamicCount, FbrDynamicUniformBufferObject *pDynamicUBO)
+{
+    pDynamicUBO->dynamicCount = dynamicCount;
+    // https://github.com/SaschaWillems/Vulkan/blob/master/examples/dynamicuniformbuffer/README.md
+    size_t minUboAlignment = pVulkan->physicalDeviceProperties.properties.limits.minUniformBufferOffsetAlignment;
+    pDynamicUBO->dynamicAlignment = slotSize;
+    if (minUboAlignment > 0) {
+        pDynamicUBO->dynamicAlignment = (pDynamicUBO->dynamicAlignment + minUboAlignment - 1) & ~(minUboAlignment - 1);
+    }
+    pDynamicUBO->frameSize = (VkDeviceSize) pDynamicUBO->dynamicAlignment * pDynamicUBO->dynamicCount;
+    pDynamicUBO->bufferSize = pDynamicUBO->frameSize * FBR_DYNAMIC_UBO_FRAME_COUNT;
+    FBR_LOG_MESSAGE("Creating Dynamic Buffer.", pDynamicUBO->dynamicAlignment, pDynamicUBO->bufferSize);
+}
 
 // From OVR Vulkan example. Is this better/same as vulkan tutorial!?
 static VkResult memoryTypeFromProperties(const VkPhysicalDeviceMemoryProperties memoryProperties,
@@ -73,7 +74,7 @@ void importBuffer(const FbrVulkan *pVulkan,
                   VkDeviceSize size,
                   HANDLE externalMemory,
                   VkBuffer *pBuffer,
-                  VkDeviceMemory *pBufferMemory) {
+                  FbrAllocation *pBufferAllocation) {
 
     VkExternalMemoryBufferCreateInfoKHR externalMemoryBufferCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR,
@@ -118,9 +119,9 @@ void importBuffer(const FbrVulkan *pVulkan,
             .memoryTypeIndex = memTypeIndex,
             .pNext = &importMemoryInfo
     };
-    FBR_VK_CHECK(vkAllocateMemory(pVulkan->device, &allocInfo, NULL, pBufferMemory));
+    FBR_VK_CHECK(fbrAllocateDedicatedMemory(pVulkan, &allocInfo, pBufferAllocation));
 
-    FBR_VK_CHECK(vkBindBufferMemory(pVulkan->device, *pBuffer, *pBufferMemory, 0));
+    FBR_VK_CHECK(vkBindBufferMemory(pVulkan->device, *pBuffer, pBufferAllocation->memory, 0));
 }
 
 VkResult createAllocBindBuffer(const FbrVulkan *pVulkan,
@@ -129,7 +130,7 @@ VkResult createAllocBindBuffer(const FbrVulkan *pVulkan,
                                VkDeviceSize size,
                                bool external,
                                VkBuffer *pBuffer,
-                               VkDeviceMemory *pBufferMemory)
+                               FbrAllocation *pBufferAllocation)
 {
     VkExternalMemoryBufferCreateInfoKHR externalMemoryBufferCreateInfo = {
             .sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO_KHR,
@@ -146,6 +147,12 @@ VkResult createAllocBindBuffer(const FbrVulkan *pVulkan,
 
     FBR_ACK(vkCreateBuffer(pVulkan->device, &bufferCreateInfo, NULL, pBuffer));
 
+    // Exported memory has to own its VkDeviceMemory, everything else is sub-allocated
+    if (!external) {
+        FBR_ACK(fbrAllocateBindBufferMemory(pVulkan, *pBuffer, properties, pBufferAllocation));
+        return FBR_SUCCESS;
+    }
+
     VkMemoryRequirements memRequirements = {};
     uint32_t memTypeIndex;
     FBR_ACK(fbrBufferMemoryTypeFromProperties(pVulkan,
@@ -175,13 +182,17 @@ VkResult createAllocBindBuffer(const FbrVulkan *pVulkan,
     };
     VkMemoryAllocateInfo allocInfo = {
             .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .pNext = external ? &exportAllocInfo : NULL,
+            .pNext = &exportAllocInfo,
             .allocationSize = memRequirements.size,
             .memoryTypeIndex = memTypeIndex
     };
-    FBR_ACK(vkAllocateMemory(pVulkan->device, &allocInfo, NULL, pBufferMemory));
+    FBR_ACK(fbrAllocateDedicatedMemory(pVulkan, &allocInfo, pBufferAllocation));
 
-    FBR_ACK(vkBindBufferMemory(pVulkan->device, *pBuffer, *pBufferMemory, 0));
+    FBR_ACK(vkBindBufferMemory(pVulkan->device, *pBuffer, pBufferAllocation->memory, 0));
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        FBR_ACK(vkMapMemory(pVulkan->device, pBufferAllocation->memory, 0, VK_WHOLE_SIZE, 0, &pBufferAllocation->pMapped));
+    }
 
     return FBR_SUCCESS;
 }
@@ -204,45 +215,18 @@ FBR_RESULT getExternalHandle(const FbrVulkan *pVulkan,
     return FBR_SUCCESS;
 }
 
-// TODO this immediate command buffer creating destroy a whole command buffer and waiting each frame is horribly inefficient
+// Immediate path now just borrows the graphics command buffer of the current upload batch and waits on its token.
+// Anything that doesn't need the result on the CPU right away should record through fbr_upload instead.
 FBR_RESULT fbrBeginImmediateCommandBuffer(const FbrVulkan *pVulkan, VkCommandBuffer *pCommandBuffer) {
-    const VkCommandBufferAllocateInfo allocInfo = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            .commandPool =  pVulkan->graphicsCommandPool,
-            .commandBufferCount = 1,
-    };
-    FBR_ACK(vkAllocateCommandBuffers(pVulkan->device, &allocInfo, pCommandBuffer));
-    const VkCommandBufferBeginInfo beginInfo = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
-    FBR_ACK(vkBeginCommandBuffer(*pCommandBuffer, &beginInfo));
+    FBR_ACK(fbrGetUploadGraphicsCommandBuffer(pVulkan, pCommandBuffer, NULL));
 
     return FBR_SUCCESS;
 }
 
 FBR_RESULT fbrEndImmediateCommandBuffer(const FbrVulkan *pVulkan, VkCommandBuffer *pCommandBuffer) {
-    vkEndCommandBuffer(*pCommandBuffer);
-
-    const VkSubmitInfo submitInfo = {
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .pNext = NULL,
-            .waitSemaphoreCount = 0,
-            .pWaitSemaphores = NULL,
-            .pWaitDstStageMask = 0,
-            .commandBufferCount = 1,
-            .pCommandBuffers = pCommandBuffer,
-            .signalSemaphoreCount = 0,
-            .pSignalSemaphores = NULL
-    };
-    FBR_ACK_EXIT(vkQueueSubmit(pVulkan->graphicsQueue,
-                               1,
-                               &submitInfo,
-                               VK_NULL_HANDLE));
-    FBR_ACK(vkQueueWaitIdle(pVulkan->graphicsQueue)); // TODO could be more optimized with vkWaitForFences https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer
-
-    vkFreeCommandBuffers(pVulkan->device, pVulkan->graphicsCommandPool, 1, pCommandBuffer);
+    FbrUploadToken token;
+    FBR_ACK(fbrSubmitUploads(pVulkan, &token));
+    FBR_ACK(fbrWaitUpload(pVulkan, token));
 
     return FBR_SUCCESS;
 }
@@ -337,55 +321,28 @@ void fbrMemCopyMappedUBO(const FbrUniformBufferObject *pDstUBO, const void* pSrc
     memcpy(pDstUBO->pUniformBufferMapped, pSrcData, size);
 }
 
-//TODO reuse staging buffers
-void fbrCreateStagingBuffer(const FbrVulkan *pVulkan,
-                            const void *srcData,
-                            VkBuffer *stagingBuffer,
-                            VkDeviceMemory *stagingBufferMemory,
-                            VkDeviceSize bufferSize) {
-    createAllocBindBuffer(pVulkan,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          bufferSize,
-                          false,
-                          stagingBuffer,
-                          stagingBufferMemory);
-
-    void *dstData;
-    vkMapMemory(pVulkan->device, *stagingBufferMemory, 0, bufferSize, 0, &dstData);
-    memcpy(dstData, srcData, bufferSize);
-    vkUnmapMemory(pVulkan->device, *stagingBufferMemory);
-
-    // Flush the memory range
-    // If the memory type of stagingMemory includes VK_MEMORY_PROPERTY_HOST_COHERENT, skip this step
-}
-
 void fbrCreatePopulateBufferViaStaging(const FbrVulkan *pVulkan,
                                        const void *srcData,
                                        VkBufferUsageFlagBits usage,
                                        VkBuffer *buffer,
-                                       VkDeviceMemory *bufferMemory,
+                                       FbrAllocation *pBufferAllocation,
                                        VkDeviceSize bufferSize) {
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    fbrCreateStagingBuffer(pVulkan,
-                           srcData,
-                           &stagingBuffer,
-                           &stagingBufferMemory,
-                           bufferSize);
-
     createAllocBindBuffer(pVulkan,
                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
                           VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
                           bufferSize,
                           false,
                           buffer,
-                          bufferMemory);
-
-    fbrCopyBuffer(pVulkan, stagingBuffer, *buffer, bufferSize);
-
-    vkDestroyBuffer(pVulkan->device, stagingBuffer, NULL);
-    vkFreeMemory(pVulkan->device, stagingBufferMemory, NULL);
+                          pBufferAllocation);
+
+    // only vertex and index buffers go through here right now
+    fbrUploadBuffer(pVulkan,
+                    srcData,
+                    *buffer,
+                    bufferSize,
+                    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+                    NULL);
 }
 
 FBR_RESULT fbrCreateUBO(const FbrVulkan *pVulkan,
@@ -402,16 +359,11 @@ FBR_RESULT fbrCreateUBO(const FbrVulkan *pVulkan,
                                   bufferSize ,
                                   external,
                                   &pUBO->uniformBuffer,
-                                  &pUBO->uniformBufferMemory));
-    FBR_ACK(vkMapMemory(pVulkan->device,
-                        pUBO->uniformBufferMemory,
-                        0,
-                        bufferSize ,
-                        0,
-                        &pUBO->pUniformBufferMapped));
+                                  &pUBO->uniformBufferAllocation));
+    pUBO->pUniformBufferMapped = pUBO->uniformBufferAllocation.pMapped;
     if (external) {
         FBR_ACK(getExternalHandle(pVulkan,
-                                  &pUBO->uniformBufferMemory,
+                                  &pUBO->uniformBufferAllocation.memory,
                                   &pUBO->externalMemory));
     }
     return FBR_SUCCESS;
@@ -431,13 +383,14 @@ void fbrImportUBO(const FbrVulkan *pVulkan,
                  bufferSize,
                  externalMemory,
                  &pUBO->uniformBuffer,
-                 &pUBO->uniformBufferMemory);
+                 &pUBO->uniformBufferAllocation);
     vkMapMemory(pVulkan->device,
-                pUBO->uniformBufferMemory,
+                pUBO->uniformBufferAllocation.memory,
                 0,
                 bufferSize,
                 0,
-                &pUBO->pUniformBufferMapped);
+                &pUBO->uniformBufferAllocation.pMapped);
+    pUBO->pUniformBufferMapped = pUBO->uniformBufferAllocation.pMapped;
     pUBO->externalMemory = externalMemory;
     // don't need to set or map anything because parent does it!
 }
@@ -445,13 +398,80 @@ void fbrImportUBO(const FbrVulkan *pVulkan,
 void fbrDestroyUBO(const FbrVulkan *pVulkan, FbrUniformBufferObject *pUBO) {
     vkDestroyBuffer(pVulkan->device, pUBO->uniformBuffer, NULL);
 
-    if (pUBO->pUniformBufferMapped != NULL)
-        vkUnmapMemory(pVulkan->device, pUBO->uniformBufferMemory);
-
-    vkFreeMemory(pVulkan->device, pUBO->uniformBufferMemory, NULL);
+    // dedicated memory is unmapped by the free, pooled blocks stay mapped
+    fbrFreeMemory(pVulkan, &pUBO->uniformBufferAllocation);
 
     if (pUBO->externalMemory != NULL)
         CloseHandle(pUBO->externalMemory);
 
     free(pUBO);
+}
+
+VkResult fbrCreateDynamicUBO(const FbrVulkan *pVulkan,
+                             VkDeviceSize slotSize,
+                             uint32_t slotCount,
+                             FbrDynamicUniformBufferObject **ppAllocDynamicUBO) {
+    *ppAllocDynamicUBO = calloc(1, sizeof(FbrDynamicUniformBufferObject));
+    FbrDynamicUniformBufferObject *pDynamicUBO = *ppAllocDynamicUBO;
+    setDynamicAlignment(pVulkan, slotSize, slotCount, pDynamicUBO);
+    FBR_ACK(createAllocBindBuffer(pVulkan,
+                                  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                  VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                  pDynamicUBO->bufferSize,
+                                  false,
+                                  &pDynamicUBO->uniformBuffer,
+                                  &pDynamicUBO->uniformBufferAllocation));
+    pDynamicUBO->pUniformBufferMapped = pDynamicUBO->uniformBufferAllocation.pMapped;
+    pDynamicUBO->pSlotData = calloc(1, pDynamicUBO->frameSize);
+    return FBR_SUCCESS;
+}
+
+void fbrDestroyDynamicUBO(const FbrVulkan *pVulkan, FbrDynamicUniformBufferObject *pDynamicUBO) {
+    vkDestroyBuffer(pVulkan->device, pDynamicUBO->uniformBuffer, NULL);
+    fbrFreeMemory(pVulkan, &pDynamicUBO->uniformBufferAllocation);
+    arrfree(pDynamicUBO->pFreeSlots);
+    free(pDynamicUBO->pSlotData);
+    free(pDynamicUBO);
+}
+
+VkResult fbrAcquireDynamicUBOSlot(FbrDynamicUniformBufferObject *pDynamicUBO, VkDeviceSize size, FbrDynamicSlot *pSlot) {
+    if (size > pDynamicUBO->dynamicAlignment) {
+        FBR_LOG_ERROR("Dynamic UBO slot too small!");
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    if (arrlen(pDynamicUBO->pFreeSlots) > 0) {
+        pSlot->index = arrpop(pDynamicUBO->pFreeSlots);
+    } else if (pDynamicUBO->usedCount < pDynamicUBO->dynamicCount) {
+        pSlot->index = pDynamicUBO->usedCount++;
+    } else {
+        FBR_LOG_ERROR("Dynamic UBO out of slots!");
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    pSlot->pData = pDynamicUBO->pSlotData + (VkDeviceSize) pSlot->index * pDynamicUBO->dynamicAlignment;
+    memset(pSlot->pData, 0, pDynamicUBO->dynamicAlignment);
+    return FBR_SUCCESS;
+}
+
+void fbrReleaseDynamicUBOSlot(FbrDynamicUniformBufferObject *pDynamicUBO, FbrDynamicSlot *pSlot) {
+    if (pSlot->pData == NULL)
+        return;
+
+    arrput(pDynamicUBO->pFreeSlots, pSlot->index);
+    *pSlot = (FbrDynamicSlot) {};
+}
+
+uint32_t fbrGetDynamicUBOOffset(const FbrDynamicUniformBufferObject *pDynamicUBO, const FbrDynamicSlot *pSlot) {
+    return pDynamicUBO->frameIndex * pDynamicUBO->frameSize + pSlot->index * pDynamicUBO->dynamicAlignment;
+}
+
+void fbrBeginDynamicUBOFrame(FbrDynamicUniformBufferObject *pDynamicUBO) {
+    pDynamicUBO->frameIndex = (pDynamicUBO->frameIndex + 1) % FBR_DYNAMIC_UBO_FRAME_COUNT;
+}
+
+void fbrFlushDynamicUBO(const FbrDynamicUniformBufferObject *pDynamicUBO) {
+    memcpy(pDynamicUBO->pUniformBufferMapped + pDynamicUBO->frameIndex * pDynamicUBO->frameSize,
+           pDynamicUBO->pSlotData,
+           (VkDeviceSize) pDynamicUBO->usedCount * pDynamicUBO->dynamicAlignment);
 }
\ No newline at end of file
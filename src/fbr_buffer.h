@@ -2,6 +2,7 @@
 #define FABRIC_BUFFER_H
 
 #include "fbr_app.h"
+#include "fbr_memory.h"
 
 #if WIN32
 #include <windows.h>
@@ -24,24 +25,40 @@
 
 typedef struct FbrUniformBufferObject {
     VkBuffer uniformBuffer;
-    VkDeviceMemory uniformBufferMemory;
+    FbrAllocation uniformBufferAllocation;
     void *pUniformBufferMapped;
 #ifdef WIN32
     HANDLE externalMemory; // Todo get rid of HANDLE with additional type FbrExternalUniformBufferObject
 #endif
 } FbrUniformBufferObject;
 
-//typedef struct FbrDynamicUniformBufferObject {
-//    VkBuffer uniformBuffer;
-//    VkDeviceMemory uniformBufferMemory;
-//    void *pUniformBufferMapped;
-//    uint32_t bufferSize;
-//    uint32_t dynamicAlignment;
-//    uint32_t dynamicCount;
-//#ifdef WIN32
-//    HANDLE externalMemory;
-//#endif
-//} FbrDynamicUniformBufferObject;
+// One mapped buffer holding every transform and camera, bound with dynamic offsets.
+// Each frame gets its own region so the CPU never writes what the GPU may still read.
+#define FBR_DYNAMIC_UBO_FRAME_COUNT 2
+#define FBR_DYNAMIC_UBO_SLOT_SIZE 512
+#define FBR_DYNAMIC_UBO_SLOT_COUNT 4096
+
+typedef struct FbrDynamicUniformBufferObject {
+    VkBuffer uniformBuffer;
+    FbrAllocation uniformBufferAllocation;
+    uint8_t *pUniformBufferMapped;
+    // updates land here and are copied to the frame region in one go by fbrFlushDynamicUBO
+    uint8_t *pSlotData;
+    VkDeviceSize bufferSize;
+    VkDeviceSize frameSize;
+    uint32_t dynamicAlignment;
+    uint32_t dynamicCount;
+    uint32_t frameIndex;
+    // slots below this have been handed out at some point, only this range gets copied
+    uint32_t usedCount;
+    // stb_ds array of released slots
+    uint32_t *pFreeSlots;
+} FbrDynamicUniformBufferObject;
+
+typedef struct FbrDynamicSlot {
+    uint32_t index;
+    void *pData;
+} FbrDynamicSlot;
 
 VkResult fbrImageMemoryTypeFromProperties(const FbrVulkan *pVulkan,
                                           VkImage image,
@@ -73,17 +90,11 @@ void fbrCopyBuffer(const FbrVulkan *pVulkan, VkBuffer srcBuffer, VkBuffer dstBuf
 
 void fbrMemCopyMappedUBO(const FbrUniformBufferObject *pDstUBO, const void* pSrcData, size_t size);
 
-void fbrCreateStagingBuffer(const FbrVulkan *pVulkan,
-                            const void *srcData,
-                            VkBuffer *stagingBuffer,
-                            VkDeviceMemory *stagingBufferMemory,
-                            VkDeviceSize bufferSize);
-
 void fbrCreatePopulateBufferViaStaging(const FbrVulkan *pVulkan,
                                        const void *srcData,
                                        VkBufferUsageFlagBits usage,
                                        VkBuffer *buffer,
-                                       VkDeviceMemory *bufferMemory,
+                                       FbrAllocation *pBufferAllocation,
                                        VkDeviceSize bufferSize);
 
 VkResult fbrCreateUBO(const FbrVulkan *pVulkan,
@@ -102,4 +113,22 @@ void fbrImportUBO(const FbrVulkan *pVulkan,
 
 void fbrDestroyUBO(const FbrVulkan *pVulkan, FbrUniformBufferObject *pUBO);
 
+VkResult fbrCreateDynamicUBO(const FbrVulkan *pVulkan,
+                             VkDeviceSize slotSize,
+                             uint32_t slotCount,
+                             FbrDynamicUniformBufferObject **ppAllocDynamicUBO);
+
+void fbrDestroyDynamicUBO(const FbrVulkan *pVulkan, FbrDynamicUniformBufferObject *pDynamicUBO);
+
+VkResult fbrAcquireDynamicUBOSlot(FbrDynamicUniformBufferObject *pDynamicUBO, VkDeviceSize size, FbrDynamicSlot *pSlot);
+
+void fbrReleaseDynamicUBOSlot(FbrDynamicUniformBufferObject *pDynamicUBO, FbrDynamicSlot *pSlot);
+
+// Offset to pass to vkCmdBindDescriptorSets, only valid for the frame being recorded.
+uint32_t fbrGetDynamicUBOOffset(const FbrDynamicUniformBufferObject *pDynamicUBO, const FbrDynamicSlot *pSlot);
+
+void fbrBeginDynamicUBOFrame(FbrDynamicUniformBufferObject *pDynamicUBO);
+
+void fbrFlushDynamicUBO(const FbrDynamicUniformBufferObject *pDynamicUBO);
+
 #endif //FABRIC_BUFFER_H
@@ -2,13 +2,42 @@
 #include "fbr_buffer.h"
 #include "fbr_log.h"
 #include "fbr_vulkan.h"
+#include "fbr_trace.h"
 
 #include <windows.h>
 
 void fbrUpdateCameraUBO(FbrCamera *pCamera)
 {
     fbrUpdateTransformUBO(pCamera->pTransform);
-    memcpy(pCamera->pUBO->pUniformBufferMapped, &pCamera->bufferData, sizeof(FbrCameraBuffer));
+    memcpy(pCamera->uboSlot.pData, &pCamera->bufferData, sizeof(FbrCameraBuffer));
+}
+
+void fbrUpdateCameraUBOPredicted(FbrCamera *pCamera, int64_t targetTimestamp)
+{
+    fbrUpdateTransformUBO(pCamera->pTransform);
+    FbrCameraBuffer bufferData = pCamera->bufferData;
+    fbrGetPredictedCameraView(pCamera, targetTimestamp, bufferData.view, bufferData.invView);
+    memcpy(pCamera->uboSlot.pData, &bufferData, sizeof(FbrCameraBuffer));
+}
+
+void fbrRecordCameraPose(FbrCamera *pCamera, int64_t timestamp)
+{
+    if (!pCamera->predictPose)
+        return;
+    fbrPushPoseSample(&pCamera->posePredictor, timestamp, pCamera->pTransform->pos, pCamera->pTransform->rot);
+}
+
+void fbrGetPredictedCameraView(const FbrCamera *pCamera, int64_t targetTimestamp, mat4 view, mat4 invView)
+{
+    vec3 pos;
+    versor rot;
+    if (!pCamera->predictPose || !fbrPredictPose(&pCamera->posePredictor, targetTimestamp, pos, rot)) {
+        glm_mat4_copy((vec4 *) pCamera->bufferData.view, view);
+        glm_mat4_copy((vec4 *) pCamera->bufferData.invView, invView);
+        return;
+    }
+    glm_quat_look(pos, rot, view);
+    glm_mat4_inv(view, invView);
 }
 
 void fbrUpdateCamera(FbrCamera *pCamera, const FbrInputEvent *pInputEvent, const FbrTime *pTimeState) {
@@ -77,6 +106,9 @@ FBR_RESULT fbrImportCamera(const FbrVulkan *pVulkan,
                  sizeof(FbrCamera),
                  externalMemory,
                  &pCamera->pUBO);
+    FBR_ACK(fbrAcquireDynamicUBOSlot(pVulkan->pDynamicUBO,
+                                     sizeof(FbrCameraBuffer),
+                                     &pCamera->uboSlot));
     fbrUpdateTransformUBO(pCamera->pTransform);
     return FBR_SUCCESS;
 }
@@ -93,18 +125,19 @@ FBR_RESULT fbrCreateCamera(const FbrVulkan *pVulkan,
     glm_quatv(pCamera->pTransform->rot, glm_rad(-180), GLM_YUP);
     glm_perspective(FBR_CAMERA_FOV, pVulkan->screenFOV, FBR_CAMERA_NEAR_DEPTH, FBR_CAMERA_FAR_DEPTH, pCamera->bufferData.proj);
     glm_mat4_inv(pCamera->bufferData.proj, pCamera->bufferData.invProj);
-    FBR_ACK(fbrCreateUBO(pVulkan,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                         sizeof(FbrCamera),
-                         false,
-                         &pCamera->pUBO));
+    fbrInitPosePredictor(&pCamera->posePredictor, fbrGetTraceFrequency());
+    FBR_ACK(fbrAcquireDynamicUBOSlot(pVulkan->pDynamicUBO,
+                                     sizeof(FbrCameraBuffer),
+                                     &pCamera->uboSlot));
     fbrUpdateTransformUBO(pCamera->pTransform);
     fbrUpdateCameraUBO(pCamera);
     return FBR_SUCCESS;
 }
 
 void fbrDestroyCamera(const FbrVulkan *pVulkan, FbrCamera *pCameraState) {
-    fbrDestroyUBO(pVulkan, pCameraState->pUBO);
+    if (pCameraState->pUBO != NULL)
+        fbrDestroyUBO(pVulkan, pCameraState->pUBO);
+    fbrReleaseDynamicUBOSlot(pVulkan->pDynamicUBO, &pCameraState->uboSlot);
+    fbrDestroyTransform(pVulkan, pCameraState->pTransform);
     free(pCameraState);
 }
\ No newline at end of file
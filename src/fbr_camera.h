@@ -5,6 +5,7 @@
 #include "fbr_input.h"
 #include "fbr_transform.h"
 #include "fbr_buffer.h"
+#include "fbr_pose_predictor.h"
 #include "fbr_cglm.h"
 
 #define FBR_CAMERA_NEAR_DEPTH 0.0001f
@@ -23,11 +24,25 @@ typedef struct FbrCameraBuffer {
 typedef struct FbrCamera {
     FbrTransform *pTransform;
     FbrCameraBuffer bufferData;
+    FbrDynamicSlot uboSlot;
+    // only for cameras imported from a parent process, which writes it directly
     FbrUniformBufferObject *pUBO;
+    // views handed out for a target time are extrapolated from posePredictor
+    bool predictPose;
+    FbrPosePredictor posePredictor;
 } FbrCamera;
 
 void fbrUpdateCameraUBO(FbrCamera *pCamera);
 
+// Like fbrUpdateCameraUBO but the view written is the one expected at targetTimestamp.
+void fbrUpdateCameraUBOPredicted(FbrCamera *pCamera, int64_t targetTimestamp);
+
+// Call once the frame's input is applied to the transform.
+void fbrRecordCameraPose(FbrCamera *pCamera, int64_t timestamp);
+
+// The current view unless predictPose is set and there is enough pose history.
+void fbrGetPredictedCameraView(const FbrCamera *pCamera, int64_t targetTimestamp, mat4 view, mat4 invView);
+
 void fbrUpdateCamera(FbrCamera *pCamera,
                      const FbrInputEvent *pInputEvent,
                      const FbrTime *pTimeState);
@@ -11,10 +11,24 @@
 #include "fbr_descriptors.h"
 #include "fbr_swap.h"
 #include "fbr_ipc.h"
+#include "fbr_upload.h"
+#include "fbr_asset_loader.h"
+#include "fbr_descriptor_allocator.h"
+#include "fbr_profiler.h"
+#include "fbr_trace.h"
+#include "fbr_benchmark.h"
 #include "fbr_cglm.h"
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <float.h>
+
+// frames each reprojection geometry runs for when calibrating, warmup frames are not timed
+#define FBR_CALIBRATION_WARMUP_FRAME_COUNT 30
+#define FBR_CALIBRATION_FRAME_COUNT 120
+// a geometry reprojecting node frames older than this on average is too slow to keep up, whatever its frame time.
+// Ages are in compositor presents, 2 is a fresh frame every present, 2.5 is the node at half the compositor's rate.
+#define FBR_CALIBRATION_MAX_FRAME_AGE 2.5f
 
 static void waitForTimeLine(FbrVulkan *pVulkan, FbrTimelineSemaphore *pTimelineSemaphore) {
     const VkSemaphoreWaitInfo semaphoreWaitInfo = {
@@ -25,7 +39,10 @@ static void waitForTimeLine(FbrVulkan *pVulkan, FbrTimelineSemaphore *pTimelineS
             .pSemaphores = &pTimelineSemaphore->semaphore,
             .pValues = &pTimelineSemaphore->waitValue,
     };
+    fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "wait", pTimelineSemaphore->waitValue);
+    fbrTraceBegin("semaphore wait");
     FBR_ACK_EXIT(vkWaitSemaphores(pVulkan->device, &semaphoreWaitInfo, UINT64_MAX));
+    fbrTraceEnd("semaphore wait");
 }
 
 static void processInputFrame(FbrApp *pApp) {
@@ -124,9 +141,10 @@ static void submitQueue(const FbrVulkan *pVulkan, FbrTimelineSemaphore *pSemapho
                                 1,
                                 &submitInfo,
                                 VK_NULL_HANDLE));
+    fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "signal", signalValue);
 }
 
-static void submitQueueAndPresent(FbrVulkan *pVulkan, const FbrSwap *pSwap, FbrTimelineSemaphore *pSemaphore, uint32_t swapIndex) {
+static void submitQueueAndPresent(FbrVulkan *pVulkan, FbrSwap *pSwap, FbrTimelineSemaphore *pSemaphore, uint32_t swapIndex) {
     // https://www.khronos.org/blog/vulkan-timeline-semaphores
     const uint64_t waitValue = pSemaphore->waitValue;
     pSemaphore->waitValue++;
@@ -174,17 +192,12 @@ static void submitQueueAndPresent(FbrVulkan *pVulkan, const FbrSwap *pSwap, FbrT
                                1,
                                &submitInfo,
                                VK_NULL_HANDLE));
+    fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "signal", signalValue);
 
-    // TODO want to use this?? https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VK_KHR_present_id.html
-    const VkPresentInfoKHR presentInfo = {
-            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &pSwap->renderCompleteSemaphore,
-            .swapchainCount = 1,
-            .pSwapchains = &pSwap->swapChain,
-            .pImageIndices = &swapIndex,
-    };
-    FBR_ACK_EXIT(vkQueuePresentKHR(pVulkan->graphicsQueue, &presentInfo));
+    // tagged with a present id when supported so the next frame can be paced off it
+    fbrTraceBegin("present");
+    FBR_ACK_EXIT(fbrPresentSwap(pVulkan, pSwap, pVulkan->graphicsQueue, swapIndex));
+    fbrTraceEnd("present");
 }
 
 static void beginFrameCommandBuffer(FbrVulkan *pVulkan, VkExtent2D extent) {
@@ -210,6 +223,11 @@ static void beginFrameCommandBuffer(FbrVulkan *pVulkan, VkExtent2D extent) {
     vkCmdSetScissor(pVulkan->graphicsCommandBuffer, 0, 1, &scissor);
 }
 
+// Headless has no window, main only runs it with a frame count
+static bool shouldExit(const FbrApp *pApp) {
+    return pApp->exiting || (pApp->pWindow != NULL && glfwWindowShouldClose(pApp->pWindow));
+}
+
 static void updateTime(FbrTime *pTime)
 {
     pTime->currentTime = glfwGetTime();
@@ -217,6 +235,74 @@ static void updateTime(FbrTime *pTime)
     pTime->lastTime = pTime->currentTime;
 }
 
+// The camera slot only reaches the gpu visible ring in fbrFlushDynamicUBO right before submit, and everything
+// recorded this frame finds it by dynamic offset, so the pose can still change here rather than at frame start.
+// Input that arrived during recording is polled and applied for the time since the frame's updateTime, which
+// then counts the next frame from here so nothing is applied twice. The latched pose is recorded and written
+// predicted forward to the display time estimated now that recording is done.
+static void latchCameraPose(FbrApp *pApp)
+{
+    fbrTraceBegin("latch camera");
+    // the benchmark drives the camera itself, input would pull it off the path and a second sample of the
+    // same pose would read as the camera stopping
+    if (pApp->pBenchmark == NULL) {
+        updateTime(pApp->pTime);
+        processInputFrame(pApp);
+        fbrRecordCameraPose(pApp->pCamera, fbrGetTraceTimestamp());
+    }
+    fbrUpdateCameraUBOPredicted(pApp->pCamera, fbrGetSwapDisplayTimestamp(pApp->pSwap));
+    fbrTraceEnd("latch camera");
+}
+
+// Returns true if the node signalled a new frame, which the caller must then acquire into its queue family.
+// Also writes the camera the node renders its next frame with.
+static bool pollNodeFrame(FbrApp *pApp)
+{
+    FbrVulkan *pVulkan = pApp->pVulkan;
+    FbrNode *pTestNode = pApp->pTestNode;
+
+    // Retrieve semaphore timeline value of child node to see if rendering is complete
+    //TODO is reading the semaphore slower than just sharing CPU memory?
+    vkGetSemaphoreCounterValue(pVulkan->device,
+                               pTestNode->pChildSemaphore->semaphore,
+                               &pTestNode->pChildSemaphore->waitValue);
+    if (pTestNode->acquiredTimelineValue == pTestNode->pChildSemaphore->waitValue)
+        return false;
+
+    pTestNode->acquiredTimelineValue = pTestNode->pChildSemaphore->waitValue;
+    fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "node frame acquired", pTestNode->acquiredTimelineValue);
+    if (pApp->pBenchmark != NULL)
+        fbrBenchmarkNodeFrameAcquired(pApp->pBenchmark);
+    pTestNode->acquiredFramebufferIndex = (pTestNode->acquiredFramebufferIndex + 1) % FBR_NODE_FRAMEBUFFER_COUNT;
+
+    fbrNodeAcquireFrameStamp(pTestNode, pTestNode->acquiredFramebufferIndex);
+    fbrNodeUpdateCompositingCameraFromRenderingCamera(pTestNode);
+    fbrNodeUpdateCameraIPCFromCamera(pVulkan, pTestNode, pApp->pCamera);
+    fbrTraceInstant(FBR_TRACE_CATEGORY_IPC, "camera write", pTestNode->acquiredTimelineValue);
+    if (pApp->pBenchmark != NULL)
+        fbrBenchmarkNodeCameraWrite(pApp->pBenchmark);
+    return true;
+}
+
+// Call before a main loop starts, moves the node framebuffer the last loop was reprojecting onto this loop's queue family.
+static void claimNodeFramebuffer(FbrApp *pApp, uint32_t queueFamilyIndex)
+{
+    FbrVulkan *pVulkan = pApp->pVulkan;
+    FbrNode *pTestNode = pApp->pTestNode;
+
+    // nothing acquired yet, the first poll acquires from the node
+    if (pTestNode->acquiredQueueFamilyIndex == VK_QUEUE_FAMILY_IGNORED)
+        return;
+
+    if (pTestNode->acquiredQueueFamilyIndex != queueFamilyIndex) {
+        FBR_ACK_EXIT(fbrTransferFramebufferReadImmediate(pVulkan,
+                                                         pTestNode->pFramebuffers[pTestNode->acquiredFramebufferIndex],
+                                                         pTestNode->acquiredQueueFamilyIndex,
+                                                         queueFamilyIndex));
+    }
+    pTestNode->acquiredQueueFamilyIndex = queueFamilyIndex;
+}
+
 static void childMainLoop(FbrApp *pApp)
 {
     int exitCounter = 0;
@@ -237,18 +323,29 @@ static void childMainLoop(FbrApp *pApp)
 
     uint8_t timelineSwitch = 0;
 
-    while (!glfwWindowShouldClose(pApp->pWindow) && !pApp->exiting) {
+    while (!shouldExit(pApp)) {
 //        FBR_LOG_DEBUG("Child FPS", 1.0 / pApp->pTime->deltaTime);
+        fbrTraceBegin("node frame");
 
         updateTime(pTime);
 
+        // Anything recorded to the upload queue goes out ahead of this frames graphics submit
+        fbrUpdateAssetLoader(pVulkan);
+        fbrSubmitUploads(pVulkan, NULL);
+
+        fbrBeginDynamicUBOFrame(pVulkan->pDynamicUBO);
+        fbrBeginProfilerFrame(pVulkan);
+
         // Update to current parent time, don't let it go faster than parent allows.
         vkGetSemaphoreCounterValue(pVulkan->device, pParentSemaphore->semaphore, &pParentSemaphore->waitValue);
 
         beginFrameCommandBuffer(pVulkan, pApp->pFramebuffers[timelineSwitch]->pColorTexture->extent);
 
         // Receive camera transform over CPU IPC from parent
-        FbrNodeCamera *pCameraIPCBuffer = pApp->pNodeParent->pCameraIPCBuffer->pBuffer;
+        FbrNodeCameraIPC *pCameraIPC = pApp->pNodeParent->pCameraIPCBuffer->pBuffer;
+        FbrNodeCamera *pCameraIPCBuffer = &pCameraIPC->camera;
+        const FbrNodeFrameStamp renderingStamp = pCameraIPCBuffer->stamp;
+        fbrTraceInstant(FBR_TRACE_CATEGORY_IPC, "camera read", renderingStamp.frameID);
         glm_mat4_copy(pCameraIPCBuffer->view, pCamera->bufferData.view);
         glm_mat4_copy(pCameraIPCBuffer->invView, pCamera->bufferData.invView);
         glm_mat4_copy(pCameraIPCBuffer->proj, pCamera->bufferData.proj);
@@ -265,8 +362,11 @@ static void childMainLoop(FbrApp *pApp)
         fbrUpdateCameraUBO(pCamera);
 
         // Acquire Framebuffer Ownership
+        fbrBeginProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_BARRIERS);
         fbrAcquireFramebufferFromExternalToGraphicsAttach(pVulkan, pApp->pFramebuffers[timelineSwitch]);
+        fbrEndProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_BARRIERS);
 
+        fbrBeginProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_CHILD_RENDER);
         beginRenderPassImageless(pVulkan,
                                  pApp->pFramebuffers[timelineSwitch],
                                  pVulkan->renderPass,
@@ -274,15 +374,15 @@ static void childMainLoop(FbrApp *pApp)
         vkCmdBindPipeline(pVulkan->graphicsCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelines->graphicsPipeStandard);
 
         // Global
-//        uint32_t zeroOffset = 0;
+        const uint32_t cameraOffset = fbrGetDynamicUBOOffset(pVulkan->pDynamicUBO, &pCamera->uboSlot);
         vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 pPipelines->graphicsPipeLayoutStandard,
                                 FBR_GLOBAL_SET_INDEX,
                                 1,
                                 &pDescriptors->setGlobal,
-                                0,
-                                NULL);
+                                1,
+                                &cameraOffset);
 //        // Pass
 //        vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
 //                                VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -292,33 +392,39 @@ static void childMainLoop(FbrApp *pApp)
 //                                &pDescriptors->setPass,
 //                                0,
 //                                NULL);
-        // Material
+        // Textures
         vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 pPipelines->graphicsPipeLayoutStandard,
-                                FBR_MATERIAL_SET_INDEX,
+                                FBR_TEXTURES_SET_INDEX,
                                 1,
-                                &pApp->testQuadMaterialSet,
+                                &pDescriptors->setTextures,
                                 0,
                                 NULL);
+        fbrPushTextureIndices(pVulkan->graphicsCommandBuffer,
+                              pPipelines->graphicsPipeLayoutStandard,
+                              &(FbrTextureIndices) {.colorIndex = pApp->testQuadTextureIndex});
         //cube 1
-        vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                pPipelines->graphicsPipeLayoutStandard,
-                                FBR_OBJECT_SET_INDEX,
-                                1,
-                                &pApp->testQuadObjectSet,
-                                0,
-                                NULL);
+        fbrPushSetObject(pVulkan,
+                         pVulkan->graphicsCommandBuffer,
+                         pPipelines->graphicsPipeLayoutStandard,
+                         pApp->pTestQuadTransform);
         recordRenderMesh(pVulkan,
                          pApp->pTestQuadMesh);
         // end framebuffer pass
         vkCmdEndRenderPass(pVulkan->graphicsCommandBuffer);
+        fbrEndProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_CHILD_RENDER);
 
         fbrReleaseFramebufferFromGraphicsAttachToExternalRead(pVulkan, pApp->pFramebuffers[timelineSwitch]);
 
         FBR_ACK_EXIT(vkEndCommandBuffer(pVulkan->graphicsCommandBuffer));
 
+        fbrFlushDynamicUBO(pVulkan->pDynamicUBO);
+
+        // the compositor reads this once it sees the signal below
+        pCameraIPC->pRenderedStamps[timelineSwitch] = renderingStamp;
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
         submitQueue(pVulkan, pChildSemaphore);
 
         // Add step to parent and wait on both child and parent
@@ -331,9 +437,13 @@ static void childMainLoop(FbrApp *pApp)
                 .pValues = (const uint64_t[]) {pParentSemaphore->waitValue,
                                                pChildSemaphore->waitValue}
         };
-        FBR_ACK_EXIT(vkWaitSemaphores(pVulkan->device, &releaseSemaphoreWaitInfo, UINT64_MAX));\
+        fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "wait", pChildSemaphore->waitValue);
+        fbrTraceBegin("semaphore wait");
+        FBR_ACK_EXIT(vkWaitSemaphores(pVulkan->device, &releaseSemaphoreWaitInfo, UINT64_MAX));
+        fbrTraceEnd("semaphore wait");
 
         timelineSwitch = (timelineSwitch + 1) % 2;
+        fbrTraceEnd("node frame");
 
 //        exitCounter++;
 //        if (exitCounter > 2) {
@@ -343,7 +453,8 @@ static void childMainLoop(FbrApp *pApp)
 }
 
 
-static void parentMainLoopComputeComposite(FbrApp *pApp) {
+// Runs until the window closes, or for frameCount frames if it is not 0
+static void parentMainLoopComputeComposite(FbrApp *pApp, uint32_t frameCount) {
     FbrVulkan *pVulkan = pApp->pVulkan;
     FbrSwap *pSwap = pApp->pSwap;
     FbrTimelineSemaphore *pMainTimelineSemaphore = pVulkan->pMainTimelineSemaphore;
@@ -353,46 +464,40 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
     FbrDescriptors *pDescriptors = pApp->pDescriptors;
     FbrNode *pTestNode = pApp->pTestNode;
 
-    uint64_t priorChildTimeline = 0;
-    uint8_t testNodeTimelineSwitch = 1;
-    uint8_t mainFrameBufferIndex = 0;
-
     VkExtent2D extents = pSwap->extent;
 
-    while (!glfwWindowShouldClose(pApp->pWindow) && !pApp->exiting) {
+    claimNodeFramebuffer(pApp, pVulkan->computeQueueFamilyIndex);
+
+    for (uint32_t frame = 0;
+         (frameCount == 0 || frame < frameCount) && !shouldExit(pApp);
+         ++frame) {
 //        FBR_LOG_DEBUG("Parent FPS", 1.0f / pTime->deltaTime);
+        fbrTraceBegin("compositor frame");
+
+        // first so everything sampled this frame is as late as pacing allows
+        fbrBeginSwapFrame(pVulkan, pSwap);
 
         updateTime(pTime);
 
-        processInputFrame(pApp);
+        fbrUpdateAssetLoader(pVulkan);
+        fbrSubmitUploads(pVulkan, NULL);
 
-        beginFrameCommandBuffer(pVulkan, extents);
+        fbrBeginDynamicUBOFrame(pVulkan->pDynamicUBO);
+        fbrBeginProfilerFrame(pVulkan);
+
+        processInputFrame(pApp);
+        if (pApp->pBenchmark != NULL)
+            fbrBeginBenchmarkFrame(pApp->pBenchmark, pVulkan, pCamera);
+        fbrRecordCameraPose(pCamera, fbrGetTraceTimestamp());
 
         fbrUpdateCameraUBO(pCamera);
 
         // -------------------------------------------------------------------------------------------------------------
-        // Retrieve semaphore timeline value of child node to see if rendering is complete
-        //TODO is reading the semaphore slower than just sharing CPU memory?
-        vkGetSemaphoreCounterValue(pVulkan->device,
-                                   pTestNode->pChildSemaphore->semaphore,
-                                   &pTestNode->pChildSemaphore->waitValue);
-        if (priorChildTimeline != pTestNode->pChildSemaphore->waitValue) {
-            priorChildTimeline = pTestNode->pChildSemaphore->waitValue;
-            testNodeTimelineSwitch = (testNodeTimelineSwitch + 1) % 2;
-
-            fbrAcquireFramebufferFromExternalAttachToComputeRead(pVulkan,pTestNode->pFramebuffers[testNodeTimelineSwitch]);
-            fbrNodeUpdateCompositingCameraFromRenderingCamera(pTestNode);
-            fbrNodeUpdateCameraIPCFromCamera(pVulkan, pTestNode, pCamera);
-        }
+        const bool nodeFrameAcquired = pollNodeFrame(pApp);
 
         // Acquire Compute Swap
         uint32_t swapIndex;
-        FBR_ACK_EXIT(vkAcquireNextImageKHR(pVulkan->device,
-                                           pSwap->swapChain,
-                                           UINT64_MAX,
-                                           pSwap->acquireCompleteSemaphore,
-                                           VK_NULL_HANDLE,
-                                           &swapIndex));
+        FBR_ACK_EXIT(fbrAcquireSwap(pVulkan, pSwap, &swapIndex));
 
         // Begin Compute Command Buffer
         FBR_ACK_EXIT(vkResetCommandBuffer(pVulkan->computeCommandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT));
@@ -401,14 +506,18 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
         };
         FBR_ACK_EXIT(vkBeginCommandBuffer(pVulkan->computeCommandBuffer, &computeBeginInfo));
 
-        // Acquire framebuffers
-        fbrAcquireFramebufferFromGraphicsAttachToComputeRead(pVulkan, pApp->pFramebuffers[mainFrameBufferIndex]);
+        // Acquire framebuffers, the node's from its queue, the parent renders nothing of its own here
+        fbrBeginProfilerZone(pVulkan, pVulkan->computeCommandBuffer, FBR_PROFILER_ZONE_BARRIERS);
+        if (nodeFrameAcquired) {
+            fbrAcquireFramebufferFromExternalAttachToComputeRead(pVulkan, pTestNode->pFramebuffers[pTestNode->acquiredFramebufferIndex]);
+            pTestNode->acquiredQueueFamilyIndex = pVulkan->computeQueueFamilyIndex;
+        }
         const VkImageMemoryBarrier pTransitionBlitBarrier[] = {
                 {
                         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
                         .srcAccessMask = 0,
                         .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
-                        .oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                        .oldLayout = pSwap->presentLayout,
                         .newLayout = VK_IMAGE_LAYOUT_GENERAL,
                         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
@@ -423,28 +532,38 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
                              0, NULL,
                              0, NULL,
                              COUNT(pTransitionBlitBarrier), pTransitionBlitBarrier);
+        fbrEndProfilerZone(pVulkan, pVulkan->computeCommandBuffer, FBR_PROFILER_ZONE_BARRIERS);
 
-        // Set descriptor sets
+        // Until the node's first frame there is nothing readable to composite
+        const bool hasNodeFrame = pTestNode->acquiredQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED;
+
+        // Set descriptor sets, prebuilt so this is only a lookup
         FbrSetComputeComposite setComposite;
-        fbrCreateSetComputeComposite(pApp->pVulkan,
-                              pApp->pDescriptors,
-                              pApp->pFramebuffers[mainFrameBufferIndex]->pColorTexture->imageView,
-                              pApp->pFramebuffers[mainFrameBufferIndex]->pNormalTexture->imageView,
-                              pApp->pFramebuffers[mainFrameBufferIndex]->pGBufferTexture->imageView,
-                              pApp->pFramebuffers[mainFrameBufferIndex]->pDepthTexture->imageView,
-                              pSwap->pSwapImageViews[swapIndex],
-                              &setComposite);
+        fbrGetSetComputeComposite(pApp->pVulkan,
+                                  pApp->pDescriptors,
+                                  pTestNode->acquiredFramebufferIndex,
+                                  swapIndex,
+                                  pTestNode->pFramebuffers[pTestNode->acquiredFramebufferIndex],
+                                  pSwap->pSwapImageViews[swapIndex],
+                                  &setComposite);
+        FbrComputePipeComposite compositePipe;
+        fbrGetComputePipeComposite(pVulkan,
+                                   pPipelines,
+                                   extents,
+                                   pPipelines->compositeLocalSize,
+                                   &compositePipe);
         vkCmdBindPipeline(pVulkan->computeCommandBuffer,
                           VK_PIPELINE_BIND_POINT_COMPUTE,
-                          pApp->pPipelines->computePipeComposite);
+                          compositePipe);
+        const uint32_t cameraOffset = fbrGetDynamicUBOOffset(pVulkan->pDynamicUBO, &pCamera->uboSlot);
         vkCmdBindDescriptorSets(pVulkan->computeCommandBuffer,
                                 VK_PIPELINE_BIND_POINT_COMPUTE,
                                 pApp->pPipelines->computePipeLayoutComposite,
                                 FBR_GLOBAL_SET_INDEX,
                                 1,
                                 &pDescriptors->setGlobal,
-                                0,
-                                NULL);
+                                1,
+                                &cameraOffset);
         vkCmdBindDescriptorSets(pVulkan->computeCommandBuffer,
                                 VK_PIPELINE_BIND_POINT_COMPUTE,
                                 pApp->pPipelines->computePipeLayoutComposite,
@@ -454,20 +573,25 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
                                 0,
                                 NULL);
 
-        // Dispatch compute timing queries
-        vkResetQueryPool(pVulkan->device, pVulkan->queryPool, 0, 2);
-        vkCmdWriteTimestamp(pVulkan->computeCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, pVulkan->queryPool, 0);
-        const int localSize = 32;
-        vkCmdDispatch(pVulkan->computeCommandBuffer, (extents.width / localSize), (extents.height / localSize), 1);
-        vkCmdWriteTimestamp(pVulkan->computeCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, pVulkan->queryPool, 1);
+        fbrBeginProfilerZone(pVulkan, pVulkan->computeCommandBuffer, FBR_PROFILER_ZONE_COMPOSITE);
+        // round up, the shader discards invocations past the edge
+        const VkExtent2D localSize = pPipelines->compositeLocalSize;
+        if (hasNodeFrame) {
+            vkCmdDispatch(pVulkan->computeCommandBuffer,
+                          (extents.width + localSize.width - 1) / localSize.width,
+                          (extents.height + localSize.height - 1) / localSize.height,
+                          1);
+        }
+        fbrEndProfilerZone(pVulkan, pVulkan->computeCommandBuffer, FBR_PROFILER_ZONE_COMPOSITE);
 
+        fbrBeginProfilerZone(pVulkan, pVulkan->computeCommandBuffer, FBR_PROFILER_ZONE_PRESENT_TRANSITION);
         const VkImageMemoryBarrier pTransitionEndBlitBarrier[] = {
                 {
                     .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
                     .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
                     .dstAccessMask = 0,
                     .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
-                    .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                    .newLayout = pSwap->presentLayout,
                     .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                     .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                     .image = pSwap->pSwapImages[swapIndex],
@@ -481,17 +605,20 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
                              0, NULL,
                              0, NULL,
                              COUNT(pTransitionEndBlitBarrier), pTransitionEndBlitBarrier);
+        fbrEndProfilerZone(pVulkan, pVulkan->computeCommandBuffer, FBR_PROFILER_ZONE_PRESENT_TRANSITION);
 
         FBR_ACK_EXIT(vkEndCommandBuffer(pVulkan->computeCommandBuffer));
         // End Compute Command Buffer
 
+        latchCameraPose(pApp);
+        fbrFlushDynamicUBO(pVulkan->pDynamicUBO);
+
         // Submit Compute
+        // the node frame was already signalled when it was polled, only the swap image is waited on
         const VkSemaphore pComputeWaitSemaphores[] = {
-                pApp->pFramebuffers[mainFrameBufferIndex]->renderCompleteSemaphore,
                 pSwap->acquireCompleteSemaphore,
         };
         const VkPipelineStageFlags pComputeWaitDstStageMask[] = {
-                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
         };
         pMainTimelineSemaphore->waitValue++;
@@ -515,7 +642,7 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
         const VkSubmitInfo computeSubmitInfo = {
                 .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
                 .pNext = &computeTimelineSemaphoreSubmitInfo,
-                .waitSemaphoreCount = 2,
+                .waitSemaphoreCount = COUNT(pComputeWaitSemaphores),
                 .pWaitSemaphores = pComputeWaitSemaphores,
                 .pWaitDstStageMask = pComputeWaitDstStageMask,
                 .commandBufferCount = 1,
@@ -527,21 +654,14 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
                                    1,
                                    &computeSubmitInfo,
                                    VK_NULL_HANDLE));
+        fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "signal", signalValue);
         // End Submit Compute
 
         // Submit Present
-        // TODO want to use id+wait ? Doesn't work on Quest 2.
-        // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VK_KHR_present_id.html
-        // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VK_KHR_present_wait.html
-        const VkPresentInfoKHR presentInfo = {
-                .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-                .waitSemaphoreCount = 1,
-                .pWaitSemaphores = &pSwap->renderCompleteSemaphore,
-                .swapchainCount = 1,
-                .pSwapchains = &pSwap->swapChain,
-                .pImageIndices = &swapIndex,
-        };
-        FBR_ACK_EXIT(vkQueuePresentKHR(pVulkan->computeQueue, &presentInfo));
+        // present id+wait are optional, Doesn't work on Quest 2.
+        fbrTraceBegin("present");
+        FBR_ACK_EXIT(fbrPresentSwap(pVulkan, pSwap, pVulkan->computeQueue, swapIndex));
+        fbrTraceEnd("present");
         // End Submit Present
 
         // Wait!
@@ -553,7 +673,10 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
                 .pSemaphores = &pMainTimelineSemaphore->semaphore,
                 .pValues = &pMainTimelineSemaphore->waitValue,
         };
+        fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "wait", pMainTimelineSemaphore->waitValue);
+        fbrTraceBegin("semaphore wait");
         FBR_ACK_EXIT(vkWaitSemaphores(pVulkan->device, &semaphoreWaitInfo, UINT64_MAX));
+        fbrTraceEnd("semaphore wait");
 
 
         // for some reason this fixes a bug with validation layers thinking the graphicsQueue hasnt finished
@@ -562,19 +685,121 @@ static void parentMainLoopComputeComposite(FbrApp *pApp) {
             FBR_ACK_EXIT(vkQueueWaitIdle(pVulkan->computeQueue));
         }
 
-        // log measured compute time
-//        uint64_t timestamps[2];
-//        vkGetQueryPoolResults(pVulkan->device, pVulkan->queryPool, 0, 2, sizeof(uint64_t) * 2, timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT );
-//        float ms = (float)(timestamps[1] - timestamps[0]) / 1000000.0f;
-//        FBR_LOG_DEBUG("Compute: ", ms);
+        fbrEndSwapFrame(pSwap);
+        // the frame's composite has finished on the gpu and its present is queued, the closest this gets to scanout
+        fbrNodeRecordPresent(pTestNode, fbrGetTraceTimestamp());
 
-        vkFreeDescriptorSets(pVulkan->device, pVulkan->descriptorPool, 1, &setComposite);
-
-        mainFrameBufferIndex = !mainFrameBufferIndex;
+        fbrTraceEnd("compositor frame");
     }
 }
 
-static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
+// Records the node's reprojection into the parent's render pass
+typedef void (*FbrRecordNodeComposite)(FbrApp *pApp, uint32_t cameraOffset);
+
+static void recordNodeMeshShaderComposite(FbrApp *pApp, uint32_t cameraOffset)
+{
+    FbrVulkan *pVulkan = pApp->pVulkan;
+    FbrCamera *pCamera = pApp->pCamera;
+    FbrPipelines *pPipelines = pApp->pPipelines;
+    FbrDescriptors *pDescriptors = pApp->pDescriptors;
+    FbrNode *pTestNode = pApp->pTestNode;
+
+    fbrNodeUpdateMeshDensity(pTestNode, pCamera);
+    FbrPipeNodeMesh nodeMeshPipe;
+    fbrGetPipeNodeMesh(pPipelines,
+                       pTestNode->meshDensity,
+                       &nodeMeshPipe);
+    vkCmdBindPipeline(pVulkan->graphicsCommandBuffer,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      nodeMeshPipe);
+    vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pPipelines->graphicsPipeLayoutNodeMesh,
+                            FBR_GLOBAL_SET_INDEX,
+                            1,
+                            &pDescriptors->setGlobal,
+                            1,
+                            &cameraOffset);
+    const uint32_t nodeCameraOffset = fbrGetDynamicUBOOffset(pVulkan->pDynamicUBO, &pTestNode->pCompositingCamera->uboSlot);
+    vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pPipelines->graphicsPipeLayoutNodeMesh,
+                            FBR_MESH_COMPOSITE_SET_INDEX,
+                            1,
+                            &pDescriptors->setMeshComposite,
+                            1,
+                            &nodeCameraOffset);
+    // set 1 differs from the standard layout so textures need binding again
+    vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pPipelines->graphicsPipeLayoutNodeMesh,
+                            FBR_TEXTURES_SET_INDEX,
+                            1,
+                            &pDescriptors->setTextures,
+                            0,
+                            NULL);
+    fbrPushTextureIndices(pVulkan->graphicsCommandBuffer,
+                          pPipelines->graphicsPipeLayoutNodeMesh,
+                          &pTestNode->pTextureIndices[pTestNode->acquiredFramebufferIndex]);
+
+    fbrBeginProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_COMPOSITE);
+    pVulkan->functions.cmdDrawMeshTasks(pVulkan->graphicsCommandBuffer, 1, 1, 1);
+    fbrEndProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_COMPOSITE);
+}
+
+static void recordNodeTessellationComposite(FbrApp *pApp, uint32_t cameraOffset)
+{
+    FbrVulkan *pVulkan = pApp->pVulkan;
+    FbrPipelines *pPipelines = pApp->pPipelines;
+    FbrDescriptors *pDescriptors = pApp->pDescriptors;
+    FbrNode *pTestNode = pApp->pTestNode;
+
+    vkCmdBindPipeline(pVulkan->graphicsCommandBuffer,
+                      VK_PIPELINE_BIND_POINT_GRAPHICS,
+                      pPipelines->graphicsPipeNodeTess);
+    vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pPipelines->graphicsPipeLayoutNodeTess,
+                            FBR_GLOBAL_SET_INDEX,
+                            1,
+                            &pDescriptors->setGlobal,
+                            1,
+                            &cameraOffset);
+    vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pPipelines->graphicsPipeLayoutNodeTess,
+                            FBR_TEXTURES_SET_INDEX,
+                            1,
+                            &pDescriptors->setTextures,
+                            0,
+                            NULL);
+    // the node's transform, then the camera its frame was rendered from
+    const uint32_t pNodeOffsets[] = {
+            fbrGetDynamicUBOOffset(pVulkan->pDynamicUBO, &pTestNode->pTransform->uboSlot),
+            fbrGetDynamicUBOOffset(pVulkan->pDynamicUBO, &pTestNode->pCompositingCamera->uboSlot),
+    };
+    vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
+                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            pPipelines->graphicsPipeLayoutNodeTess,
+                            FBR_NODE_SET_INDEX,
+                            1,
+                            &pDescriptors->setNode,
+                            COUNT(pNodeOffsets),
+                            pNodeOffsets);
+    fbrPushTextureIndices(pVulkan->graphicsCommandBuffer,
+                          pPipelines->graphicsPipeLayoutNodeTess,
+                          &pTestNode->pTextureIndices[pTestNode->acquiredFramebufferIndex]);
+
+    // one patch, node_tess.tesc picks its factors from screen size and depth discontinuities
+    fbrBeginProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_COMPOSITE);
+    const VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(pVulkan->graphicsCommandBuffer, 0, 1, &pTestNode->pMesh->vertexBuffer, &offset);
+    vkCmdDraw(pVulkan->graphicsCommandBuffer, pTestNode->pMesh->vertexCount, 1, 0, 0);
+    fbrEndProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_COMPOSITE);
+}
+
+// Renders the parent's own content and the node through recordNodeComposite on the graphics queue, then blits to the swap
+static void parentMainLoopGraphicsComposite(FbrApp *pApp, uint32_t frameCount, FbrRecordNodeComposite recordNodeComposite) {
     FbrVulkan *pVulkan = pApp->pVulkan;
     FbrSwap *pSwap = pApp->pSwap;
     FbrTimelineSemaphore *pMainTimelineSemaphore = pVulkan->pMainTimelineSemaphore;
@@ -584,36 +809,44 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
     FbrDescriptors *pDescriptors = pApp->pDescriptors;
     FbrNode *pTestNode = pApp->pTestNode;
 
-    uint64_t priorChildTimeline = 0;
-    uint8_t testNodeTimelineSwitch = 1;
     uint8_t mainFrameBufferIndex = 0;
 
     VkExtent2D extents = pSwap->extent;
 
-    while (!glfwWindowShouldClose(pApp->pWindow) && !pApp->exiting) {
+    claimNodeFramebuffer(pApp, pVulkan->graphicsQueueFamilyIndex);
+
+    for (uint32_t frame = 0;
+         (frameCount == 0 || frame < frameCount) && !shouldExit(pApp);
+         ++frame) {
 //        FBR_LOG_DEBUG("Parent FPS", 1.0f / pTime->deltaTime);
+        fbrTraceBegin("compositor frame");
+
+        // first so everything sampled this frame is as late as pacing allows
+        fbrBeginSwapFrame(pVulkan, pSwap);
 
         updateTime(pTime);
 
+        fbrUpdateAssetLoader(pVulkan);
+        fbrSubmitUploads(pVulkan, NULL);
+
+        fbrBeginDynamicUBOFrame(pVulkan->pDynamicUBO);
+        fbrBeginProfilerFrame(pVulkan);
+
         processInputFrame(pApp);
+        if (pApp->pBenchmark != NULL)
+            fbrBeginBenchmarkFrame(pApp->pBenchmark, pVulkan, pCamera);
+        fbrRecordCameraPose(pCamera, fbrGetTraceTimestamp());
 
         beginFrameCommandBuffer(pVulkan, extents);
 
         fbrUpdateCameraUBO(pCamera);
 
         // -------------------------------------------------------------------------------------------------------------
-        // Retrieve semaphore timeline value of child node to see if rendering is complete
-        //TODO is reading the semaphore slower than just sharing CPU memory?
-        vkGetSemaphoreCounterValue(pVulkan->device,
-                                   pTestNode->pChildSemaphore->semaphore,
-                                   &pTestNode->pChildSemaphore->waitValue);
-        if (priorChildTimeline != pTestNode->pChildSemaphore->waitValue) {
-            priorChildTimeline = pTestNode->pChildSemaphore->waitValue;
-            testNodeTimelineSwitch = (testNodeTimelineSwitch + 1) % 2;
-
-            fbrAcquireFramebufferFromExternalAttachToGraphicsRead(pVulkan,pTestNode->pFramebuffers[testNodeTimelineSwitch]);
-            fbrNodeUpdateCompositingCameraFromRenderingCamera(pTestNode);
-            fbrNodeUpdateCameraIPCFromCamera(pVulkan, pTestNode, pCamera);
+        if (pollNodeFrame(pApp)) {
+            fbrBeginProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_BARRIERS);
+            fbrAcquireFramebufferFromExternalAttachToGraphicsRead(pVulkan, pTestNode->pFramebuffers[pTestNode->acquiredFramebufferIndex]);
+            fbrEndProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_BARRIERS);
+            pTestNode->acquiredQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex;
         }
 
         // Begin Parent Render Pass
@@ -627,14 +860,15 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
                           VK_PIPELINE_BIND_POINT_GRAPHICS,
                           pPipelines->graphicsPipeStandard);
         // Global
+        const uint32_t cameraOffset = fbrGetDynamicUBOOffset(pVulkan->pDynamicUBO, &pCamera->uboSlot);
         vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 pPipelines->graphicsPipeLayoutStandard,
                                 FBR_GLOBAL_SET_INDEX,
                                 1,
                                 &pDescriptors->setGlobal,
-                                0,
-                                NULL);
+                                1,
+                                &cameraOffset);
         // Pass
 //        vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
 //                                VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -644,68 +878,37 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
 //                                &pDescriptors->setPass,
 //                                0,
 //                                NULL);
-        // Material
+        // Textures
         vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
                                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 pPipelines->graphicsPipeLayoutStandard,
-                                FBR_MATERIAL_SET_INDEX,
+                                FBR_TEXTURES_SET_INDEX,
                                 1,
-                                &pApp->testQuadMaterialSet,
+                                &pDescriptors->setTextures,
                                 0,
                                 NULL);
+        fbrPushTextureIndices(pVulkan->graphicsCommandBuffer,
+                              pPipelines->graphicsPipeLayoutStandard,
+                              &(FbrTextureIndices) {.colorIndex = pApp->testQuadTextureIndex});
 
         //cube 1
-        vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                pPipelines->graphicsPipeLayoutStandard,
-                                FBR_OBJECT_SET_INDEX,
-                                1,
-                                &pApp->testQuadObjectSet,
-                                0,
-                                NULL);
+        fbrPushSetObject(pVulkan,
+                         pVulkan->graphicsCommandBuffer,
+                         pPipelines->graphicsPipeLayoutStandard,
+                         pApp->pTestQuadTransform);
         recordRenderMesh(pVulkan,
                          pApp->pTestQuadMesh);
 
 
-        // Mesh Shader Node
-        vkCmdBindPipeline(pVulkan->graphicsCommandBuffer,
-                          VK_PIPELINE_BIND_POINT_GRAPHICS,
-                          pPipelines->graphicsPipeNodeMesh);
-        vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                pPipelines->graphicsPipeLayoutNodeMesh,
-                                FBR_GLOBAL_SET_INDEX,
-                                1,
-                                &pDescriptors->setGlobal,
-                                0,
-                                NULL);
-        vkCmdBindDescriptorSets(pVulkan->graphicsCommandBuffer,
-                                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                pPipelines->graphicsPipeLayoutNodeMesh,
-                                FBR_MESH_COMPOSITE_SET_INDEX,
-                                1,
-                                &pDescriptors->setMeshComposites[testNodeTimelineSwitch],
-                                0,
-                                NULL);
-
-
-        const int queryCount = 2;
-        vkResetQueryPool(pVulkan->device, pVulkan->queryPool, 0, queryCount);
-        vkCmdWriteTimestamp(pVulkan->graphicsCommandBuffer, VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT,  pVulkan->queryPool, 0);
-        pVulkan->functions.cmdDrawMeshTasks(pVulkan->graphicsCommandBuffer, 1, 1, 1);
-        vkCmdWriteTimestamp(pVulkan->graphicsCommandBuffer, VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT,  pVulkan->queryPool, 1);
+        recordNodeComposite(pApp, cameraOffset);
 
         vkCmdEndRenderPass(pVulkan->graphicsCommandBuffer);
         // End of Graphics Commands
 
         // Transfer and blit to swap and transfer back
         uint32_t swapIndex;
-        FBR_ACK_EXIT(vkAcquireNextImageKHR(pVulkan->device,
-                                           pSwap->swapChain,
-                                           UINT64_MAX,
-                                           pSwap->acquireCompleteSemaphore,
-                                           VK_NULL_HANDLE,
-                                           &swapIndex));
+        FBR_ACK_EXIT(fbrAcquireSwap(pVulkan, pSwap, &swapIndex));
+        fbrBeginProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_BLIT);
         const VkImageMemoryBarrier pTransitionBlitBarrier[] = {
                 {
                         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -722,7 +925,7 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
                         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
                         .srcAccessMask = 0,
                         .dstAccessMask = 0,
-                        .oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                        .oldLayout = pSwap->presentLayout,
                         .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                         .srcQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
                         .dstQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
@@ -761,6 +964,9 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
                        1,
                        &imageBlit,
                        VK_FILTER_NEAREST);
+        fbrEndProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_BLIT);
+
+        fbrBeginProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_PRESENT_TRANSITION);
         const VkImageMemoryBarrier pTransitionPresentBarrier[] = {
                 {
                         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
@@ -778,7 +984,7 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
                         .srcAccessMask = 0,
                         .dstAccessMask = 0,
                         .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                        .newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                        .newLayout = pSwap->presentLayout,
                         .srcQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
                         .dstQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
                         .image = pSwap->pSwapImages[swapIndex],
@@ -792,11 +998,16 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
                              0, NULL,
                              0, NULL,
                              2, pTransitionPresentBarrier);
+        fbrEndProfilerZone(pVulkan, pVulkan->graphicsCommandBuffer, FBR_PROFILER_ZONE_PRESENT_TRANSITION);
         // end transfer and blit to swap and transfer back
 
         FBR_ACK_EXIT(vkEndCommandBuffer(pVulkan->graphicsCommandBuffer));
         // End Command Buffer
 
+        // One copy of every transform and camera written this frame
+        latchCameraPose(pApp);
+        fbrFlushDynamicUBO(pVulkan->pDynamicUBO);
+
         submitQueueAndPresent(pVulkan, pSwap, pMainTimelineSemaphore, swapIndex);
 
         // Wait!
@@ -808,17 +1019,30 @@ static void parentMainLoopMeshShaderComposite(FbrApp *pApp) {
                 .pSemaphores = &pMainTimelineSemaphore->semaphore,
                 .pValues = &pMainTimelineSemaphore->waitValue,
         };
+        fbrTraceInstant(FBR_TRACE_CATEGORY_SEMAPHORE, "wait", pMainTimelineSemaphore->waitValue);
+        fbrTraceBegin("semaphore wait");
         FBR_ACK_EXIT(vkWaitSemaphores(pVulkan->device, &semaphoreWaitInfo, UINT64_MAX));
-
-        uint64_t timestamps[queryCount];
-        vkGetQueryPoolResults(pVulkan->device, pVulkan->queryPool, 0, queryCount, sizeof(uint64_t) * queryCount, timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT );
-        float ms = (float)(timestamps[1] - timestamps[0]) / 1000000.0f;
-        FBR_LOG_MESSAGE("Task/Mesh: ", ms);
+        fbrTraceEnd("semaphore wait");
 
         mainFrameBufferIndex = !mainFrameBufferIndex;
+        fbrEndSwapFrame(pSwap);
+        // the frame's composite has finished on the gpu and its present is queued, the closest this gets to scanout
+        fbrNodeRecordPresent(pTestNode, fbrGetTraceTimestamp());
+
+        fbrTraceEnd("compositor frame");
     }
 }
 
+// Runs until the window closes, or for frameCount frames if it is not 0
+static void parentMainLoopMeshShaderComposite(FbrApp *pApp, uint32_t frameCount) {
+    parentMainLoopGraphicsComposite(pApp, frameCount, recordNodeMeshShaderComposite);
+}
+
+// Runs until the window closes, or for frameCount frames if it is not 0
+static void parentMainLoopTessellationComposite(FbrApp *pApp, uint32_t frameCount) {
+    parentMainLoopGraphicsComposite(pApp, frameCount, recordNodeTessellationComposite);
+}
+
 static void setHighPriority(){
     // ovr example does this, is it good? https://github.com/ValveSoftware/virtual_display/blob/da13899ea6b4c0e4167ed97c77c6d433718489b1/virtual_display/virtual_display.cpp
 #define THREAD_PRIORITY_MOST_URGENT 15
@@ -826,13 +1050,140 @@ static void setHighPriority(){
     SetPriorityClass(GetCurrentThread(), REALTIME_PRIORITY_CLASS);
 }
 
+typedef void (*FbrParentMainLoop)(FbrApp *pApp, uint32_t frameCount);
+
+static FbrParentMainLoop getParentMainLoop(FbrReprojectionGeometry reprojectionGeometry) {
+    switch (reprojectionGeometry) {
+        case ComputeSSDM:
+            return parentMainLoopComputeComposite;
+        case TessellationShader:
+            return parentMainLoopTessellationComposite;
+        case MeshShader:
+            return parentMainLoopMeshShaderComposite;
+        default:
+            // None has no composite loop
+            return NULL;
+    }
+}
+
+static const char *getReprojectionGeometryName(FbrReprojectionGeometry reprojectionGeometry) {
+    switch (reprojectionGeometry) {
+        case None:
+            return "None";
+        case TessellationShader:
+            return "TessellationShader";
+        case ComputeSSDM:
+            return "ComputeSSDM";
+        case MeshShader:
+            return "MeshShader";
+        default:
+            return "Unknown";
+    }
+}
+
+// None leaves the node unreprojected so it can never meet quality, only real reprojection is timed
+static const FbrReprojectionGeometry calibrationCandidates[] = {
+        TessellationShader,
+        ComputeSSDM,
+        MeshShader,
+};
+
+// Picks the fastest geometry that kept up with the node. If none did, the one reprojecting the freshest frames.
+static FbrReprojectionGeometry calibrateReprojection(FbrApp *pApp) {
+    const FbrNode *pTestNode = pApp->pTestNode;
+    FbrReprojectionGeometry fastestGeometry = pApp->settings.reprojectionGeometry;
+    double fastestFrameTime = DBL_MAX;
+    FbrReprojectionGeometry freshestGeometry = pApp->settings.reprojectionGeometry;
+    float freshestFrameAge = FLT_MAX;
+
+    for (int i = 0; i < COUNT(calibrationCandidates); ++i) {
+        const FbrParentMainLoop mainLoop = getParentMainLoop(calibrationCandidates[i]);
+        mainLoop(pApp, FBR_CALIBRATION_WARMUP_FRAME_COUNT);
+        const uint64_t startTimelineValue = pTestNode->acquiredTimelineValue;
+        const double startTime = glfwGetTime();
+        mainLoop(pApp, FBR_CALIBRATION_FRAME_COUNT);
+        const double frameTime = (glfwGetTime() - startTime) / FBR_CALIBRATION_FRAME_COUNT;
+        vkDeviceWaitIdle(pApp->pVulkan->device);
+
+        // closed part way through, the timing is meaningless
+        if (shouldExit(pApp))
+            break;
+
+        // the latency window is as long as the timed run, so these cover only this geometry
+        float minMs, avgMs, maxMs, avgFrameAge;
+        fbrGetNodeLatencyStats(pTestNode, &minMs, &avgMs, &maxMs, &avgFrameAge);
+        // a geometry that never took a node frame has nothing to show for its frame time
+        const bool nodeFramesAcquired = pTestNode->acquiredTimelineValue != startTimelineValue;
+        const bool meetsQuality = nodeFramesAcquired && avgFrameAge <= FBR_CALIBRATION_MAX_FRAME_AGE;
+
+        FBR_LOG_MESSAGE("Calibrated reprojection.", getReprojectionGeometryName(calibrationCandidates[i]), frameTime * 1000.0, avgFrameAge, meetsQuality);
+        if (meetsQuality && frameTime < fastestFrameTime) {
+            fastestFrameTime = frameTime;
+            fastestGeometry = calibrationCandidates[i];
+        }
+        if (nodeFramesAcquired && avgFrameAge < freshestFrameAge) {
+            freshestFrameAge = avgFrameAge;
+            freshestGeometry = calibrationCandidates[i];
+        }
+    }
+
+    if (fastestFrameTime == DBL_MAX) {
+        FBR_LOG_MESSAGE("No reprojection met quality, using freshest.", getReprojectionGeometryName(freshestGeometry), freshestFrameAge);
+        return freshestGeometry;
+    }
+
+    return fastestGeometry;
+}
+
+// Runs after calibration so the chosen geometry is what gets measured
+static void runBenchmark(FbrApp *pApp, FbrParentMainLoop mainLoop) {
+    if (fbrCreateBenchmark(pApp->settings.pBenchmarkPath, pApp->settings.frameCount, &pApp->pBenchmark) != VK_SUCCESS) {
+        fbrDestroyBenchmark(pApp->pBenchmark);
+        pApp->pBenchmark = NULL;
+        return;
+    }
+
+    mainLoop(pApp, fbrGetBenchmarkLoopFrameCount(pApp->pBenchmark));
+
+    // closed part way through, the samples don't cover the whole path
+    if (!shouldExit(pApp))
+        fbrWriteBenchmarkReport(pApp->pBenchmark,
+                                pApp,
+                                getReprojectionGeometryName(pApp->settings.reprojectionGeometry),
+                                FBR_BENCHMARK_REPORT_PATH);
+
+    fbrDestroyBenchmark(pApp->pBenchmark);
+    pApp->pBenchmark = NULL;
+}
+
 void fbrMainLoop(FbrApp *pApp) {
     FBR_LOG_DEBUG("mainloop starting!");
 
     if (!pApp->isChild) {
         setHighPriority();
-//        parentMainLoopComputeComposite(pApp);
-        parentMainLoopMeshShaderComposite(pApp);
+
+        if (pApp->settings.calibrateReprojection)
+            pApp->settings.reprojectionGeometry = calibrateReprojection(pApp);
+
+        const FbrParentMainLoop mainLoop = getParentMainLoop(pApp->settings.reprojectionGeometry);
+
+        FBR_LOG_MESSAGE("Reprojection.", getReprojectionGeometryName(pApp->settings.reprojectionGeometry));
+        if (mainLoop == NULL) {
+            // main rejects these, reaching here is a bug
+            FBR_LOG_ERROR("Reprojection has no main loop!");
+        } else if (pApp->settings.pBenchmarkPath != NULL) {
+            runBenchmark(pApp, mainLoop);
+        } else {
+            const double startTime = glfwGetTime();
+            mainLoop(pApp, pApp->settings.frameCount);
+            const double elapsedTime = glfwGetTime() - startTime;
+
+            // a fixed frame count is a benchmark run, report throughput
+            if (pApp->settings.frameCount > 0 && !shouldExit(pApp)) {
+                FBR_LOG_MESSAGE("Frames complete.", pApp->settings.frameCount, elapsedTime);
+                FBR_LOG_MESSAGE("Throughput.", pApp->settings.frameCount / elapsedTime, elapsedTime * 1000.0 / pApp->settings.frameCount);
+            }
+        }
     } else {
         childMainLoop(pApp);
     }
@@ -0,0 +1,181 @@
+#include "fbr_descriptor_allocator.h"
+#include "fbr_vulkan.h"
+#include "fbr_log.h"
+
+#include "stb_ds.h"
+
+// Floor for every new pool so early pools aren't sized off a single set
+static const VkDescriptorPoolSize defaultRatios[] = {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 2},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
+};
+
+static void initChain(FbrDescriptorPoolChain *pChain) {
+    *pChain = (FbrDescriptorPoolChain) {
+            .setsPerPool = FBR_DESCRIPTOR_POOL_MIN_SETS,
+    };
+}
+
+static void destroyChain(const FbrVulkan *pVulkan, FbrDescriptorPoolChain *pChain) {
+    if (pChain->currentPool != VK_NULL_HANDLE)
+        vkDestroyDescriptorPool(pVulkan->device, pChain->currentPool, FBR_ALLOCATOR);
+    for (int i = 0; i < arrlen(pChain->pFullPools); ++i)
+        vkDestroyDescriptorPool(pVulkan->device, pChain->pFullPools[i], FBR_ALLOCATOR);
+    arrfree(pChain->pFullPools);
+}
+
+static FBR_RESULT createPool(const FbrVulkan *pVulkan,
+                             FbrDescriptorPoolChain *pChain,
+                             const FbrSetLayout *pSetLayout,
+                             VkDescriptorPool *pPool) {
+    const uint32_t setCount = pChain->setsPerPool;
+
+    uint32_t pCounts[FBR_DESCRIPTOR_TYPE_COUNT] = {0};
+    for (int i = 0; i < COUNT(defaultRatios); ++i) {
+        pCounts[defaultRatios[i].type] = defaultRatios[i].descriptorCount * setCount;
+    }
+    for (uint32_t type = 0; type < FBR_DESCRIPTOR_TYPE_COUNT; ++type) {
+        // average per set so far, rounded up, scaled to the pool
+        const uint32_t observed = pChain->setCount > 0 ?
+                                  (pChain->pDescriptorCounts[type] * setCount + pChain->setCount - 1) / pChain->setCount :
+                                  0;
+        if (observed > pCounts[type])
+            pCounts[type] = observed;
+        // the set which triggered this pool must always fit
+        if (pSetLayout->pDescriptorCounts[type] > pCounts[type])
+            pCounts[type] = pSetLayout->pDescriptorCounts[type];
+    }
+
+    VkDescriptorPoolSize pPoolSizes[FBR_DESCRIPTOR_TYPE_COUNT];
+    uint32_t poolSizeCount = 0;
+    for (uint32_t type = 0; type < FBR_DESCRIPTOR_TYPE_COUNT; ++type) {
+        if (pCounts[type] == 0)
+            continue;
+        pPoolSizes[poolSizeCount++] = (VkDescriptorPoolSize) {
+                .type = type,
+                .descriptorCount = pCounts[type],
+        };
+    }
+
+    const VkDescriptorPoolCreateInfo poolInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .poolSizeCount = poolSizeCount,
+            .pPoolSizes = pPoolSizes,
+            .maxSets = setCount,
+    };
+    FBR_ACK(vkCreateDescriptorPool(pVulkan->device,
+                                   &poolInfo,
+                                   FBR_ALLOCATOR,
+                                   pPool));
+
+    FBR_LOG_MESSAGE("Created descriptor pool.", setCount, poolSizeCount);
+
+    if (pChain->setsPerPool < FBR_DESCRIPTOR_POOL_MAX_SETS)
+        pChain->setsPerPool *= 2;
+
+    return FBR_SUCCESS;
+}
+
+static FBR_RESULT nextPool(const FbrVulkan *pVulkan,
+                           FbrDescriptorPoolChain *pChain,
+                           const FbrSetLayout *pSetLayout) {
+    if (pChain->currentPool != VK_NULL_HANDLE)
+        arrput(pChain->pFullPools, pChain->currentPool);
+
+    return createPool(pVulkan, pChain, pSetLayout, &pChain->currentPool);
+}
+
+static VkResult tryAllocate(const FbrVulkan *pVulkan,
+                            VkDescriptorPool pool,
+                            const FbrSetLayout *pSetLayout,
+                            VkDescriptorSet *pSet) {
+    const VkDescriptorSetAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = NULL,
+            .descriptorPool = pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &pSetLayout->layout,
+    };
+    return vkAllocateDescriptorSets(pVulkan->device, &allocInfo, pSet);
+}
+
+static FBR_RESULT allocateFromChain(const FbrVulkan *pVulkan,
+                                    FbrDescriptorPoolChain *pChain,
+                                    const FbrSetLayout *pSetLayout,
+                                    VkDescriptorSet *pSet) {
+    // counted up front so a pool created below already accounts for this set
+    pChain->setCount++;
+    for (uint32_t type = 0; type < FBR_DESCRIPTOR_TYPE_COUNT; ++type) {
+        pChain->pDescriptorCounts[type] += pSetLayout->pDescriptorCounts[type];
+    }
+
+    if (pChain->currentPool == VK_NULL_HANDLE)
+        FBR_ACK(nextPool(pVulkan, pChain, pSetLayout));
+
+    VkResult result = tryAllocate(pVulkan, pChain->currentPool, pSetLayout, pSet);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+        // a freshly created pool is always sized to fit the set
+        FBR_ACK(nextPool(pVulkan, pChain, pSetLayout));
+        result = tryAllocate(pVulkan, pChain->currentPool, pSetLayout, pSet);
+    }
+    FBR_ACK(result);
+
+    return FBR_SUCCESS;
+}
+
+static FbrDescriptorLayoutStats *getLayoutStats(FbrDescriptorAllocator *pDescriptorAllocator,
+                                                const FbrSetLayout *pSetLayout) {
+    for (int i = 0; i < arrlen(pDescriptorAllocator->pLayoutStats); ++i) {
+        if (pDescriptorAllocator->pLayoutStats[i].layout == pSetLayout->layout)
+            return &pDescriptorAllocator->pLayoutStats[i];
+    }
+    const FbrDescriptorLayoutStats stats = {
+            .pName = pSetLayout->pName,
+            .layout = pSetLayout->layout,
+    };
+    arrput(pDescriptorAllocator->pLayoutStats, stats);
+    return &arrlast(pDescriptorAllocator->pLayoutStats);
+}
+
+VkResult fbrCreateDescriptorAllocator(const FbrVulkan *pVulkan, FbrDescriptorAllocator **ppAllocDescriptorAllocator) {
+    *ppAllocDescriptorAllocator = calloc(1, sizeof(FbrDescriptorAllocator));
+    FbrDescriptorAllocator *pDescriptorAllocator = *ppAllocDescriptorAllocator;
+
+    initChain(&pDescriptorAllocator->persistentChain);
+
+    return FBR_SUCCESS;
+}
+
+void fbrDestroyDescriptorAllocator(const FbrVulkan *pVulkan, FbrDescriptorAllocator *pDescriptorAllocator) {
+    fbrLogDescriptorStats(pVulkan);
+
+    // persistent sets are never freed individually, they go with their pools here
+    destroyChain(pVulkan, &pDescriptorAllocator->persistentChain);
+    arrfree(pDescriptorAllocator->pLayoutStats);
+
+    free(pDescriptorAllocator);
+}
+
+VkResult fbrAllocatePersistentDescriptorSet(const FbrVulkan *pVulkan,
+                                            const FbrSetLayout *pSetLayout,
+                                            VkDescriptorSet *pSet) {
+    FbrDescriptorAllocator *pDescriptorAllocator = pVulkan->pDescriptorAllocator;
+    FBR_ACK(allocateFromChain(pVulkan, &pDescriptorAllocator->persistentChain, pSetLayout, pSet));
+    getLayoutStats(pDescriptorAllocator, pSetLayout)->persistentCount++;
+    return FBR_SUCCESS;
+}
+
+void fbrLogDescriptorStats(const FbrVulkan *pVulkan) {
+    const FbrDescriptorAllocator *pDescriptorAllocator = pVulkan->pDescriptorAllocator;
+    const FbrDescriptorPoolChain *pPersistentChain = &pDescriptorAllocator->persistentChain;
+    const uint32_t persistentPoolCount = arrlen(pPersistentChain->pFullPools) + (pPersistentChain->currentPool != VK_NULL_HANDLE);
+    FBR_LOG_MESSAGE("Descriptor persistent.", persistentPoolCount, pPersistentChain->setCount);
+    for (int i = 0; i < arrlen(pDescriptorAllocator->pLayoutStats); ++i) {
+        const FbrDescriptorLayoutStats *pStats = &pDescriptorAllocator->pLayoutStats[i];
+        FBR_LOG_MESSAGE("Descriptor layout.", pStats->pName, pStats->persistentCount);
+    }
+}
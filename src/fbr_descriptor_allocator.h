@@ -0,0 +1,43 @@
+#ifndef FABRIC_DESCRIPTOR_ALLOCATOR_H
+#define FABRIC_DESCRIPTOR_ALLOCATOR_H
+
+#include "fbr_app.h"
+#include "fbr_descriptors.h"
+
+#define FBR_DESCRIPTOR_POOL_MIN_SETS 16
+#define FBR_DESCRIPTOR_POOL_MAX_SETS 1024
+
+// When the current pool runs out it is retired and the next one is sized from what the chain has handed out so far.
+typedef struct FbrDescriptorPoolChain {
+    VkDescriptorPool currentPool;
+    // stb_ds array
+    VkDescriptorPool *pFullPools;
+    uint32_t setsPerPool;
+    uint32_t setCount;
+    uint32_t pDescriptorCounts[FBR_DESCRIPTOR_TYPE_COUNT];
+} FbrDescriptorPoolChain;
+
+typedef struct FbrDescriptorLayoutStats {
+    const char *pName;
+    VkDescriptorSetLayout layout;
+    uint32_t persistentCount;
+} FbrDescriptorLayoutStats;
+
+typedef struct FbrDescriptorAllocator {
+    FbrDescriptorPoolChain persistentChain;
+    // stb_ds array
+    FbrDescriptorLayoutStats *pLayoutStats;
+} FbrDescriptorAllocator;
+
+VkResult fbrCreateDescriptorAllocator(const FbrVulkan *pVulkan, FbrDescriptorAllocator **ppAllocDescriptorAllocator);
+
+void fbrDestroyDescriptorAllocator(const FbrVulkan *pVulkan, FbrDescriptorAllocator *pDescriptorAllocator);
+
+// Lives until the allocator is destroyed.
+VkResult fbrAllocatePersistentDescriptorSet(const FbrVulkan *pVulkan,
+                                            const FbrSetLayout *pSetLayout,
+                                            VkDescriptorSet *pSet);
+
+void fbrLogDescriptorStats(const FbrVulkan *pVulkan);
+
+#endif //FABRIC_DESCRIPTOR_ALLOCATOR_H
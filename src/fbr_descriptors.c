@@ -1,4 +1,5 @@
 #include "fbr_descriptors.h"
+#include "fbr_descriptor_allocator.h"
 #include "fbr_vulkan.h"
 #include "fbr_camera.h"
 #include "fbr_texture.h"
@@ -6,9 +7,13 @@
 #include "fbr_log.h"
 #include "stb_ds.h"
 
-// TODO rewrite descriptors using push scheme
 VkDescriptorSetLayoutBinding *pLayoutBindingArray = NULL;
-VkWriteDescriptorSet *pDescriptorWriteArray = NULL;
+
+// Update templates read one of these per binding, in binding order
+typedef union FbrDescriptorInfo {
+    VkDescriptorImageInfo image;
+    VkDescriptorBufferInfo buffer;
+} FbrDescriptorInfo;
 
 static void pushLayoutBinding(VkDescriptorSetLayoutBinding binding)
 {
@@ -18,15 +23,19 @@ static void pushLayoutBinding(VkDescriptorSetLayoutBinding binding)
 }
 
 static FBR_RESULT createDescriptorSetLayout(const FbrVulkan *pVulkan,
+                                            VkDescriptorSetLayoutCreateFlags flags,
                                             int bindingsCount,
                                             const VkDescriptorSetLayoutBinding *pBindings,
                                             FbrSetLayout *pSetLayout)
 {
     pSetLayout->bindingCount = bindingsCount;
+    for (int i = 0; i < bindingsCount; ++i) {
+        pSetLayout->pDescriptorCounts[pBindings[i].descriptorType] += pBindings[i].descriptorCount;
+    }
     VkDescriptorSetLayoutCreateInfo layoutInfo = {
             .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
             .pNext = NULL,
-            .flags = 0,
+            .flags = flags,
             .bindingCount = pSetLayout->bindingCount,
             .pBindings = pBindings,
     };
@@ -37,68 +46,106 @@ static FBR_RESULT createDescriptorSetLayout(const FbrVulkan *pVulkan,
     return FBR_SUCCESS;
 }
 
-static FBR_RESULT createPushedDescriptorSetLayout(const FbrVulkan *pVulkan, FbrSetLayout *pSetLayout)
+static FBR_RESULT createUpdateTemplate(const FbrVulkan *pVulkan,
+                                       int bindingsCount,
+                                       const VkDescriptorSetLayoutBinding *pBindings,
+                                       FbrSetLayout *pSetLayout)
+{
+    VkDescriptorUpdateTemplateEntry pEntries[bindingsCount];
+    for (int i = 0; i < bindingsCount; ++i) {
+        pEntries[i] = (VkDescriptorUpdateTemplateEntry) {
+                .dstBinding = pBindings[i].binding,
+                .dstArrayElement = 0,
+                .descriptorCount = pBindings[i].descriptorCount,
+                .descriptorType = pBindings[i].descriptorType,
+                .offset = i * sizeof(FbrDescriptorInfo),
+                .stride = sizeof(FbrDescriptorInfo),
+        };
+    }
+    const VkDescriptorUpdateTemplateCreateInfo templateInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .descriptorUpdateEntryCount = bindingsCount,
+            .pDescriptorUpdateEntries = pEntries,
+            .templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET,
+            .descriptorSetLayout = pSetLayout->layout,
+    };
+    FBR_ACK(vkCreateDescriptorUpdateTemplate(pVulkan->device,
+                                             &templateInfo,
+                                             NULL,
+                                             &pSetLayout->updateTemplate));
+    return FBR_SUCCESS;
+}
+
+// Builds a layout from the bindings added with pushLayoutBinding. Only a push descriptor flag skips the update template.
+static FBR_RESULT createSetLayout(const FbrVulkan *pVulkan,
+                                  const char *pName,
+                                  VkDescriptorSetLayoutCreateFlags flags,
+                                  FbrSetLayout *pSetLayout)
 {
+    pSetLayout->pName = pName;
     FBR_ACK(createDescriptorSetLayout(pVulkan,
+                                      flags,
                                       arrlen(pLayoutBindingArray),
                                       pLayoutBindingArray,
                                       pSetLayout));
+    // push descriptor sets are written at record time, everything else gets a template
+    if (!(flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)) {
+        FBR_ACK(createUpdateTemplate(pVulkan,
+                                     arrlen(pLayoutBindingArray),
+                                     pLayoutBindingArray,
+                                     pSetLayout));
+    }
     arrsetlen(pLayoutBindingArray, 0);
     return FBR_SUCCESS;
 }
 
-static FBR_RESULT allocateDescriptorSet(const FbrVulkan *pVulkan,
-                                        const FbrSetLayout *pSetLayout,
-                                        VkDescriptorSet *pDescriptorSet)
+static void writeDescriptorSet(const FbrVulkan *pVulkan,
+                               const FbrSetLayout *pSetLayout,
+                               const FbrDescriptorInfo *pInfos,
+                               VkDescriptorSet set)
 {
-    const VkDescriptorSetAllocateInfo allocInfo = {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-            .pNext = NULL,
-            .descriptorPool = pVulkan->descriptorPool,
-            .descriptorSetCount = 1,
-            .pSetLayouts = &pSetLayout->layout,
-    };
-    FBR_ACK(vkAllocateDescriptorSets(pVulkan->device,
-                                     &allocInfo,
-                                     pDescriptorSet));
-    return FBR_SUCCESS;
+    vkUpdateDescriptorSetWithTemplate(pVulkan->device,
+                                      set,
+                                      pSetLayout->updateTemplate,
+                                      pInfos);
 }
 
-static void pushDescriptorWrite(VkWriteDescriptorSet descriptorWrite, VkDescriptorSet *pSet)
+static FbrDescriptorInfo sampledImageInfo(const FbrVulkan *pVulkan, VkImageView imageView)
 {
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = *pSet;
-    descriptorWrite.dstBinding = arrlen(pDescriptorWriteArray);
-    descriptorWrite.descriptorCount = descriptorWrite.descriptorCount == 0 ? 1 : descriptorWrite.descriptorCount;
-    arrput(pDescriptorWriteArray, descriptorWrite);
+    return (FbrDescriptorInfo) {
+            .image = {
+                    .sampler = pVulkan->linearSampler,
+                    .imageView = imageView,
+                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            },
+    };
 }
 
-static void writePushedDescriptors(const FbrVulkan *pVulkan)
+static FbrDescriptorInfo dynamicUBOInfo(const FbrVulkan *pVulkan, VkDeviceSize range)
 {
-    vkUpdateDescriptorSets(pVulkan->device,
-                           arrlen(pDescriptorWriteArray),
-                           pDescriptorWriteArray,
-                           0,
-                           NULL);
-    arrsetlen(pDescriptorWriteArray, 0);
+    return (FbrDescriptorInfo) {
+            .buffer = {
+                    .buffer = pVulkan->pDynamicUBO->uniformBuffer,
+                    .offset = 0,
+                    .range = range,
+            },
+    };
 }
 
 FBR_RESULT fbrCreateSetGlobal(const FbrVulkan *pVulkan,
                               const FbrDescriptors *pDescriptors,
-                              const FbrCamera *pCamera,
-                              FbrSetPass *pSet)
+                              FbrSetGlobal *pSet)
 {
-    FBR_ACK(allocateDescriptorSet(pVulkan,
-                                  &pDescriptors->setLayoutGlobal,
-                                  pSet));
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &(VkDescriptorBufferInfo) {
-                    .buffer = pCamera->pUBO->uniformBuffer,
-                    .range = sizeof(FbrCameraBuffer),
-            },
-    }, pSet);
-    writePushedDescriptors(pVulkan);
+    FBR_ACK(fbrAllocatePersistentDescriptorSet(pVulkan,
+                                               &pDescriptors->setLayoutGlobal,
+                                               pSet));
+    // camera is picked by dynamic offset when bound
+    const FbrDescriptorInfo pInfos[] = {
+            dynamicUBOInfo(pVulkan, sizeof(FbrCameraBuffer)),
+    };
+    writeDescriptorSet(pVulkan, &pDescriptors->setLayoutGlobal, pInfos, *pSet);
     return FBR_SUCCESS;
 }
 
@@ -106,15 +153,16 @@ static FBR_RESULT createSetLayoutGlobal(const FbrVulkan *pVulkan,
                                         FbrSetLayoutGlobal *pSetLayout)
 {
     pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .stageFlags = VK_SHADER_STAGE_VERTEX_BIT |
+                          VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT |
                           VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
                           VK_SHADER_STAGE_COMPUTE_BIT |
                           VK_SHADER_STAGE_FRAGMENT_BIT |
                           VK_SHADER_STAGE_MESH_BIT_EXT |
                           VK_SHADER_STAGE_TASK_BIT_EXT,
     });
-    FBR_ACK(createPushedDescriptorSetLayout(pVulkan, pSetLayout));
+    FBR_ACK(createSetLayout(pVulkan, "Global", 0, pSetLayout));
     return FBR_SUCCESS;
 }
 
@@ -123,18 +171,13 @@ FBR_RESULT fbrCreateSetPass(const FbrVulkan *pVulkan,
                             const FbrTexture *pNormalTexture,
                             FbrSetPass *pSet)
 {
-    FBR_ACK(allocateDescriptorSet(pVulkan,
-                                  &pDescriptors->setLayoutPass,
-                                  pSet));
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = pNormalTexture->imageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    writePushedDescriptors(pVulkan);
+    FBR_ACK(fbrAllocatePersistentDescriptorSet(pVulkan,
+                                               &pDescriptors->setLayoutPass,
+                                               pSet));
+    const FbrDescriptorInfo pInfos[] = {
+            sampledImageInfo(pVulkan, pNormalTexture->imageView),
+    };
+    writeDescriptorSet(pVulkan, &pDescriptors->setLayoutPass, pInfos, *pSet);
     return FBR_SUCCESS;
 }
 
@@ -146,58 +189,150 @@ static FBR_RESULT createSetLayoutPass(const FbrVulkan *pVulkan,
             .stageFlags = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
                           VK_SHADER_STAGE_FRAGMENT_BIT,
     });
-    FBR_ACK(createPushedDescriptorSetLayout(pVulkan, pSetLayout));
+    FBR_ACK(createSetLayout(pVulkan, "Pass", 0, pSetLayout));
     return FBR_SUCCESS;
 }
 
-FBR_RESULT fbrCreateSetMaterial(const FbrVulkan *pVulkan,
-                                const FbrDescriptors *pDescriptors,
-                                const FbrTexture *pTexture,
-                                FbrSetMaterial *pSet)
+FBR_RESULT fbrAcquireTextureIndex(const FbrVulkan *pVulkan,
+                                  FbrDescriptors *pDescriptors,
+                                  VkImageView imageView,
+                                  uint32_t *pIndex)
 {
-    FBR_ACK(allocateDescriptorSet(pVulkan,
-                                  &pDescriptors->setLayoutMaterial,
-                                  pSet));
-    pushDescriptorWrite((VkWriteDescriptorSet) {
+    if (arrlen(pDescriptors->pFreeTextureIndices) > 0) {
+        *pIndex = arrpop(pDescriptors->pFreeTextureIndices);
+    } else if (pDescriptors->texturesCount < FBR_TEXTURES_CAPACITY) {
+        *pIndex = pDescriptors->texturesCount++;
+    } else {
+        FBR_LOG_ERROR("Texture array full!");
+        return VK_ERROR_OUT_OF_POOL_MEMORY;
+    }
+
+    // update after bind, so this is fine while other slots of the set are in use
+    const VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = pDescriptors->setTextures,
+            .dstBinding = 0,
+            .dstArrayElement = *pIndex,
+            .descriptorCount = 1,
             .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
             .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = pTexture->imageView,
                     .sampler = pVulkan->linearSampler,
+                    .imageView = imageView,
+                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
             },
-    }, pSet);
-    writePushedDescriptors(pVulkan);
+    };
+    vkUpdateDescriptorSets(pVulkan->device, 1, &write, 0, NULL);
     return FBR_SUCCESS;
 }
 
-static FBR_RESULT createSetLayoutMaterial(const FbrVulkan *pVulkan,
-                                          FbrSetLayoutMaterial *pSetLayout)
+void fbrReleaseTextureIndex(FbrDescriptors *pDescriptors, uint32_t index)
 {
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
+    // partially bound, the stale descriptor can stay until the slot is reused
+    arrput(pDescriptors->pFreeTextureIndices, index);
+}
+
+void fbrPushTextureIndices(VkCommandBuffer commandBuffer,
+                           VkPipelineLayout pipelineLayout,
+                           const FbrTextureIndices *pIndices)
+{
+    vkCmdPushConstants(commandBuffer,
+                       pipelineLayout,
+                       FBR_TEXTURE_INDICES_STAGES,
+                       0,
+                       sizeof(FbrTextureIndices),
+                       pIndices);
+}
+
+static FBR_RESULT createSetTextures(const FbrVulkan *pVulkan,
+                                    FbrDescriptors *pDescriptors)
+{
+    const VkDescriptorPoolSize poolSize = {
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = FBR_TEXTURES_CAPACITY,
+    };
+    const VkDescriptorPoolCreateInfo poolInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+            .maxSets = 1,
+            .poolSizeCount = 1,
+            .pPoolSizes = &poolSize,
+    };
+    FBR_ACK(vkCreateDescriptorPool(pVulkan->device,
+                                   &poolInfo,
+                                   NULL,
+                                   &pDescriptors->texturesPool));
+    const VkDescriptorSetAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = NULL,
+            .descriptorPool = pDescriptors->texturesPool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &pDescriptors->setLayoutTextures.layout,
+    };
+    FBR_ACK(vkAllocateDescriptorSets(pVulkan->device,
+                                     &allocInfo,
+                                     &pDescriptors->setTextures));
+    return FBR_SUCCESS;
+}
+
+static FBR_RESULT createSetLayoutTextures(const FbrVulkan *pVulkan,
+                                          FbrSetLayoutTextures *pSetLayout)
+{
+    const VkDescriptorSetLayoutBinding binding = {
+            .binding = 0,
             .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
-    });
-    FBR_ACK(createPushedDescriptorSetLayout(pVulkan, pSetLayout));
+            .descriptorCount = FBR_TEXTURES_CAPACITY,
+            .stageFlags = FBR_TEXTURE_INDICES_STAGES,
+    };
+    const VkDescriptorBindingFlags bindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                                  VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT |
+                                                  VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+            .pNext = NULL,
+            .bindingCount = 1,
+            .pBindingFlags = &bindingFlags,
+    };
+    // allocated from its own update after bind pool, not the descriptor allocator
+    pSetLayout->pName = "Textures";
+    pSetLayout->bindingCount = 1;
+    const VkDescriptorSetLayoutCreateInfo layoutInfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+            .pNext = &bindingFlagsInfo,
+            .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+            .bindingCount = 1,
+            .pBindings = &binding,
+    };
+    FBR_ACK(vkCreateDescriptorSetLayout(pVulkan->device,
+                                        &layoutInfo,
+                                        NULL,
+                                        &pSetLayout->layout));
     return FBR_SUCCESS;
 }
 
-FBR_RESULT fbrCreateSetObject(const FbrVulkan *pVulkan,
-                              const FbrDescriptors *pDescriptors,
-                              const FbrTransform *pTransform,
-                              FbrSetObject *pSet)
+void fbrPushSetObject(const FbrVulkan *pVulkan,
+                      VkCommandBuffer commandBuffer,
+                      VkPipelineLayout pipelineLayout,
+                      const FbrTransform *pTransform)
 {
-    FBR_ACK(allocateDescriptorSet(pVulkan,
-                                  &pDescriptors->setLayoutObject,
-                                  pSet));
-    pushDescriptorWrite((VkWriteDescriptorSet) {
+    // push descriptors can't be dynamic so the arena offset goes straight into the write
+    const VkWriteDescriptorSet write = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstBinding = 0,
+            .descriptorCount = 1,
             .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
             .pBufferInfo = &(VkDescriptorBufferInfo) {
-                    .buffer = pTransform->pUBO->uniformBuffer,
-                    .range = sizeof(FbrTransform),
+                    .buffer = pVulkan->pDynamicUBO->uniformBuffer,
+                    .offset = fbrGetDynamicUBOOffset(pVulkan->pDynamicUBO, &pTransform->uboSlot),
+                    .range = sizeof(FbrTransformUBO),
             },
-    }, pSet);
-    writePushedDescriptors(pVulkan);
-    return FBR_SUCCESS;
+    };
+    pVulkan->functions.cmdPushDescriptorSet(commandBuffer,
+                                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                            pipelineLayout,
+                                            FBR_OBJECT_SET_INDEX,
+                                            1,
+                                            &write);
 }
 
 static FBR_RESULT createSetLayoutObject(const FbrVulkan *pVulkan,
@@ -208,66 +343,24 @@ static FBR_RESULT createSetLayoutObject(const FbrVulkan *pVulkan,
             .stageFlags = VK_SHADER_STAGE_VERTEX_BIT |
                           VK_SHADER_STAGE_FRAGMENT_BIT,
     });
-    FBR_ACK(createPushedDescriptorSetLayout(pVulkan, pSetLayout));
+    FBR_ACK(createSetLayout(pVulkan, "Object", VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR, pSetLayout));
     return FBR_SUCCESS;
 }
 
 FBR_RESULT fbrCreateSetNode(const FbrVulkan *pVulkan,
                             const FbrDescriptors *pDescriptors,
-                            const FbrTransform *pTransform,
-                            const FbrCamera *pCamera,
-                            const FbrTexture *pColorTexture,
-                            const FbrTexture *pNormalTexture,
-                            const FbrTexture *pDepthTexture,
                             FbrSetNode *pSet)
 {
-    FBR_ACK(allocateDescriptorSet(pVulkan,
-                                  &pDescriptors->setLayoutNode,
-                                  pSet));
-    // transform UBO
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &(VkDescriptorBufferInfo) {
-                    .buffer = pTransform->pUBO->uniformBuffer,
-                    .range = sizeof(FbrTransform),
-            }
-    }, pSet);
-    // camera UBO from which it was rendered
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &(VkDescriptorBufferInfo) {
-                    .buffer = pCamera->pUBO->uniformBuffer,
-                    .range = sizeof(FbrCamera),
-            },
-    }, pSet);
-    // rgb map
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = pColorTexture->imageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    // normal map
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = pNormalTexture->imageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    // depth map
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = pDepthTexture->imageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    writePushedDescriptors(pVulkan);
+    FBR_ACK(fbrAllocatePersistentDescriptorSet(pVulkan,
+                                               &pDescriptors->setLayoutNode,
+                                               pSet));
+    const FbrDescriptorInfo pInfos[] = {
+            // transform UBO
+            dynamicUBOInfo(pVulkan, sizeof(FbrTransformUBO)),
+            // camera UBO from which it was rendered
+            dynamicUBOInfo(pVulkan, sizeof(FbrCameraBuffer)),
+    };
+    writeDescriptorSet(pVulkan, &pDescriptors->setLayoutNode, pInfos, *pSet);
     return FBR_SUCCESS;
 }
 
@@ -275,95 +368,125 @@ static FBR_RESULT createSetLayoutNode(const FbrVulkan *pVulkan,
                                       FbrSetLayoutNode *pSetLayout)
 {
     pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .stageFlags = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
-                          VK_SHADER_STAGE_FRAGMENT_BIT,
-    });
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .stageFlags = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
-                          VK_SHADER_STAGE_FRAGMENT_BIT,
-    });
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .stageFlags = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
-                          VK_SHADER_STAGE_FRAGMENT_BIT,
-    });
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .stageFlags = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .stageFlags = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT |
+                          VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
                           VK_SHADER_STAGE_FRAGMENT_BIT,
     });
     pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .stageFlags = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            .stageFlags = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT |
+                          VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT |
                           VK_SHADER_STAGE_FRAGMENT_BIT,
     });
-    FBR_ACK(createPushedDescriptorSetLayout(pVulkan, pSetLayout));
+    FBR_ACK(createSetLayout(pVulkan, "Node", 0, pSetLayout));
     return FBR_SUCCESS;
 }
 
-FBR_RESULT fbrCreateSetComputeComposite(const FbrVulkan *pVulkan,
-                                        const FbrDescriptors *pDescriptors,
-                                        VkImageView inputColorImageView,
-                                        VkImageView inputNormalImageView,
-                                        VkImageView inputGBufferImageView,
-                                        VkImageView inputDepthImageView,
-                                        VkImageView outputColorImageView,
-                                        FbrSetComputeComposite *pSet)
+static void writeSetComputeComposite(const FbrVulkan *pVulkan,
+                                     const FbrDescriptors *pDescriptors,
+                                     VkImageView inputColorImageView,
+                                     VkImageView inputNormalImageView,
+                                     VkImageView inputGBufferImageView,
+                                     VkImageView inputDepthImageView,
+                                     VkImageView outputColorImageView,
+                                     FbrSetComputeComposite set)
 {
-    FBR_ACK(allocateDescriptorSet(pVulkan,
-                                  &pDescriptors->setLayoutComputeComposite,
-                                  pSet));
-    // input color
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputColorImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    // input normal
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputNormalImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    // input g buffer
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputGBufferImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    // input depth
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputDepthImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    // output color
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+    const FbrDescriptorInfo pInfos[] = {
+            // input color
+            sampledImageInfo(pVulkan, inputColorImageView),
+            // input normal
+            sampledImageInfo(pVulkan, inputNormalImageView),
+            // input g buffer
+            sampledImageInfo(pVulkan, inputGBufferImageView),
+            // input depth
+            sampledImageInfo(pVulkan, inputDepthImageView),
+            // output color
+            {.image = {
                     .imageView = outputColorImageView,
-//            .linearSampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    writePushedDescriptors(pVulkan);
+                    .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            }},
+    };
+    writeDescriptorSet(pVulkan, &pDescriptors->setLayoutComputeComposite, pInfos, set);
+}
+
+FBR_RESULT fbrGetSetComputeComposite(const FbrVulkan *pVulkan,
+                                     FbrDescriptors *pDescriptors,
+                                     uint32_t framebufferIndex,
+                                     uint32_t swapIndex,
+                                     const FbrFramebuffer *pFramebuffer,
+                                     VkImageView outputColorImageView,
+                                     FbrSetComputeComposite *pSet)
+{
+    FbrComputeCompositeCacheEntry *pEntry = &pDescriptors->pComputeCompositeCache[framebufferIndex][swapIndex];
+    if (pEntry->set != VK_NULL_HANDLE &&
+        pEntry->inputColorImageView == pFramebuffer->pColorTexture->imageView &&
+        pEntry->inputNormalImageView == pFramebuffer->pNormalTexture->imageView &&
+        pEntry->inputGBufferImageView == pFramebuffer->pGBufferTexture->imageView &&
+        pEntry->inputDepthImageView == pFramebuffer->pDepthTexture->imageView &&
+        pEntry->outputColorImageView == outputColorImageView) {
+        *pSet = pEntry->set;
+        return FBR_SUCCESS;
+    }
+
+    FBR_LOG_MESSAGE("Writing compute composite set.", framebufferIndex, swapIndex);
+
+    // stale sets are rewritten in place, the frame that last used it has been waited on
+    if (pEntry->set == VK_NULL_HANDLE) {
+        FBR_ACK(fbrAllocatePersistentDescriptorSet(pVulkan,
+                                                   &pDescriptors->setLayoutComputeComposite,
+                                                   &pEntry->set));
+    }
+    pEntry->inputColorImageView = pFramebuffer->pColorTexture->imageView;
+    pEntry->inputNormalImageView = pFramebuffer->pNormalTexture->imageView;
+    pEntry->inputGBufferImageView = pFramebuffer->pGBufferTexture->imageView;
+    pEntry->inputDepthImageView = pFramebuffer->pDepthTexture->imageView;
+    pEntry->outputColorImageView = outputColorImageView;
+    writeSetComputeComposite(pVulkan,
+                             pDescriptors,
+                             pEntry->inputColorImageView,
+                             pEntry->inputNormalImageView,
+                             pEntry->inputGBufferImageView,
+                             pEntry->inputDepthImageView,
+                             pEntry->outputColorImageView,
+                             pEntry->set);
+    *pSet = pEntry->set;
     return FBR_SUCCESS;
 }
 
+FBR_RESULT fbrCreateSetsComputeComposite(const FbrVulkan *pVulkan,
+                                         FbrDescriptors *pDescriptors,
+                                         FbrFramebuffer *const *ppFramebuffers,
+                                         const FbrSwap *pSwap)
+{
+    for (int framebufferIndex = 0; framebufferIndex < FBR_FRAMEBUFFER_COUNT; ++framebufferIndex) {
+        for (int swapIndex = 0; swapIndex < FBR_SWAP_COUNT; ++swapIndex) {
+            FbrSetComputeComposite set;
+            FBR_ACK(fbrGetSetComputeComposite(pVulkan,
+                                              pDescriptors,
+                                              framebufferIndex,
+                                              swapIndex,
+                                              ppFramebuffers[framebufferIndex],
+                                              pSwap->pSwapImageViews[swapIndex],
+                                              &set));
+        }
+    }
+    return FBR_SUCCESS;
+}
+
+void fbrInvalidateSetsComputeComposite(FbrDescriptors *pDescriptors)
+{
+    for (int framebufferIndex = 0; framebufferIndex < FBR_FRAMEBUFFER_COUNT; ++framebufferIndex) {
+        for (int swapIndex = 0; swapIndex < FBR_SWAP_COUNT; ++swapIndex) {
+            FbrComputeCompositeCacheEntry *pEntry = &pDescriptors->pComputeCompositeCache[framebufferIndex][swapIndex];
+            // keep the set itself around to be rewritten
+            *pEntry = (FbrComputeCompositeCacheEntry) {
+                    .set = pEntry->set,
+            };
+        }
+    }
+}
+
 static FBR_RESULT createSetLayoutComputeComposite(const FbrVulkan *pVulkan,
                                                   FbrSetLayoutComputeComposite *pSetLayout)
 {
@@ -387,62 +510,21 @@ static FBR_RESULT createSetLayoutComputeComposite(const FbrVulkan *pVulkan,
             .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
             .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
     });
-    FBR_ACK(createPushedDescriptorSetLayout(pVulkan, pSetLayout));
+    FBR_ACK(createSetLayout(pVulkan, "ComputeComposite", 0, pSetLayout));
     return FBR_SUCCESS;
 }
 
 FBR_RESULT fbrCreateSetMeshComposite(const FbrVulkan *pVulkan,
                                      const FbrDescriptors *pDescriptors,
-                                     const FbrCamera *pNodeCamera,
-                                     VkImageView inputColorImageView,
-                                     VkImageView inputNormalImageView,
-                                     VkImageView inputGBufferImageView,
-                                     VkImageView inputDepthImageView,
-                                     FbrSetComputeComposite *pSet)
+                                     FbrSetMeshComposite *pSet)
 {
-    FBR_ACK(allocateDescriptorSet(pVulkan,
-                                  &pDescriptors->setLayoutMeshComposite,
-                                  pSet));
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &(VkDescriptorBufferInfo) {
-                    .buffer = pNodeCamera->pUBO->uniformBuffer,
-                    .range = sizeof(FbrCamera),
-            },
-    }, pSet);
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputColorImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputNormalImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputGBufferImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    pushDescriptorWrite((VkWriteDescriptorSet) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .pImageInfo = &(VkDescriptorImageInfo) {
-                    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                    .imageView = inputDepthImageView,
-                    .sampler = pVulkan->linearSampler,
-            },
-    }, pSet);
-    writePushedDescriptors(pVulkan);
+    FBR_ACK(fbrAllocatePersistentDescriptorSet(pVulkan,
+                                               &pDescriptors->setLayoutMeshComposite,
+                                               pSet));
+    const FbrDescriptorInfo pInfos[] = {
+            dynamicUBOInfo(pVulkan, sizeof(FbrCameraBuffer)),
+    };
+    writeDescriptorSet(pVulkan, &pDescriptors->setLayoutMeshComposite, pInfos, *pSet);
     return FBR_SUCCESS;
 }
 
@@ -450,26 +532,10 @@ static FBR_RESULT createSetLayoutMeshComposite(const FbrVulkan *pVulkan,
                                                FbrSetLayoutMeshComposite *pSetLayout)
 {
     pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
-    });
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
-    });
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
-    });
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
     });
-    pushLayoutBinding((VkDescriptorSetLayoutBinding) {
-            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT,
-    });
-    FBR_ACK(createPushedDescriptorSetLayout(pVulkan, pSetLayout));
+    FBR_ACK(createSetLayout(pVulkan, "MeshComposite", 0, pSetLayout));
     return FBR_SUCCESS;
 }
 
@@ -478,7 +544,7 @@ static FBR_RESULT createSetLayouts(const FbrVulkan *pVulkan,
 {
     createSetLayoutGlobal(pVulkan, &pDescriptors->setLayoutGlobal);
     createSetLayoutPass(pVulkan, &pDescriptors->setLayoutPass);
-    createSetLayoutMaterial(pVulkan, &pDescriptors->setLayoutMaterial);
+    createSetLayoutTextures(pVulkan, &pDescriptors->setLayoutTextures);
     createSetLayoutObject(pVulkan, &pDescriptors->setLayoutObject);
     createSetLayoutNode(pVulkan, &pDescriptors->setLayoutNode);
     createSetLayoutComputeComposite(pVulkan, &pDescriptors->setLayoutComputeComposite);
@@ -493,25 +559,39 @@ FBR_RESULT fbrCreateDescriptors(const FbrVulkan *pVulkan,
     FbrDescriptors *pDescriptors_Std = *ppAllocDescriptors;
 
     arrsetcap(pLayoutBindingArray, 16);
-    arrsetcap(pDescriptorWriteArray, 16);
 
     createSetLayouts(pVulkan, pDescriptors_Std);
+
+    // These only point at the dynamic UBO so one of each serves every camera, node and transform
+    FBR_ACK(fbrCreateSetGlobal(pVulkan, pDescriptors_Std, &pDescriptors_Std->setGlobal));
+    FBR_ACK(fbrCreateSetNode(pVulkan, pDescriptors_Std, &pDescriptors_Std->setNode));
+    FBR_ACK(fbrCreateSetMeshComposite(pVulkan, pDescriptors_Std, &pDescriptors_Std->setMeshComposite));
+    FBR_ACK(createSetTextures(pVulkan, pDescriptors_Std));
     return FBR_SUCCESS;
 }
 
+static void destroySetLayout(const FbrVulkan *pVulkan, FbrSetLayout *pSetLayout)
+{
+    if (pSetLayout->updateTemplate != VK_NULL_HANDLE)
+        vkDestroyDescriptorUpdateTemplate(pVulkan->device, pSetLayout->updateTemplate, NULL);
+    vkDestroyDescriptorSetLayout(pVulkan->device, pSetLayout->layout, NULL);
+}
+
 void fbrDestroyDescriptors(const FbrVulkan *pVulkan,
                            FbrDescriptors *pDescriptors)
 {
-    vkDestroyDescriptorSetLayout(pVulkan->device, pDescriptors->setLayoutGlobal.layout, NULL);
-    vkDestroyDescriptorSetLayout(pVulkan->device, pDescriptors->setLayoutPass.layout, NULL);
-    vkDestroyDescriptorSetLayout(pVulkan->device, pDescriptors->setLayoutMaterial.layout, NULL);
-    vkDestroyDescriptorSetLayout(pVulkan->device, pDescriptors->setLayoutObject.layout, NULL);
-    vkDestroyDescriptorSetLayout(pVulkan->device, pDescriptors->setLayoutComputeComposite.layout, NULL);
-    vkDestroyDescriptorSetLayout(pVulkan->device, pDescriptors->setLayoutNode.layout, NULL);
-
-    vkFreeDescriptorSets(pVulkan->device, pVulkan->descriptorPool, 1, &pDescriptors->setGlobal);
-    if (pDescriptors->setPass != NULL)
-        vkFreeDescriptorSets(pVulkan->device, pVulkan->descriptorPool, 1, &pDescriptors->setPass);
+    destroySetLayout(pVulkan, &pDescriptors->setLayoutGlobal);
+    destroySetLayout(pVulkan, &pDescriptors->setLayoutPass);
+    destroySetLayout(pVulkan, &pDescriptors->setLayoutTextures);
+    destroySetLayout(pVulkan, &pDescriptors->setLayoutObject);
+    destroySetLayout(pVulkan, &pDescriptors->setLayoutComputeComposite);
+    destroySetLayout(pVulkan, &pDescriptors->setLayoutNode);
+    destroySetLayout(pVulkan, &pDescriptors->setLayoutMeshComposite);
+
+    // the other sets are persistent and go with the descriptor allocator's pools
+    // frees setTextures with it
+    vkDestroyDescriptorPool(pVulkan->device, pDescriptors->texturesPool, NULL);
+    arrfree(pDescriptors->pFreeTextureIndices);
 
     free(pDescriptors);
 }
\ No newline at end of file
@@ -6,9 +6,17 @@
 #include "fbr_swap.h"
 #include <vulkan/vulkan.h>
 
+// Core types only, SAMPLER through INPUT_ATTACHMENT
+#define FBR_DESCRIPTOR_TYPE_COUNT (VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1)
+
 typedef struct FbrSetLayout {
+    const char *pName;
     VkDescriptorSetLayout layout;
+    // VK_NULL_HANDLE for push descriptor layouts
+    VkDescriptorUpdateTemplate updateTemplate;
     int bindingCount;
+    // what one set takes out of a pool
+    uint32_t pDescriptorCounts[FBR_DESCRIPTOR_TYPE_COUNT];
 } FbrSetLayout;
 
 #define FBR_DEFINE_DESCRIPTOR(name) \
@@ -21,8 +29,10 @@ FBR_DEFINE_DESCRIPTOR(Global)
 #define FBR_PASS_SET_INDEX 1
 FBR_DEFINE_DESCRIPTOR(Pass)
 
-#define FBR_MATERIAL_SET_INDEX 2
-FBR_DEFINE_DESCRIPTOR(Material)
+// One update-after-bind array holding every sampled texture, indexed through FbrTextureIndices push constants
+#define FBR_TEXTURES_SET_INDEX 2
+#define FBR_TEXTURES_CAPACITY 1024
+FBR_DEFINE_DESCRIPTOR(Textures)
 
 #define FBR_OBJECT_SET_INDEX 3
 FBR_DEFINE_DESCRIPTOR(Object)
@@ -38,6 +48,23 @@ FBR_DEFINE_DESCRIPTOR(MeshComposite)
 
 #define FBR_STRUCT_DESCRIPTOR(name) FbrSetLayout##name setLayout##name;
 
+#define FBR_TEXTURE_INDICES_STAGES (VK_SHADER_STAGE_VERTEX_BIT | \
+                                    VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT | \
+                                    VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT | \
+                                    VK_SHADER_STAGE_FRAGMENT_BIT | \
+                                    VK_SHADER_STAGE_TASK_BIT_EXT | \
+                                    VK_SHADER_STAGE_MESH_BIT_EXT)
+
+// Views the set was written with, if the framebuffer or swap gets recreated they won't match and the set is rewritten
+typedef struct FbrComputeCompositeCacheEntry {
+    VkImageView inputColorImageView;
+    VkImageView inputNormalImageView;
+    VkImageView inputGBufferImageView;
+    VkImageView inputDepthImageView;
+    VkImageView outputColorImageView;
+    FbrSetComputeComposite set;
+} FbrComputeCompositeCacheEntry;
+
 typedef struct FbrDescriptors {
     FBR_STRUCT_DESCRIPTOR(Global)
     FbrSetGlobal setGlobal;
@@ -45,68 +72,79 @@ typedef struct FbrDescriptors {
     FBR_STRUCT_DESCRIPTOR(Pass)
     FbrSetPass setPass;
 
-    FBR_STRUCT_DESCRIPTOR(Material)
-    FbrSetMaterial setMaterial;
+    FBR_STRUCT_DESCRIPTOR(Textures)
+    FbrSetTextures setTextures;
+    VkDescriptorPool texturesPool;
+    uint32_t texturesCount;
+    // stb_ds array of released indices
+    uint32_t *pFreeTextureIndices;
 
+    // pushed per draw, see fbrPushSetObject
     FBR_STRUCT_DESCRIPTOR(Object)
-    FbrSetObject setObject;
 
     FBR_STRUCT_DESCRIPTOR(Node)
     FbrSetNode setNode;
 
     FBR_STRUCT_DESCRIPTOR(ComputeComposite)
-    FbrSetComputeComposite setComputeComposite;
+    FbrComputeCompositeCacheEntry pComputeCompositeCache[FBR_FRAMEBUFFER_COUNT][FBR_SWAP_COUNT];
 
     FBR_STRUCT_DESCRIPTOR(MeshComposite)
-    FbrSetMeshComposite setMeshComposites[2];
+    FbrSetMeshComposite setMeshComposite;
 } FbrDescriptors;
 
 FBR_RESULT fbrCreateSetGlobal(const FbrVulkan *pVulkan,
                               const FbrDescriptors *pDescriptors,
-                              const FbrCamera *pCamera,
-                              FbrSetPass *pSet);
+                              FbrSetGlobal *pSet);
 
 FBR_RESULT fbrCreateSetPass(const FbrVulkan *pVulkan,
                             const FbrDescriptors *pDescriptors,
                             const FbrTexture *pNormalTexture,
                             FbrSetPass *pSet);
 
-FBR_RESULT fbrCreateSetMaterial(const FbrVulkan *pVulkan,
-                                const FbrDescriptors *pDescriptors,
-                                const FbrTexture *pTexture,
-                                FbrSetMaterial *pSet);
+// Writes the view into a free slot of the texture array, the index is what shaders sample with.
+FBR_RESULT fbrAcquireTextureIndex(const FbrVulkan *pVulkan,
+                                  FbrDescriptors *pDescriptors,
+                                  VkImageView imageView,
+                                  uint32_t *pIndex);
 
-FBR_RESULT fbrCreateSetObject(const FbrVulkan *pVulkan,
-                              const FbrDescriptors *pDescriptors,
-                              const FbrTransform *pTransform,
-                              FbrSetObject *pSet);
+// Only call once nothing in flight samples the index.
+void fbrReleaseTextureIndex(FbrDescriptors *pDescriptors, uint32_t index);
+
+void fbrPushTextureIndices(VkCommandBuffer commandBuffer,
+                           VkPipelineLayout pipelineLayout,
+                           const FbrTextureIndices *pIndices);
+
+// Records the transform into FBR_OBJECT_SET_INDEX as a push descriptor.
+void fbrPushSetObject(const FbrVulkan *pVulkan,
+                      VkCommandBuffer commandBuffer,
+                      VkPipelineLayout pipelineLayout,
+                      const FbrTransform *pTransform);
 
 FBR_RESULT fbrCreateSetNode(const FbrVulkan *pVulkan,
                             const FbrDescriptors *pDescriptors,
-                            const FbrTransform *pTransform,
-                            const FbrCamera *pCamera,
-                            const FbrTexture *pColorTexture,
-                            const FbrTexture *pNormalTexture,
-                            const FbrTexture *pDepthTexture,
                             FbrSetNode *pSet);
 
-FBR_RESULT fbrCreateSetComputeComposite(const FbrVulkan *pVulkan,
-                                        const FbrDescriptors *pDescriptors,
-                                        VkImageView inputColorImageView,
-                                        VkImageView inputNormalImageView,
-                                        VkImageView inputGBufferImageView,
-                                        VkImageView inputDepthImageView,
-                                        VkImageView outputColorImageView,
-                                        FbrSetComputeComposite *pSet);
+// Returns the cached set for this framebuffer and swap image, writing it first if missing or stale.
+FBR_RESULT fbrGetSetComputeComposite(const FbrVulkan *pVulkan,
+                                     FbrDescriptors *pDescriptors,
+                                     uint32_t framebufferIndex,
+                                     uint32_t swapIndex,
+                                     const FbrFramebuffer *pFramebuffer,
+                                     VkImageView outputColorImageView,
+                                     FbrSetComputeComposite *pSet);
+
+// Builds every framebuffer x swap image combination up front so the frame loop never writes descriptors.
+FBR_RESULT fbrCreateSetsComputeComposite(const FbrVulkan *pVulkan,
+                                         FbrDescriptors *pDescriptors,
+                                         FbrFramebuffer *const *ppFramebuffers,
+                                         const FbrSwap *pSwap);
+
+// Call on resize or re-import, the next get rewrites every set.
+void fbrInvalidateSetsComputeComposite(FbrDescriptors *pDescriptors);
 
 FBR_RESULT fbrCreateSetMeshComposite(const FbrVulkan *pVulkan,
                                      const FbrDescriptors *pDescriptors,
-                                     const FbrCamera *pNodeCamera,
-                                     VkImageView inputColorImageView,
-                                     VkImageView inputNormalImageView,
-                                     VkImageView inputGBufferImageView,
-                                     VkImageView inputDepthImageView,
-                                     FbrSetComputeComposite *pSet);
+                                     FbrSetMeshComposite *pSet);
 
 FBR_RESULT fbrCreateDescriptors(const FbrVulkan *pVulkan,
                                 FbrDescriptors **ppAllocDescriptors);
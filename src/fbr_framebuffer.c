@@ -570,7 +570,7 @@ void fbrAcquireFramebufferFromExternalAttachToComputeRead(const FbrVulkan *pVulk
                     FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
             },
     };
-    vkCmdPipelineBarrier(pVulkan->graphicsCommandBuffer,
+    vkCmdPipelineBarrier(pVulkan->computeCommandBuffer,
                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                          0,
@@ -585,12 +585,12 @@ void fbrAcquireFramebufferFromExternalAttachToComputeRead(const FbrVulkan *pVulk
                     .oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
                     .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                     .srcQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL,
-                    .dstQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
+                    .dstQueueFamilyIndex = pVulkan->computeQueueFamilyIndex,
                     .image = pFramebuffer->pDepthTexture->image,
                     FBR_DEFAULT_DEPTH_SUBRESOURCE_RANGE
             }
     };
-    vkCmdPipelineBarrier(pVulkan->graphicsCommandBuffer,
+    vkCmdPipelineBarrier(pVulkan->computeCommandBuffer,
                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
                          0,
@@ -638,7 +638,7 @@ void fbrAcquireFramebufferFromExternalAttachToGraphicsRead(const FbrVulkan *pVul
     };
     vkCmdPipelineBarrier(pVulkan->graphicsCommandBuffer,
                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                         VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                          0,
                          0, NULL,
                          0, NULL,
@@ -658,13 +658,123 @@ void fbrAcquireFramebufferFromExternalAttachToGraphicsRead(const FbrVulkan *pVul
     };
     vkCmdPipelineBarrier(pVulkan->graphicsCommandBuffer,
                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                         VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TESSELLATION_CONTROL_SHADER_BIT | VK_PIPELINE_STAGE_TESSELLATION_EVALUATION_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                          0,
                          0, NULL,
                          0, NULL,
                          COUNT(pAcquireChildDepthFrameBufferBarrier), pAcquireChildDepthFrameBufferBarrier);
 }
 
+static void recordFramebufferReadOwnership(VkCommandBuffer commandBuffer,
+                                           const FbrFramebuffer *pFramebuffer,
+                                           uint32_t srcQueueFamilyIndex,
+                                           uint32_t dstQueueFamilyIndex,
+                                           VkAccessFlags dstAccessMask,
+                                           VkPipelineStageFlags srcStageMask,
+                                           VkPipelineStageFlags dstStageMask)
+{
+    const VkImage pColorImages[] = {
+            pFramebuffer->pColorTexture->image,
+            pFramebuffer->pNormalTexture->image,
+            pFramebuffer->pGBufferTexture->image,
+    };
+    VkImageMemoryBarrier pBarriers[COUNT(pColorImages) + 1];
+    for (uint32_t i = 0; i < COUNT(pColorImages); ++i) {
+        pBarriers[i] = (VkImageMemoryBarrier) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = dstAccessMask,
+                .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .srcQueueFamilyIndex = srcQueueFamilyIndex,
+                .dstQueueFamilyIndex = dstQueueFamilyIndex,
+                .image = pColorImages[i],
+                FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+        };
+    }
+    pBarriers[COUNT(pColorImages)] = (VkImageMemoryBarrier) {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = 0,
+            .dstAccessMask = dstAccessMask,
+            .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .srcQueueFamilyIndex = srcQueueFamilyIndex,
+            .dstQueueFamilyIndex = dstQueueFamilyIndex,
+            .image = pFramebuffer->pDepthTexture->image,
+            FBR_DEFAULT_DEPTH_SUBRESOURCE_RANGE
+    };
+    vkCmdPipelineBarrier(commandBuffer,
+                         srcStageMask,
+                         dstStageMask,
+                         0,
+                         0, NULL,
+                         0, NULL,
+                         COUNT(pBarriers), pBarriers);
+}
+
+static VkResult submitFramebufferReadOwnership(const FbrVulkan *pVulkan,
+                                               uint32_t queueFamilyIndex,
+                                               const FbrFramebuffer *pFramebuffer,
+                                               uint32_t srcQueueFamilyIndex,
+                                               uint32_t dstQueueFamilyIndex,
+                                               VkAccessFlags dstAccessMask,
+                                               VkPipelineStageFlags srcStageMask,
+                                               VkPipelineStageFlags dstStageMask)
+{
+    // the frame command buffers are idle between main loops
+    const bool isGraphics = queueFamilyIndex == pVulkan->graphicsQueueFamilyIndex;
+    const VkCommandBuffer commandBuffer = isGraphics ? pVulkan->graphicsCommandBuffer : pVulkan->computeCommandBuffer;
+    const VkQueue queue = isGraphics ? pVulkan->graphicsQueue : pVulkan->computeQueue;
+
+    FBR_ACK(vkResetCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT));
+    const VkCommandBufferBeginInfo beginInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    FBR_ACK(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+    recordFramebufferReadOwnership(commandBuffer,
+                                   pFramebuffer,
+                                   srcQueueFamilyIndex,
+                                   dstQueueFamilyIndex,
+                                   dstAccessMask,
+                                   srcStageMask,
+                                   dstStageMask);
+    FBR_ACK(vkEndCommandBuffer(commandBuffer));
+
+    const VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &commandBuffer,
+    };
+    FBR_ACK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+    FBR_ACK(vkQueueWaitIdle(queue));
+    return FBR_SUCCESS;
+}
+
+VkResult fbrTransferFramebufferReadImmediate(const FbrVulkan *pVulkan,
+                                             const FbrFramebuffer *pFramebuffer,
+                                             uint32_t srcQueueFamilyIndex,
+                                             uint32_t dstQueueFamilyIndex)
+{
+    FBR_ACK(submitFramebufferReadOwnership(pVulkan,
+                                           srcQueueFamilyIndex,
+                                           pFramebuffer,
+                                           srcQueueFamilyIndex,
+                                           dstQueueFamilyIndex,
+                                           0,
+                                           VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                           VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT));
+    FBR_ACK(submitFramebufferReadOwnership(pVulkan,
+                                           dstQueueFamilyIndex,
+                                           pFramebuffer,
+                                           srcQueueFamilyIndex,
+                                           dstQueueFamilyIndex,
+                                           VK_ACCESS_SHADER_READ_BIT,
+                                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                           VK_PIPELINE_STAGE_ALL_COMMANDS_BIT));
+    return FBR_SUCCESS;
+}
+
 void fbrTransitionFramebufferFromIgnoredReadToGraphicsAttach(const FbrVulkan *pVulkan, const FbrFramebuffer *pFramebuffer)
 {
     const VkImageMemoryBarrier pAcquireFrameBufferBarrier[] = {
@@ -56,6 +56,13 @@ void fbrAcquireFramebufferFromGraphicsAttachToComputeRead(const FbrVulkan *pVulk
 void fbrAcquireFramebufferFromExternalAttachToGraphicsRead(const FbrVulkan *pVulkan,
                                                            const FbrFramebuffer *pFramebuffer);
 
+// Moves a framebuffer already in SHADER_READ_ONLY from one queue family to another, waiting on both queues.
+// Only for between main loops, it records into the idle frame command buffers.
+VkResult fbrTransferFramebufferReadImmediate(const FbrVulkan *pVulkan,
+                                             const FbrFramebuffer *pFramebuffer,
+                                             uint32_t srcQueueFamilyIndex,
+                                             uint32_t dstQueueFamilyIndex);
+
 void fbrTransitionFramebufferFromIgnoredReadToGraphicsAttach(const FbrVulkan *pVulkan,
                                                              const FbrFramebuffer *pFramebuffer);
 
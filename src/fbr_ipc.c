@@ -2,6 +2,7 @@
 #include "fbr_ipc.h"
 #include "fbr_log.h"
 #include "fbr_ipc_targets.h"
+#include "fbr_trace.h"
 
 const char sharedMemoryName[] = "FbrIPCRingBuffer";
 const char sharedTempCamMemoryName[] = "FbrIPCCamera";
@@ -102,6 +103,7 @@ int fbrIPCPollDeque(FbrApp *pApp, FbrIPCRingBuffer *pIPC)
     }
 
     FBR_LOG_MESSAGE("Calling IPC Target", target);
+    fbrTraceInstant(FBR_TRACE_CATEGORY_IPC, "ipc dequeue", target);
     pIPC->pTargetFuncs[target](pApp, param);
 
     pIPCBuffer->tail = pIPCBuffer->tail + FBR_IPC_RING_HEADER_SIZE + fbrIPCTargetParamSize(target);
@@ -115,6 +117,7 @@ void fbrIPCEnque(FbrIPCRingBuffer *pIPC, FbrIPCTargetType target, void *param)
     pIPCBuffer->pRingBuffer[pIPCBuffer->head] = target;
     memcpy(pIPCBuffer->pRingBuffer + pIPCBuffer->head + FBR_IPC_RING_HEADER_SIZE, param, fbrIPCTargetParamSize(target));
     pIPCBuffer->head = pIPCBuffer->head + FBR_IPC_RING_HEADER_SIZE + fbrIPCTargetParamSize(target);
+    fbrTraceInstant(FBR_TRACE_CATEGORY_IPC, "ipc enqueue", target);
 }
 
 int fbrCreateProducerIPCRingBuffer(FbrIPCRingBuffer **ppAllocIPC)
@@ -144,27 +147,33 @@ int fbrCreateReceiverIPCRingBuffer(FbrIPCRingBuffer **ppAllocIPC)
 }
 
 int fbrCreateIPCBuffer(FbrIPCBuffer **ppAllocIPC, int bufferSize)
+{
+    return fbrCreateNamedIPCBuffer(ppAllocIPC, sharedTempCamMemoryName, bufferSize);
+}
+
+int fbrImportIPCBuffer(FbrIPCBuffer **ppAllocIPC,  int bufferSize)
+{
+    return fbrImportNamedIPCBuffer(ppAllocIPC, sharedTempCamMemoryName, bufferSize);
+}
+
+int fbrCreateNamedIPCBuffer(FbrIPCBuffer **ppAllocIPC, const char *pSharedMemoryName, int bufferSize)
 {
     FBR_LOG_MESSAGE("Creating Producer IPC", bufferSize);
 
     *ppAllocIPC = calloc(1, sizeof(FbrIPCRingBuffer));
     FbrIPCBuffer *pIPC = *ppAllocIPC;
 
-    createIPCBuffer(bufferSize, sharedTempCamMemoryName, &pIPC->hMapFile, &pIPC->pBuffer);
-
-    return 0;
+    return createIPCBuffer(bufferSize, pSharedMemoryName, &pIPC->hMapFile, &pIPC->pBuffer);
 }
 
-int fbrImportIPCBuffer(FbrIPCBuffer **ppAllocIPC,  int bufferSize)
+int fbrImportNamedIPCBuffer(FbrIPCBuffer **ppAllocIPC, const char *pSharedMemoryName, int bufferSize)
 {
     FBR_LOG_MESSAGE("Creating Receiver IPC", bufferSize);
 
     *ppAllocIPC = calloc(1, sizeof(FbrIPCRingBuffer));
     FbrIPCBuffer *pIPC = *ppAllocIPC;
 
-    createImportIPCBuffer(bufferSize, sharedTempCamMemoryName, &pIPC->hMapFile, &pIPC->pBuffer);
-
-    return 0;
+    return createImportIPCBuffer(bufferSize, pSharedMemoryName, &pIPC->hMapFile, &pIPC->pBuffer);
 }
 
 void fbrDestroyIPCBuffer(FbrIPCBuffer *pIPC)
@@ -51,6 +51,10 @@ int fbrCreateIPCBuffer(FbrIPCBuffer **ppAllocIPC, int bufferSize);
 
 int fbrImportIPCBuffer(FbrIPCBuffer **ppAllocIPC, int bufferSize);
 
+int fbrCreateNamedIPCBuffer(FbrIPCBuffer **ppAllocIPC, const char *pSharedMemoryName, int bufferSize);
+
+int fbrImportNamedIPCBuffer(FbrIPCBuffer **ppAllocIPC, const char *pSharedMemoryName, int bufferSize);
+
 void fbrDestroyIPCBuffer(FbrIPCBuffer *pIPC);
 
 void fbrDestroyIPCRingBuffer(FbrIPCRingBuffer *pIPC);
@@ -0,0 +1,238 @@
+#include "fbr_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+typedef struct FbrLogRecord {
+    const FbrLogSite *pSite;
+    int64_t timestamp;
+    // string arguments hold their offset into pStringData
+    FbrLogArg pArgs[FBR_LOG_MAX_ARG_COUNT];
+    char pStringData[FBR_LOG_STRING_DATA_SIZE];
+} FbrLogRecord;
+
+// Single producer is the owning thread, single consumer is whoever holds the flush lock
+typedef struct FbrLogRing {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t droppedCount;
+    struct FbrLogRing *pNext;
+    FbrLogRecord pRecords[FBR_LOG_RING_CAPACITY];
+} FbrLogRing;
+
+static _Thread_local FbrLogRing *pThreadRing;
+// rings are only ever pushed, they live until the process exits so the flush thread never sees one freed
+static FbrLogRing *pRings;
+
+#ifdef WIN32
+static SRWLOCK flushLock = SRWLOCK_INIT;
+static HANDLE flushThread;
+static int flushThreadStarted;
+static int flushThreadRunning;
+#endif
+
+static int64_t getLogTimestamp() {
+#ifdef WIN32
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (int64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+static const char *stripPath(const char *pFile) {
+    const char *pSlash = strrchr(pFile, '/');
+    const char *pBackslash = strrchr(pFile, '\\');
+    if (pBackslash > pSlash)
+        pSlash = pBackslash;
+    return pSlash != NULL ? pSlash + 1 : pFile;
+}
+
+static void formatArg(FILE *file, const FbrLogRecord *pRecord, int index) {
+    const FbrLogArg arg = pRecord->pArgs[index];
+    switch (pRecord->pSite->pArgTypes[index]) {
+        case FBR_LOG_ARG_BOOL:
+            fprintf(file, "%d", (int) arg.unsignedValue);
+            break;
+        case FBR_LOG_ARG_CHAR:
+            fprintf(file, "%c", (char) arg.signedValue);
+            break;
+        case FBR_LOG_ARG_SIGNED:
+            fprintf(file, "%lld", arg.signedValue);
+            break;
+        case FBR_LOG_ARG_UNSIGNED:
+            fprintf(file, "%llu", arg.unsignedValue);
+            break;
+        case FBR_LOG_ARG_DOUBLE:
+            fprintf(file, "%f", arg.doubleValue);
+            break;
+        case FBR_LOG_ARG_STRING:
+            fputs(pRecord->pStringData + arg.unsignedValue, file);
+            break;
+        case FBR_LOG_ARG_LITERAL:
+            fputs(arg.pString, file);
+            break;
+        case FBR_LOG_ARG_POINTER:
+            fprintf(file, "%p", arg.pPointer);
+            break;
+    }
+}
+
+static void formatRecord(FILE *file, const FbrLogRecord *pRecord) {
+    const FbrLogSite *pSite = pRecord->pSite;
+    if (pSite->level == FBR_LOG_LEVEL_ERROR) {
+        fprintf(file, "###ERRROR### %s:%s:%d: ", stripPath(pSite->pFile), pSite->pFunction, pSite->line);
+    } else {
+        fprintf(file, "(%s:%d) ", stripPath(pSite->pFile), pSite->line);
+    }
+    for (int i = 0; i < pSite->argCount; ++i) {
+        if (i > 0)
+            fputs(" | ", file);
+        if (pSite->pArgNames[i] != NULL)
+            fprintf(file, "%s: ", pSite->pArgNames[i]);
+        formatArg(file, pRecord, i);
+    }
+    fputc('\n', file);
+}
+
+// Caller must hold the flush lock. Rings are merged oldest first so output from different threads interleaves in order.
+static void drainRings() {
+    while (true) {
+        FbrLogRing *pOldestRing = NULL;
+        int64_t oldestTimestamp = INT64_MAX;
+        for (FbrLogRing *pRing = __atomic_load_n(&pRings, __ATOMIC_ACQUIRE); pRing != NULL; pRing = pRing->pNext) {
+            const uint32_t head = __atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE);
+            if (head == pRing->tail)
+                continue;
+            const int64_t timestamp = pRing->pRecords[pRing->tail & (FBR_LOG_RING_CAPACITY - 1)].timestamp;
+            if (pOldestRing == NULL || timestamp < oldestTimestamp) {
+                pOldestRing = pRing;
+                oldestTimestamp = timestamp;
+            }
+        }
+        if (pOldestRing == NULL)
+            break;
+
+        formatRecord(stdout, &pOldestRing->pRecords[pOldestRing->tail & (FBR_LOG_RING_CAPACITY - 1)]);
+        __atomic_store_n(&pOldestRing->tail, pOldestRing->tail + 1, __ATOMIC_RELEASE);
+    }
+
+    for (FbrLogRing *pRing = __atomic_load_n(&pRings, __ATOMIC_ACQUIRE); pRing != NULL; pRing = pRing->pNext) {
+        const uint32_t droppedCount = __atomic_exchange_n(&pRing->droppedCount, 0, __ATOMIC_RELAXED);
+        if (droppedCount > 0)
+            printf("###LOG### Ring full, dropped %u records.\n", droppedCount);
+    }
+
+    fflush(stdout);
+}
+
+#ifdef WIN32
+static DWORD WINAPI runFlushThread(LPVOID pParam) {
+    while (__atomic_load_n(&flushThreadRunning, __ATOMIC_ACQUIRE)) {
+        AcquireSRWLockExclusive(&flushLock);
+        drainRings();
+        ReleaseSRWLockExclusive(&flushLock);
+        Sleep(FBR_LOG_FLUSH_INTERVAL_MS);
+    }
+    return 0;
+}
+
+static void stopFlushThread() {
+    __atomic_store_n(&flushThreadRunning, 0, __ATOMIC_RELEASE);
+    WaitForSingleObject(flushThread, INFINITE);
+    CloseHandle(flushThread);
+    fbrFlushLog();
+}
+
+static void startFlushThread() {
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&flushThreadStarted, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return;
+
+    __atomic_store_n(&flushThreadRunning, 1, __ATOMIC_RELEASE);
+    flushThread = CreateThread(NULL, 0, runFlushThread, NULL, 0, NULL);
+    if (flushThread == NULL) {
+        // records still go out whenever an error flushes, or at exit
+        printf("###LOG### Failed to start flush thread!\n");
+        atexit(fbrFlushLog);
+        return;
+    }
+    atexit(stopFlushThread);
+}
+#endif
+
+static FbrLogRing *getThreadRing() {
+    if (pThreadRing != NULL)
+        return pThreadRing;
+
+    pThreadRing = calloc(1, sizeof(FbrLogRing));
+    FbrLogRing *pHead = __atomic_load_n(&pRings, __ATOMIC_RELAXED);
+    do {
+        pThreadRing->pNext = pHead;
+    } while (!__atomic_compare_exchange_n(&pRings, &pHead, pThreadRing, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+#ifdef WIN32
+    startFlushThread();
+#endif
+
+    return pThreadRing;
+}
+
+void fbrLogWrite(const FbrLogSite *pSite, const FbrLogArg *pArgs) {
+    FbrLogRing *pRing = getThreadRing();
+
+    const uint32_t head = pRing->head;
+    if (head - __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE) >= FBR_LOG_RING_CAPACITY) {
+        __atomic_fetch_add(&pRing->droppedCount, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    FbrLogRecord *pRecord = &pRing->pRecords[head & (FBR_LOG_RING_CAPACITY - 1)];
+    pRecord->pSite = pSite;
+    pRecord->timestamp = getLogTimestamp();
+
+    // the last byte stays 0 so anything that doesn't fit reads back as an empty string
+    size_t stringOffset = 0;
+    pRecord->pStringData[FBR_LOG_STRING_DATA_SIZE - 1] = '\0';
+    for (int i = 0; i < pSite->argCount; ++i) {
+        if (pSite->pArgTypes[i] != FBR_LOG_ARG_STRING) {
+            pRecord->pArgs[i] = pArgs[i];
+            continue;
+        }
+        const char *pString = pArgs[i].pString != NULL ? pArgs[i].pString : "(null)";
+        const size_t available = FBR_LOG_STRING_DATA_SIZE - 1 - stringOffset;
+        size_t length = strlen(pString);
+        if (length > available)
+            length = available;
+        memcpy(pRecord->pStringData + stringOffset, pString, length);
+        pRecord->pStringData[stringOffset + length] = '\0';
+        pRecord->pArgs[i].unsignedValue = stringOffset;
+        stringOffset += length < available ? length + 1 : length;
+    }
+
+    __atomic_store_n(&pRing->head, head + 1, __ATOMIC_RELEASE);
+
+#ifndef WIN32
+    // no flush thread, format right away
+    drainRings();
+#endif
+}
+
+void fbrFlushLog() {
+#ifdef WIN32
+    AcquireSRWLockExclusive(&flushLock);
+    drainRings();
+    ReleaseSRWLockExclusive(&flushLock);
+#else
+    drainRings();
+#endif
+}
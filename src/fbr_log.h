@@ -4,102 +4,187 @@
 #include "fbr_macros.h"
 
 #include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Log calls copy a record into a ring owned by the calling thread and return, a background thread formats
+// and prints them. Levels below FBR_LOG_LEVEL compile to nothing, their arguments are never evaluated.
+#define FBR_LOG_LEVEL_DEBUG 0
+#define FBR_LOG_LEVEL_MESSAGE 1
+#define FBR_LOG_LEVEL_ERROR 2
+
+#ifndef FBR_LOG_LEVEL
+#ifdef NDEBUG
+#define FBR_LOG_LEVEL FBR_LOG_LEVEL_MESSAGE
+#else
+#define FBR_LOG_LEVEL FBR_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+#define FBR_LOG_MAX_ARG_COUNT 5
+// records written while a ring is full are dropped and counted, must be a power of two
+#define FBR_LOG_RING_CAPACITY 1024
+// string arguments are copied into the record, longer ones are truncated
+#define FBR_LOG_STRING_DATA_SIZE 72
+#define FBR_LOG_FLUSH_INTERVAL_MS 4
+
+typedef enum FbrLogArgType {
+    FBR_LOG_ARG_BOOL,
+    FBR_LOG_ARG_CHAR,
+    FBR_LOG_ARG_SIGNED,
+    FBR_LOG_ARG_UNSIGNED,
+    FBR_LOG_ARG_DOUBLE,
+    // copied into the record, the caller's buffer may be gone by the time it is formatted
+    FBR_LOG_ARG_STRING,
+    // string literals are stored as a pointer
+    FBR_LOG_ARG_LITERAL,
+    FBR_LOG_ARG_POINTER,
+} FbrLogArgType;
+
+typedef union FbrLogArg {
+    long long signedValue;
+    unsigned long long unsignedValue;
+    double doubleValue;
+    const char *pString;
+    const volatile void *pPointer;
+} FbrLogArg;
+
+// One static per call site, its address is the format id stored in each record
+typedef struct FbrLogSite {
+    uint8_t level;
+    uint8_t argCount;
+    int line;
+    const char *pFile;
+    const char *pFunction;
+    // NULL prints the value alone, used for messages
+    const char *pArgNames[FBR_LOG_MAX_ARG_COUNT];
+    uint8_t pArgTypes[FBR_LOG_MAX_ARG_COUNT];
+} FbrLogSite;
+
+void fbrLogWrite(const FbrLogSite *pSite, const FbrLogArg *pArgs);
+
+// Formats everything queued so far on the calling thread, errors do this so they are never lost.
+void fbrFlushLog();
+
+static inline FbrLogArg fbrLogArgSigned(long long value) { return (FbrLogArg) {.signedValue = value}; }
+static inline FbrLogArg fbrLogArgUnsigned(unsigned long long value) { return (FbrLogArg) {.unsignedValue = value}; }
+static inline FbrLogArg fbrLogArgDouble(double value) { return (FbrLogArg) {.doubleValue = value}; }
+static inline FbrLogArg fbrLogArgString(const char *pString) { return (FbrLogArg) {.pString = pString}; }
+static inline FbrLogArg fbrLogArgPointer(const volatile void *pPointer) { return (FbrLogArg) {.pPointer = pPointer}; }
+
+#define FBR_LOG_ARG_TYPE(x) _Generic((x), \
+    _Bool: FBR_LOG_ARG_BOOL, \
+    char: FBR_LOG_ARG_CHAR, \
+    signed char: FBR_LOG_ARG_SIGNED, \
+    short int: FBR_LOG_ARG_SIGNED, \
+    int: FBR_LOG_ARG_SIGNED, \
+    long int: FBR_LOG_ARG_SIGNED, \
+    long long int: FBR_LOG_ARG_SIGNED, \
+    unsigned char: FBR_LOG_ARG_UNSIGNED, \
+    unsigned short int: FBR_LOG_ARG_UNSIGNED, \
+    unsigned int: FBR_LOG_ARG_UNSIGNED, \
+    unsigned long int: FBR_LOG_ARG_UNSIGNED, \
+    unsigned long long int: FBR_LOG_ARG_UNSIGNED, \
+    float: FBR_LOG_ARG_DOUBLE, \
+    double: FBR_LOG_ARG_DOUBLE, \
+    long double: FBR_LOG_ARG_DOUBLE, \
+    char *: __builtin_constant_p(x) ? FBR_LOG_ARG_LITERAL : FBR_LOG_ARG_STRING, \
+    const char *: __builtin_constant_p(x) ? FBR_LOG_ARG_LITERAL : FBR_LOG_ARG_STRING, \
+    default: FBR_LOG_ARG_POINTER)
+
+#define FBR_LOG_ARG(x) _Generic((x), \
+    _Bool: fbrLogArgUnsigned, \
+    char: fbrLogArgSigned, \
+    signed char: fbrLogArgSigned, \
+    short int: fbrLogArgSigned, \
+    int: fbrLogArgSigned, \
+    long int: fbrLogArgSigned, \
+    long long int: fbrLogArgSigned, \
+    unsigned char: fbrLogArgUnsigned, \
+    unsigned short int: fbrLogArgUnsigned, \
+    unsigned int: fbrLogArgUnsigned, \
+    unsigned long int: fbrLogArgUnsigned, \
+    unsigned long long int: fbrLogArgUnsigned, \
+    float: fbrLogArgDouble, \
+    double: fbrLogArgDouble, \
+    long double: fbrLogArgDouble, \
+    char *: fbrLogArgString, \
+    const char *: fbrLogArgString, \
+    default: fbrLogArgPointer)(x)
+
+#define FBR_LOG_RECORD_1(l, n0, i0) ({ \
+    static const FbrLogSite site = {l, 1, __LINE__, __FILE__, __FUNCTION__, \
+        {n0}, \
+        {FBR_LOG_ARG_TYPE(i0)}}; \
+    fbrLogWrite(&site, (const FbrLogArg[]) {FBR_LOG_ARG(i0)}); \
+})
+#define FBR_LOG_RECORD_2(l, n0, i0, n1, i1) ({ \
+    static const FbrLogSite site = {l, 2, __LINE__, __FILE__, __FUNCTION__, \
+        {n0, n1}, \
+        {FBR_LOG_ARG_TYPE(i0), FBR_LOG_ARG_TYPE(i1)}}; \
+    fbrLogWrite(&site, (const FbrLogArg[]) {FBR_LOG_ARG(i0), FBR_LOG_ARG(i1)}); \
+})
+#define FBR_LOG_RECORD_3(l, n0, i0, n1, i1, n2, i2) ({ \
+    static const FbrLogSite site = {l, 3, __LINE__, __FILE__, __FUNCTION__, \
+        {n0, n1, n2}, \
+        {FBR_LOG_ARG_TYPE(i0), FBR_LOG_ARG_TYPE(i1), FBR_LOG_ARG_TYPE(i2)}}; \
+    fbrLogWrite(&site, (const FbrLogArg[]) {FBR_LOG_ARG(i0), FBR_LOG_ARG(i1), FBR_LOG_ARG(i2)}); \
+})
+#define FBR_LOG_RECORD_4(l, n0, i0, n1, i1, n2, i2, n3, i3) ({ \
+    static const FbrLogSite site = {l, 4, __LINE__, __FILE__, __FUNCTION__, \
+        {n0, n1, n2, n3}, \
+        {FBR_LOG_ARG_TYPE(i0), FBR_LOG_ARG_TYPE(i1), FBR_LOG_ARG_TYPE(i2), FBR_LOG_ARG_TYPE(i3)}}; \
+    fbrLogWrite(&site, (const FbrLogArg[]) {FBR_LOG_ARG(i0), FBR_LOG_ARG(i1), FBR_LOG_ARG(i2), FBR_LOG_ARG(i3)}); \
+})
+#define FBR_LOG_RECORD_5(l, n0, i0, n1, i1, n2, i2, n3, i3, n4, i4) ({ \
+    static const FbrLogSite site = {l, 5, __LINE__, __FILE__, __FUNCTION__, \
+        {n0, n1, n2, n3, n4}, \
+        {FBR_LOG_ARG_TYPE(i0), FBR_LOG_ARG_TYPE(i1), FBR_LOG_ARG_TYPE(i2), FBR_LOG_ARG_TYPE(i3), FBR_LOG_ARG_TYPE(i4)}}; \
+    fbrLogWrite(&site, (const FbrLogArg[]) {FBR_LOG_ARG(i0), FBR_LOG_ARG(i1), FBR_LOG_ARG(i2), FBR_LOG_ARG(i3), FBR_LOG_ARG(i4)}); \
+})
 
-#define FBR_LOG_TYPE_SPECIFIER(x) _Generic((x), \
-    _Bool: "%d", \
-    unsigned char: "%hhu", \
-    char: "%c", \
-    signed char: "%hd", \
-    short int: "%hi", \
-    unsigned short int: "%hu", \
-    int: "%d", \
-    unsigned int: "%u", \
-    long int: "%l", \
-    unsigned long int: "%lu", \
-    long long int: "%lli",\
-    unsigned long long int: "%llu", \
-    float: "%f", \
-    double: "%lf", \
-    long double: "%Lf", \
-    char *: "%s", \
-    const char *: "%s", \
-    void *: "%p", \
-    int *: "%p", \
-    default: "%%")
-
-#define FBR_FILE_NO_PATH (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
 // https://renenyffenegger.ch/notes/development/languages/C-C-plus-plus/preprocessor/macros/__VA_ARGS__/count-arguments
 #define ELEVENTH_ARGUMENT(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, ...) a11
 #define COUNT_ARGUMENTS(...) ELEVENTH_ARGUMENT(dummy, ## __VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
-#define FBR_LOG_DEBUG_1(f0, f1, i0) \
-    printf("(%s:%d) ", f0, f1), \
-    printf("%s: ", #i0), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i0), i0), \
-    printf("\n")
-#define FBR_LOG_DEBUG_2(f0, f1, i0, i1) \
-    printf("(%s:%d) ", f0, f1), \
-    printf("%s: ", #i0), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i0), i0),\
-    printf(" | %s: ", #i1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i1), i1), \
-    printf("\n")
-#define FBR_LOG_DEBUG_3(f0, f1, i0, i1, i2) \
-    printf("(%s:%d) ", f0, f1), \
-    printf("%s: ", #i0), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i0), i0),\
-    printf(" | %s: ", #i1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i1), i1), \
-    printf(" | %s: ", #i2), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i2), i2), \
-    printf("\n")
-#define FBR_LOG_DEBUG_4(f0, f1, i0, i1, i2, i3) \
-    printf("(%s:%d) ", f0, f1), \
-    printf("%s: ", #i0), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i0), i0),\
-    printf(" | %s: ", #i1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i1), i1), \
-    printf(" | %s: ", #i2), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i2), i2), \
-    printf(" | %s: ", #i3), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i3), i3), \
-    printf("\n")
-#define FBR_LOG_DEBUG_5(f0, f1, i0, i1, i2, i3, i4) \
-    printf("(%s:%d) ", f0, f1), \
-    printf("%s: ", #i0), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i0), i0),\
-    printf(" | %s: ", #i1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i1), i1), \
-    printf(" | %s: ", #i2), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i2), i2), \
-    printf(" | %s: ", #i3), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i3), i3), \
-    printf(" | %s: ", #i4), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i4), i4), \
-    printf("\n")
-#define FBR_LOG_DEBUG(...) EXPAND_CONCAT(FBR_LOG_DEBUG_, COUNT_ARGUMENTS(__VA_ARGS__))(FBR_FILE_NO_PATH, __LINE__, ##__VA_ARGS__)
-#define FBR_LOG_MESSAGE_0(f0, f1, m) \
-    printf("(%s:%d) ", f0, f1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(m), m), \
-    printf("\n")
-#define FBR_LOG_MESSAGE_1(f0, f1, m, i0) \
-    printf("(%s:%d) ", f0, f1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(m), m), \
-    printf(" | %s: ", #i0), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i0), i0), \
-    printf("\n")
-#define FBR_LOG_MESSAGE_2(f0, f1, m, i0, i1) \
-    printf("(%s:%d) ", f0, f1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(m), m), \
-    printf(" | %s: ", #i0), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i0), i0),      \
-    printf(" | %s: ", #i1), \
-    printf(FBR_LOG_TYPE_SPECIFIER(i1), i1), \
-    printf("\n")
-#define FBR_LOG_MESSAGE(m, ...) EXPAND_CONCAT(FBR_LOG_MESSAGE_, COUNT_ARGUMENTS(__VA_ARGS__))(FBR_FILE_NO_PATH, __LINE__, m, ##__VA_ARGS__)
-#define FBR_LOG_ERROR_1(f0, f1, f2, e) \
-    printf("###ERRROR### %s:%s:%d: ", f0, f1, f2), \
-    printf(FBR_LOG_TYPE_SPECIFIER(e), e), \
-    printf("\n")
-#define FBR_LOG_ERROR(e) FBR_LOG_ERROR_1(FBR_FILE_NO_PATH, __FUNCTION__, __LINE__, e)
+
+#define FBR_LOG_DEBUG_1(i0) \
+    FBR_LOG_RECORD_1(FBR_LOG_LEVEL_DEBUG, #i0, i0)
+#define FBR_LOG_DEBUG_2(i0, i1) \
+    FBR_LOG_RECORD_2(FBR_LOG_LEVEL_DEBUG, #i0, i0, #i1, i1)
+#define FBR_LOG_DEBUG_3(i0, i1, i2) \
+    FBR_LOG_RECORD_3(FBR_LOG_LEVEL_DEBUG, #i0, i0, #i1, i1, #i2, i2)
+#define FBR_LOG_DEBUG_4(i0, i1, i2, i3) \
+    FBR_LOG_RECORD_4(FBR_LOG_LEVEL_DEBUG, #i0, i0, #i1, i1, #i2, i2, #i3, i3)
+#define FBR_LOG_DEBUG_5(i0, i1, i2, i3, i4) \
+    FBR_LOG_RECORD_5(FBR_LOG_LEVEL_DEBUG, #i0, i0, #i1, i1, #i2, i2, #i3, i3, #i4, i4)
+#define FBR_LOG_MESSAGE_0(m) \
+    FBR_LOG_RECORD_1(FBR_LOG_LEVEL_MESSAGE, NULL, m)
+#define FBR_LOG_MESSAGE_1(m, i0) \
+    FBR_LOG_RECORD_2(FBR_LOG_LEVEL_MESSAGE, NULL, m, #i0, i0)
+#define FBR_LOG_MESSAGE_2(m, i0, i1) \
+    FBR_LOG_RECORD_3(FBR_LOG_LEVEL_MESSAGE, NULL, m, #i0, i0, #i1, i1)
+#define FBR_LOG_MESSAGE_3(m, i0, i1, i2) \
+    FBR_LOG_RECORD_4(FBR_LOG_LEVEL_MESSAGE, NULL, m, #i0, i0, #i1, i1, #i2, i2)
+#define FBR_LOG_MESSAGE_4(m, i0, i1, i2, i3) \
+    FBR_LOG_RECORD_5(FBR_LOG_LEVEL_MESSAGE, NULL, m, #i0, i0, #i1, i1, #i2, i2, #i3, i3)
+
+#if FBR_LOG_LEVEL <= FBR_LOG_LEVEL_DEBUG
+#define FBR_LOG_DEBUG(...) EXPAND_CONCAT(FBR_LOG_DEBUG_, COUNT_ARGUMENTS(__VA_ARGS__))(__VA_ARGS__)
+#else
+#define FBR_LOG_DEBUG(...) ((void) 0)
+#endif
+
+#if FBR_LOG_LEVEL <= FBR_LOG_LEVEL_MESSAGE
+#define FBR_LOG_MESSAGE(m, ...) EXPAND_CONCAT(FBR_LOG_MESSAGE_, COUNT_ARGUMENTS(__VA_ARGS__))(m, ##__VA_ARGS__)
+#else
+#define FBR_LOG_MESSAGE(m, ...) ((void) 0)
+#endif
+
+// Errors are always compiled in and flushed before returning
+#define FBR_LOG_ERROR(e) ({ \
+    FBR_LOG_RECORD_1(FBR_LOG_LEVEL_ERROR, NULL, e); \
+    fbrFlushLog(); \
+})
 
 #endif //FABRIC_LOG_H
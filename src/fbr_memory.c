@@ -0,0 +1,326 @@
+#include "fbr_memory.h"
+#include "fbr_buffer.h"
+#include "fbr_vulkan.h"
+#include "fbr_log.h"
+
+#include "stb_ds.h"
+
+static VkDeviceSize orderSize(uint32_t order) {
+    return (VkDeviceSize) FBR_MEMORY_MIN_SIZE << order;
+}
+
+static uint32_t orderForSize(VkDeviceSize size) {
+    uint32_t order = 0;
+    while (orderSize(order) < size)
+        order++;
+    return order;
+}
+
+static void initPool(const FbrVulkan *pVulkan, uint32_t memoryTypeIndex, FbrMemoryPool *pPool) {
+    const VkPhysicalDeviceMemoryProperties *pMemoryProperties = &pVulkan->physicalDeviceMemoryProperties;
+    const VkDeviceSize heapSize = pMemoryProperties->memoryHeaps[pMemoryProperties->memoryTypes[memoryTypeIndex].heapIndex].size;
+
+    // Don't let one block eat a small heap, like the 256mb device local host visible one
+    pPool->memoryTypeIndex = memoryTypeIndex;
+    pPool->maxOrder = FBR_MEMORY_ORDER_COUNT - 1;
+    pPool->blockSize = FBR_MEMORY_BLOCK_SIZE;
+    while (pPool->maxOrder > 0 && pPool->blockSize > heapSize / 8) {
+        pPool->maxOrder--;
+        pPool->blockSize >>= 1;
+    }
+}
+
+static VkResult createBlock(const FbrVulkan *pVulkan, FbrMemoryPool *pPool, FbrMemoryBlock **ppBlock) {
+    FbrMemoryBlock *pBlock = calloc(1, sizeof(FbrMemoryBlock));
+
+    const VkMemoryAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .allocationSize = pPool->blockSize,
+            .memoryTypeIndex = pPool->memoryTypeIndex,
+    };
+    VkResult result = vkAllocateMemory(pVulkan->device, &allocInfo, FBR_ALLOCATOR, &pBlock->memory);
+    if (result != VK_SUCCESS) {
+        free(pBlock);
+        return result;
+    }
+
+    const VkMemoryPropertyFlags propertyFlags = pVulkan->physicalDeviceMemoryProperties.memoryTypes[pPool->memoryTypeIndex].propertyFlags;
+    if (propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        FBR_ACK(vkMapMemory(pVulkan->device, pBlock->memory, 0, VK_WHOLE_SIZE, 0, (void **) &pBlock->pMapped));
+    }
+
+    arrput(pBlock->pFreeLists[pPool->maxOrder], 0);
+    arrput(pPool->ppBlocks, pBlock);
+    *ppBlock = pBlock;
+
+    FBR_LOG_MESSAGE("Created memory block.", pPool->memoryTypeIndex, pPool->blockSize, arrlen(pPool->ppBlocks));
+
+    return FBR_SUCCESS;
+}
+
+static void destroyBlock(const FbrVulkan *pVulkan, FbrMemoryBlock *pBlock) {
+    for (int i = 0; i < FBR_MEMORY_ORDER_COUNT; ++i)
+        arrfree(pBlock->pFreeLists[i]);
+
+    // freeing implicitly unmaps
+    vkFreeMemory(pVulkan->device, pBlock->memory, FBR_ALLOCATOR);
+    free(pBlock);
+}
+
+static bool tryAllocateFromBlock(const FbrMemoryPool *pPool, FbrMemoryBlock *pBlock, uint32_t order, VkDeviceSize *pOffset) {
+    uint32_t freeOrder = order;
+    while (freeOrder <= pPool->maxOrder && arrlen(pBlock->pFreeLists[freeOrder]) == 0)
+        freeOrder++;
+
+    if (freeOrder > pPool->maxOrder)
+        return false;
+
+    VkDeviceSize offset = arrpop(pBlock->pFreeLists[freeOrder]);
+
+    // split down, keeping the low half and freeing the high buddy each step
+    while (freeOrder > order) {
+        freeOrder--;
+        arrput(pBlock->pFreeLists[freeOrder], offset + orderSize(freeOrder));
+    }
+
+    *pOffset = offset;
+    return true;
+}
+
+static void freeToBlock(const FbrMemoryPool *pPool, FbrMemoryBlock *pBlock, VkDeviceSize offset, uint32_t order) {
+    // merge back up while the buddy is also free
+    while (order < pPool->maxOrder) {
+        const VkDeviceSize buddyOffset = offset ^ orderSize(order);
+        int buddyIndex = -1;
+        for (int i = 0; i < arrlen(pBlock->pFreeLists[order]); ++i) {
+            if (pBlock->pFreeLists[order][i] == buddyOffset) {
+                buddyIndex = i;
+                break;
+            }
+        }
+        if (buddyIndex < 0)
+            break;
+
+        arrdelswap(pBlock->pFreeLists[order], buddyIndex);
+        offset = offset < buddyOffset ? offset : buddyOffset;
+        order++;
+    }
+    arrput(pBlock->pFreeLists[order], offset);
+}
+
+VkResult fbrCreateMemoryAllocator(const FbrVulkan *pVulkan, FbrMemoryAllocator **ppAllocMemoryAllocator) {
+    *ppAllocMemoryAllocator = calloc(1, sizeof(FbrMemoryAllocator));
+    FbrMemoryAllocator *pMemoryAllocator = *ppAllocMemoryAllocator;
+
+    const VkDeviceSize bufferImageGranularity = pVulkan->physicalDeviceProperties.properties.limits.bufferImageGranularity;
+    pMemoryAllocator->separateOptimal = bufferImageGranularity > 1;
+    FBR_LOG_MESSAGE("Creating memory allocator.", bufferImageGranularity, pVulkan->physicalDeviceProperties.properties.limits.maxMemoryAllocationCount);
+
+    for (uint32_t i = 0; i < pVulkan->physicalDeviceMemoryProperties.memoryTypeCount; ++i) {
+        initPool(pVulkan, i, &pMemoryAllocator->pLinearPools[i]);
+        initPool(pVulkan, i, &pMemoryAllocator->pOptimalPools[i]);
+    }
+
+    return FBR_SUCCESS;
+}
+
+static void destroyPool(const FbrVulkan *pVulkan, FbrMemoryPool *pPool) {
+    for (int i = 0; i < arrlen(pPool->ppBlocks); ++i) {
+        if (pPool->ppBlocks[i]->allocationCount > 0) {
+            FBR_LOG_MESSAGE("Leaking allocations in memory block!", pPool->memoryTypeIndex, pPool->ppBlocks[i]->allocationCount);
+        }
+        destroyBlock(pVulkan, pPool->ppBlocks[i]);
+    }
+    arrfree(pPool->ppBlocks);
+}
+
+void fbrDestroyMemoryAllocator(const FbrVulkan *pVulkan, FbrMemoryAllocator *pMemoryAllocator) {
+    fbrLogMemoryStats(pVulkan);
+
+    for (uint32_t i = 0; i < pVulkan->physicalDeviceMemoryProperties.memoryTypeCount; ++i) {
+        destroyPool(pVulkan, &pMemoryAllocator->pLinearPools[i]);
+        destroyPool(pVulkan, &pMemoryAllocator->pOptimalPools[i]);
+    }
+
+    free(pMemoryAllocator);
+}
+
+VkResult fbrAllocateMemory(const FbrVulkan *pVulkan,
+                           const VkMemoryRequirements *pMemRequirements,
+                           uint32_t memoryTypeIndex,
+                           bool linear,
+                           FbrAllocation *pAllocation) {
+    FbrMemoryAllocator *pMemoryAllocator = pVulkan->pMemoryAllocator;
+    FbrMemoryPool *pPool = linear || !pMemoryAllocator->separateOptimal ?
+                           &pMemoryAllocator->pLinearPools[memoryTypeIndex] :
+                           &pMemoryAllocator->pOptimalPools[memoryTypeIndex];
+
+    const VkDeviceSize size = pMemRequirements->size > pMemRequirements->alignment ? pMemRequirements->size : pMemRequirements->alignment;
+    const uint32_t order = orderForSize(size);
+
+    // too big to be worth sub-allocating
+    if (order > pPool->maxOrder) {
+        const VkMemoryAllocateInfo allocInfo = {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                .allocationSize = pMemRequirements->size,
+                .memoryTypeIndex = memoryTypeIndex,
+        };
+        FBR_ACK(fbrAllocateDedicatedMemory(pVulkan, &allocInfo, pAllocation));
+        const VkMemoryPropertyFlags propertyFlags = pVulkan->physicalDeviceMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+        if (propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            FBR_ACK(vkMapMemory(pVulkan->device, pAllocation->memory, 0, VK_WHOLE_SIZE, 0, &pAllocation->pMapped));
+        }
+        return FBR_SUCCESS;
+    }
+
+    FbrMemoryBlock *pBlock = NULL;
+    VkDeviceSize offset;
+    for (int i = 0; i < arrlen(pPool->ppBlocks); ++i) {
+        if (tryAllocateFromBlock(pPool, pPool->ppBlocks[i], order, &offset)) {
+            pBlock = pPool->ppBlocks[i];
+            break;
+        }
+    }
+    if (pBlock == NULL) {
+        FBR_ACK(createBlock(pVulkan, pPool, &pBlock));
+        tryAllocateFromBlock(pPool, pBlock, order, &offset);
+    }
+
+    pBlock->allocationCount++;
+    pBlock->usedSize += orderSize(order);
+    pBlock->requestedSize += pMemRequirements->size;
+
+    *pAllocation = (FbrAllocation) {
+            .memory = pBlock->memory,
+            .offset = offset,
+            .size = pMemRequirements->size,
+            .pMapped = pBlock->pMapped != NULL ? pBlock->pMapped + offset : NULL,
+            .pPool = pPool,
+            .pBlock = pBlock,
+            .order = order,
+    };
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrAllocateDedicatedMemory(const FbrVulkan *pVulkan, const VkMemoryAllocateInfo *pAllocInfo, FbrAllocation *pAllocation) {
+    *pAllocation = (FbrAllocation) {
+            .size = pAllocInfo->allocationSize,
+    };
+    FBR_ACK(vkAllocateMemory(pVulkan->device, pAllocInfo, FBR_ALLOCATOR, &pAllocation->memory));
+
+    pVulkan->pMemoryAllocator->dedicatedCount++;
+    pVulkan->pMemoryAllocator->dedicatedSize += pAllocInfo->allocationSize;
+
+    return FBR_SUCCESS;
+}
+
+void fbrFreeMemory(const FbrVulkan *pVulkan, FbrAllocation *pAllocation) {
+    if (pAllocation->memory == VK_NULL_HANDLE)
+        return;
+
+    if (pAllocation->pBlock == NULL) {
+        vkFreeMemory(pVulkan->device, pAllocation->memory, FBR_ALLOCATOR);
+        pVulkan->pMemoryAllocator->dedicatedCount--;
+        pVulkan->pMemoryAllocator->dedicatedSize -= pAllocation->size;
+        *pAllocation = (FbrAllocation) {};
+        return;
+    }
+
+    FbrMemoryPool *pPool = pAllocation->pPool;
+    FbrMemoryBlock *pBlock = pAllocation->pBlock;
+    freeToBlock(pPool, pBlock, pAllocation->offset, pAllocation->order);
+    pBlock->allocationCount--;
+    pBlock->usedSize -= orderSize(pAllocation->order);
+    pBlock->requestedSize -= pAllocation->size;
+
+    // Hand empty blocks back to the driver but always keep the first around so alloc/free churn doesn't thrash
+    if (pBlock->allocationCount == 0 && pBlock != pPool->ppBlocks[0]) {
+        for (int i = 0; i < arrlen(pPool->ppBlocks); ++i) {
+            if (pPool->ppBlocks[i] == pBlock) {
+                arrdel(pPool->ppBlocks, i);
+                break;
+            }
+        }
+        destroyBlock(pVulkan, pBlock);
+    }
+
+    *pAllocation = (FbrAllocation) {};
+}
+
+VkResult fbrAllocateBindBufferMemory(const FbrVulkan *pVulkan,
+                                     VkBuffer buffer,
+                                     VkMemoryPropertyFlags properties,
+                                     FbrAllocation *pAllocation) {
+    VkMemoryRequirements memRequirements;
+    uint32_t memTypeIndex;
+    FBR_ACK(fbrBufferMemoryTypeFromProperties(pVulkan,
+                                              buffer,
+                                              properties,
+                                              &memRequirements,
+                                              &memTypeIndex));
+    FBR_ACK(fbrAllocateMemory(pVulkan, &memRequirements, memTypeIndex, true, pAllocation));
+    FBR_ACK(vkBindBufferMemory(pVulkan->device, buffer, pAllocation->memory, pAllocation->offset));
+    return FBR_SUCCESS;
+}
+
+VkResult fbrAllocateBindImageMemory(const FbrVulkan *pVulkan,
+                                    VkImage image,
+                                    VkMemoryPropertyFlags properties,
+                                    FbrAllocation *pAllocation) {
+    VkMemoryRequirements memRequirements;
+    uint32_t memTypeIndex;
+    FBR_ACK(fbrImageMemoryTypeFromProperties(pVulkan,
+                                             image,
+                                             properties,
+                                             &memRequirements,
+                                             &memTypeIndex));
+    // everything here is VK_IMAGE_TILING_OPTIMAL
+    FBR_ACK(fbrAllocateMemory(pVulkan, &memRequirements, memTypeIndex, false, pAllocation));
+    FBR_ACK(vkBindImageMemory(pVulkan->device, image, pAllocation->memory, pAllocation->offset));
+    return FBR_SUCCESS;
+}
+
+static void accumulatePoolStats(const FbrMemoryPool *pPool, FbrMemoryStats *pStats) {
+    for (int i = 0; i < arrlen(pPool->ppBlocks); ++i) {
+        const FbrMemoryBlock *pBlock = pPool->ppBlocks[i];
+        pStats->blockCount++;
+        pStats->allocationCount += pBlock->allocationCount;
+        pStats->blockSize += pPool->blockSize;
+        pStats->usedSize += pBlock->usedSize;
+        pStats->requestedSize += pBlock->requestedSize;
+        for (int order = (int) pPool->maxOrder; order >= 0; --order) {
+            if (arrlen(pBlock->pFreeLists[order]) > 0) {
+                if (orderSize(order) > pStats->largestFreeSize)
+                    pStats->largestFreeSize = orderSize(order);
+                break;
+            }
+        }
+    }
+}
+
+void fbrGetMemoryStats(const FbrVulkan *pVulkan, FbrMemoryStats *pStats) {
+    const FbrMemoryAllocator *pMemoryAllocator = pVulkan->pMemoryAllocator;
+    *pStats = (FbrMemoryStats) {
+            .dedicatedCount = pMemoryAllocator->dedicatedCount,
+            .dedicatedSize = pMemoryAllocator->dedicatedSize,
+    };
+    for (uint32_t i = 0; i < pVulkan->physicalDeviceMemoryProperties.memoryTypeCount; ++i) {
+        accumulatePoolStats(&pMemoryAllocator->pLinearPools[i], pStats);
+        accumulatePoolStats(&pMemoryAllocator->pOptimalPools[i], pStats);
+    }
+}
+
+void fbrLogMemoryStats(const FbrVulkan *pVulkan) {
+    FbrMemoryStats stats;
+    fbrGetMemoryStats(pVulkan, &stats);
+
+    // internal is lost to rounding up to a power of two, external is free space not available as one range
+    const VkDeviceSize freeSize = stats.blockSize - stats.usedSize;
+    const float internalFragmentation = stats.usedSize > 0 ? 1.0f - (float) stats.requestedSize / (float) stats.usedSize : 0.0f;
+    const float externalFragmentation = freeSize > 0 ? 1.0f - (float) stats.largestFreeSize / (float) freeSize : 0.0f;
+    FBR_LOG_MESSAGE("Memory blocks.", stats.blockCount, stats.allocationCount, stats.blockSize);
+    FBR_LOG_MESSAGE("Memory usage.", stats.usedSize, stats.requestedSize, stats.largestFreeSize);
+    FBR_LOG_MESSAGE("Memory dedicated.", stats.dedicatedCount, stats.dedicatedSize);
+    FBR_LOG_MESSAGE("Memory fragmentation.", internalFragmentation, externalFragmentation);
+}
@@ -0,0 +1,92 @@
+#ifndef FABRIC_MEMORY_H
+#define FABRIC_MEMORY_H
+
+#include "fbr_app.h"
+
+// Buddy allocator, blocks are split in powers of two from FBR_MEMORY_BLOCK_SIZE down to FBR_MEMORY_MIN_SIZE.
+// Power of two offsets mean any alignment up to the allocation size comes for free.
+#define FBR_MEMORY_MIN_SIZE 256
+#define FBR_MEMORY_ORDER_COUNT 19
+// 64mb, the largest order
+#define FBR_MEMORY_BLOCK_SIZE ((VkDeviceSize) FBR_MEMORY_MIN_SIZE << (FBR_MEMORY_ORDER_COUNT - 1))
+
+typedef struct FbrMemoryBlock {
+    VkDeviceMemory memory;
+    uint8_t *pMapped;
+    uint32_t allocationCount;
+    VkDeviceSize usedSize;
+    VkDeviceSize requestedSize;
+    // stb_ds arrays of free offsets for each order
+    VkDeviceSize *pFreeLists[FBR_MEMORY_ORDER_COUNT];
+} FbrMemoryBlock;
+
+typedef struct FbrMemoryPool {
+    uint32_t memoryTypeIndex;
+    VkDeviceSize blockSize;
+    uint32_t maxOrder;
+    // stb_ds array
+    FbrMemoryBlock **ppBlocks;
+} FbrMemoryPool;
+
+typedef struct FbrMemoryAllocator {
+    // linear and optimal resources get their own pools so bufferImageGranularity never has to be considered
+    FbrMemoryPool pLinearPools[VK_MAX_MEMORY_TYPES];
+    FbrMemoryPool pOptimalPools[VK_MAX_MEMORY_TYPES];
+    bool separateOptimal;
+    uint32_t dedicatedCount;
+    VkDeviceSize dedicatedSize;
+} FbrMemoryAllocator;
+
+typedef struct FbrAllocation {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    // set if the memory type is host visible, blocks stay mapped for their lifetime
+    void *pMapped;
+    // NULL for dedicated allocations
+    FbrMemoryPool *pPool;
+    FbrMemoryBlock *pBlock;
+    uint32_t order;
+} FbrAllocation;
+
+typedef struct FbrMemoryStats {
+    uint32_t blockCount;
+    uint32_t allocationCount;
+    uint32_t dedicatedCount;
+    VkDeviceSize blockSize;
+    VkDeviceSize usedSize;
+    VkDeviceSize requestedSize;
+    VkDeviceSize dedicatedSize;
+    VkDeviceSize largestFreeSize;
+} FbrMemoryStats;
+
+VkResult fbrCreateMemoryAllocator(const FbrVulkan *pVulkan, FbrMemoryAllocator **ppAllocMemoryAllocator);
+
+void fbrDestroyMemoryAllocator(const FbrVulkan *pVulkan, FbrMemoryAllocator *pMemoryAllocator);
+
+VkResult fbrAllocateMemory(const FbrVulkan *pVulkan,
+                           const VkMemoryRequirements *pMemRequirements,
+                           uint32_t memoryTypeIndex,
+                           bool linear,
+                           FbrAllocation *pAllocation);
+
+// For exported, imported or anything else that must own its VkDeviceMemory.
+VkResult fbrAllocateDedicatedMemory(const FbrVulkan *pVulkan, const VkMemoryAllocateInfo *pAllocInfo, FbrAllocation *pAllocation);
+
+void fbrFreeMemory(const FbrVulkan *pVulkan, FbrAllocation *pAllocation);
+
+VkResult fbrAllocateBindBufferMemory(const FbrVulkan *pVulkan,
+                                     VkBuffer buffer,
+                                     VkMemoryPropertyFlags properties,
+                                     FbrAllocation *pAllocation);
+
+VkResult fbrAllocateBindImageMemory(const FbrVulkan *pVulkan,
+                                    VkImage image,
+                                    VkMemoryPropertyFlags properties,
+                                    FbrAllocation *pAllocation);
+
+void fbrGetMemoryStats(const FbrVulkan *pVulkan, FbrMemoryStats *pStats);
+
+void fbrLogMemoryStats(const FbrVulkan *pVulkan);
+
+#endif //FABRIC_MEMORY_H
@@ -91,7 +91,7 @@ static void createVertexBuffer(const FbrVulkan *pVulkan, const Vertex *pVertices
                                       pVertices,
                                       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                                       &pMeshState->vertexBuffer,
-                                      &pMeshState->vertexBufferMemory,
+                                      &pMeshState->vertexBufferAllocation,
                                       bufferSize);
 }
 
@@ -102,7 +102,7 @@ static void createIndexBuffer(const FbrVulkan *pVulkan, const uint16_t *pIndices
                                       pIndices,
                                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
                                       &pMeshState->indexBuffer,
-                                      &pMeshState->indexBufferMemory,
+                                      &pMeshState->indexBufferAllocation,
                                       bufferSize);
 }
 
@@ -134,8 +134,8 @@ void fbrCreateSphereMesh(const FbrVulkan *pVulkan, FbrMesh **ppAllocMeshState) {
 void fbrCleanupMesh(const FbrVulkan *pVulkan, FbrMesh *pMeshState)
 {
     vkDestroyBuffer(pVulkan->device, pMeshState->indexBuffer, NULL);
-    vkFreeMemory(pVulkan->device, pMeshState->indexBufferMemory, NULL);
+    fbrFreeMemory(pVulkan, &pMeshState->indexBufferAllocation);
     vkDestroyBuffer(pVulkan->device, pMeshState->vertexBuffer, NULL);
-    vkFreeMemory(pVulkan->device, pMeshState->vertexBufferMemory, NULL);
+    fbrFreeMemory(pVulkan, &pMeshState->vertexBufferAllocation);
     free(pMeshState);
 }
\ No newline at end of file
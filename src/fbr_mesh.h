@@ -3,6 +3,7 @@
 
 #include "fbr_transform.h"
 #include "fbr_app.h"
+#include "fbr_memory.h"
 
 typedef struct Vertex {
     vec3 pos;
@@ -15,10 +16,10 @@ typedef struct FbrMesh {
     uint32_t vertexCount;
 
     VkBuffer indexBuffer;
-    VkDeviceMemory indexBufferMemory;
+    FbrAllocation indexBufferAllocation;
 
     VkBuffer vertexBuffer;
-    VkDeviceMemory vertexBufferMemory;
+    FbrAllocation vertexBufferAllocation;
 } FbrMesh;
 
 void fbrCreateMesh(const FbrVulkan *pVulkan, FbrMesh **ppAllocMeshState);
@@ -4,11 +4,26 @@
 #include "fbr_process.h"
 #include "fbr_ipc.h"
 #include "fbr_swap.h"
+#include "fbr_trace.h"
+#include "fbr_descriptors.h"
+
+#include <float.h>
 
 void fbrNodeUpdateCameraIPCFromCamera(const FbrVulkan *pVulkan, FbrNode *pNode, FbrCamera *pFromCamera)
 {
+    // the node's frame reaches the screen about its average pose to present latency from now
+    const int64_t timestamp = fbrGetTraceTimestamp();
+    float minMs, avgMs, maxMs, frameAge;
+    fbrGetNodeLatencyStats(pNode, &minMs, &avgMs, &maxMs, &frameAge);
+    mat4 view;
+    mat4 invView;
+    fbrGetPredictedCameraView(pFromCamera,
+                              timestamp + (int64_t) ((double) avgMs * (double) pNode->latency.traceFrequency / 1000.0),
+                              view,
+                              invView);
+
     vec3 viewPosition;
-    glm_mat4_mulv3(pFromCamera->bufferData.view, pNode->pTransform->pos, 1, viewPosition);
+    glm_mat4_mulv3(view, pNode->pTransform->pos, 1, viewPosition);
     float viewDistanceToCenter = -viewPosition[2];
     float offset = pNode->size * 0.5f;
     float nearZ = viewDistanceToCenter - offset;
@@ -19,12 +34,88 @@ void fbrNodeUpdateCameraIPCFromCamera(const FbrVulkan *pVulkan, FbrNode *pNode,
     FbrNodeCamera *pRenderingCameraBuffer = pNode->pRenderingCameraBuffer;
     glm_perspective(FBR_CAMERA_FOV, pVulkan->screenFOV, nearZ, farZ, pRenderingCameraBuffer->proj);
     glm_mat4_inv(pRenderingCameraBuffer->proj, pRenderingCameraBuffer->invProj);
-    glm_mat4_copy(pFromCamera->bufferData.view, pRenderingCameraBuffer->view);
-    glm_mat4_copy(pFromCamera->bufferData.invView, pRenderingCameraBuffer->invView);
+    glm_mat4_copy(view, pRenderingCameraBuffer->view);
+    glm_mat4_copy(invView, pRenderingCameraBuffer->invView);
     glm_mat4_copy(pFromCamera->pTransform->uboData.model, pRenderingCameraBuffer->model);
     pRenderingCameraBuffer->width = pFromCamera->bufferData.width;
     pRenderingCameraBuffer->height = pFromCamera->bufferData.height;
-    memcpy(pNode->pCameraIPCBuffer->pBuffer, pRenderingCameraBuffer, sizeof(FbrNodeCamera));
+    pRenderingCameraBuffer->stamp.frameID = ++pNode->latency.cameraFrameID;
+    pRenderingCameraBuffer->stamp.poseTimestamp = timestamp;
+    pRenderingCameraBuffer->stamp.presentCount = pNode->latency.presentCount;
+    FbrNodeCameraIPC *pCameraIPC = pNode->pCameraIPCBuffer->pBuffer;
+    memcpy(&pCameraIPC->camera, pRenderingCameraBuffer, sizeof(FbrNodeCamera));
+}
+
+static float traceTicksToMs(const FbrNodeLatency *pLatency, int64_t ticks) {
+    return (float) ((double) ticks * 1000.0 / (double) pLatency->traceFrequency);
+}
+
+void fbrNodeAcquireFrameStamp(FbrNode *pNode, uint8_t framebufferIndex)
+{
+    // written by the node before it signaled the framebuffer, which has been observed by now
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    const FbrNodeCameraIPC *pCameraIPC = pNode->pCameraIPCBuffer->pBuffer;
+    pNode->latency.compositingStamp = pCameraIPC->pRenderedStamps[framebufferIndex];
+    if (pNode->latency.compositingStamp.frameID == 0)
+        return;
+
+    fbrTraceInstant(FBR_TRACE_CATEGORY_IPC, "node frame id", pNode->latency.compositingStamp.frameID);
+}
+
+void fbrNodeRecordPresent(FbrNode *pNode, int64_t presentTimestamp)
+{
+    FbrNodeLatency *pLatency = &pNode->latency;
+    // counted whether or not there is a node frame yet, it is what frame age is measured in
+    pLatency->presentCount++;
+    if (pLatency->compositingStamp.frameID == 0)
+        return;
+
+    const float poseToPresentMs = traceTicksToMs(pLatency, presentTimestamp - pLatency->compositingStamp.poseTimestamp);
+    // grows when the node falls behind and the compositor keeps reprojecting the same frame
+    const uint32_t frameAge = (uint32_t) (pLatency->presentCount - pLatency->compositingStamp.presentCount);
+    pLatency->pPoseToPresentMs[pLatency->historyIndex] = poseToPresentMs;
+    pLatency->pFrameAges[pLatency->historyIndex] = frameAge;
+    pLatency->historyIndex = (pLatency->historyIndex + 1) % FBR_NODE_LATENCY_HISTORY_COUNT;
+    if (pLatency->historyCount < FBR_NODE_LATENCY_HISTORY_COUNT)
+        pLatency->historyCount++;
+
+    fbrTraceInstant(FBR_TRACE_CATEGORY_CPU, "pose to present us", (uint64_t) (poseToPresentMs * 1000.0f));
+    fbrTraceInstant(FBR_TRACE_CATEGORY_CPU, "node frame age", frameAge);
+
+    if (pLatency->presentCount % FBR_NODE_LATENCY_LOG_INTERVAL == 0)
+        fbrLogNodeLatency(pNode);
+}
+
+void fbrGetNodeLatencyStats(const FbrNode *pNode, float *pMinMs, float *pAvgMs, float *pMaxMs, float *pAvgFrameAge)
+{
+    const FbrNodeLatency *pLatency = &pNode->latency;
+    float min = FLT_MAX;
+    float max = 0;
+    float sum = 0;
+    uint32_t ageSum = 0;
+    for (uint32_t i = 0; i < pLatency->historyCount; ++i) {
+        const float ms = pLatency->pPoseToPresentMs[i];
+        if (ms < min)
+            min = ms;
+        if (ms > max)
+            max = ms;
+        sum += ms;
+        ageSum += pLatency->pFrameAges[i];
+    }
+    *pMinMs = pLatency->historyCount > 0 ? min : 0;
+    *pAvgMs = pLatency->historyCount > 0 ? sum / (float) pLatency->historyCount : 0;
+    *pMaxMs = max;
+    *pAvgFrameAge = pLatency->historyCount > 0 ? (float) ageSum / (float) pLatency->historyCount : 0;
+}
+
+void fbrLogNodeLatency(const FbrNode *pNode)
+{
+    if (pNode->latency.historyCount == 0)
+        return;
+    float min, avg, max, frameAge;
+    fbrGetNodeLatencyStats(pNode, &min, &avg, &max, &frameAge);
+    FBR_LOG_MESSAGE("Node pose to present ms.", pNode->pName, min, avg, max);
+    FBR_LOG_MESSAGE("Node frame age.", pNode->pName, frameAge);
 }
 
 void fbrNodeUpdateCompositingCameraFromRenderingCamera(FbrNode *pNode)
@@ -40,19 +131,44 @@ void fbrNodeUpdateCompositingCameraFromRenderingCamera(FbrNode *pNode)
     fbrUpdateCameraUBO(pNode->pCompositingCamera);
 }
 
+void fbrNodeUpdateMeshDensity(FbrNode *pNode, const FbrCamera *pCamera)
+{
+    const FbrCameraBuffer *pNodeBuffer = &pNode->pCompositingCamera->bufferData;
+    const FbrCameraBuffer *pCameraBuffer = &pCamera->bufferData;
+
+    const float meters = glm_vec3_distance((float *) pNodeBuffer->invView[3], (float *) pCameraBuffer->invView[3]);
+    // rotation from the node's pose to the current one, its angle comes from the trace
+    mat4 delta;
+    glm_mat4_mul((vec4 *) pCameraBuffer->view, (vec4 *) pNodeBuffer->invView, delta);
+    const float cosAngle = glm_clamp((delta[0][0] + delta[1][1] + delta[2][2] - 1.0f) * 0.5f, -1.0f, 1.0f);
+    const float degrees = glm_deg(acosf(cosAngle));
+
+    if (meters <= FBR_NODE_MESH_LOW_MAX_METERS && degrees <= FBR_NODE_MESH_LOW_MAX_DEGREES)
+        pNode->meshDensity = FBR_NODE_MESH_DENSITY_LOW;
+    else if (meters <= FBR_NODE_MESH_MEDIUM_MAX_METERS && degrees <= FBR_NODE_MESH_MEDIUM_MAX_DEGREES)
+        pNode->meshDensity = FBR_NODE_MESH_DENSITY_MEDIUM;
+    else
+        pNode->meshDensity = FBR_NODE_MESH_DENSITY_HIGH;
+}
+
 VkResult fbrCreateNode(const FbrApp *pApp, const char *pName, FbrNode **ppAllocNode) {
     *ppAllocNode = calloc(1, sizeof(FbrNode));
     FbrNode *pNode = *ppAllocNode;
     pNode->pName = strdup(pName);
     pNode->size = 1.0f;
+    pNode->meshDensity = FBR_NODE_MESH_DENSITY_MEDIUM;
+    // the first frame the child signals is in framebuffer 0
+    pNode->acquiredFramebufferIndex = FBR_NODE_FRAMEBUFFER_COUNT - 1;
+    pNode->acquiredQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
     FbrVulkan *pVulkan = pApp->pVulkan;
 
     fbrCreateTransform(pVulkan, &pNode->pTransform);
+    fbrCreateMesh(pVulkan, &pNode->pMesh);
 
     fbrCreateTimelineSemaphore(pVulkan, true, false, &pNode->pChildSemaphore);
 
-    fbrCreateProcess(&pNode->pProcess);
+    fbrCreateProcess(pApp->settings.headless, &pNode->pProcess);
 
     if (fbrCreateProducerIPCRingBuffer(&pNode->pProducerIPC) != 0){
         FBR_LOG_ERROR("fbrCreateProducerIPCRingBuffer fail");
@@ -67,14 +183,27 @@ VkResult fbrCreateNode(const FbrApp *pApp, const char *pName, FbrNode **ppAllocN
                              pApp->pSwap->extent,
                              &pNode->pFramebuffers[i]);
     }
+    // cached composite sets are keyed on image view handles, which the new framebuffers can reuse
+    fbrInvalidateSetsComputeComposite(pApp->pDescriptors);
+    for (int i = 0; i < FBR_NODE_FRAMEBUFFER_COUNT; ++i) {
+        const FbrFramebuffer *pFramebuffer = pNode->pFramebuffers[i];
+        FbrTextureIndices *pIndices = &pNode->pTextureIndices[i];
+        FBR_ACK(fbrAcquireTextureIndex(pVulkan, pApp->pDescriptors, pFramebuffer->pColorTexture->imageView, &pIndices->colorIndex));
+        FBR_ACK(fbrAcquireTextureIndex(pVulkan, pApp->pDescriptors, pFramebuffer->pNormalTexture->imageView, &pIndices->normalIndex));
+        FBR_ACK(fbrAcquireTextureIndex(pVulkan, pApp->pDescriptors, pFramebuffer->pGBufferTexture->imageView, &pIndices->gbufferIndex));
+        FBR_ACK(fbrAcquireTextureIndex(pVulkan, pApp->pDescriptors, pFramebuffer->pDepthTexture->imageView, &pIndices->depthIndex));
+    }
 
     pNode->pRenderingCameraBuffer = calloc(1, sizeof(FbrNodeCamera));
-    fbrCreateIPCBuffer(&pNode->pCameraIPCBuffer, sizeof(FbrNodeCamera));
+    fbrCreateIPCBuffer(&pNode->pCameraIPCBuffer, sizeof(FbrNodeCameraIPC));
+    pNode->latency.traceFrequency = fbrGetTraceFrequency();
 
     fbrCreateCamera(pVulkan, &pNode->pCompositingCamera);
+
+    return FBR_SUCCESS;
 }
 
-void fbrDestroyNode(const FbrVulkan *pVulkan, FbrNode *pNode) {
+void fbrDestroyNode(const FbrVulkan *pVulkan, FbrDescriptors *pDescriptors, FbrNode *pNode) {
     free(pNode->pName);
 
     fbrDestroyProcess(pNode->pProcess);
@@ -83,8 +212,17 @@ void fbrDestroyNode(const FbrVulkan *pVulkan, FbrNode *pNode) {
     fbrDestroyIPCRingBuffer(pNode->pReceiverIPC);
 
     for (int i = 0; i < FBR_NODE_FRAMEBUFFER_COUNT; ++i) {
+        const FbrTextureIndices *pIndices = &pNode->pTextureIndices[i];
+        fbrReleaseTextureIndex(pDescriptors, pIndices->colorIndex);
+        fbrReleaseTextureIndex(pDescriptors, pIndices->normalIndex);
+        fbrReleaseTextureIndex(pDescriptors, pIndices->gbufferIndex);
+        fbrReleaseTextureIndex(pDescriptors, pIndices->depthIndex);
         fbrDestroyFrameBuffer(pVulkan, pNode->pFramebuffers[i]);
     }
 
+    fbrDestroyCamera(pVulkan, pNode->pCompositingCamera);
+    fbrCleanupMesh(pVulkan, pNode->pMesh);
+    fbrDestroyTransform(pVulkan, pNode->pTransform);
+
     free(pNode);
 }
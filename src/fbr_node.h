@@ -9,6 +9,25 @@
 #include "fbr_camera.h"
 
 #define FBR_NODE_FRAMEBUFFER_COUNT 2
+// rolling window latency stats are taken over
+#define FBR_NODE_LATENCY_HISTORY_COUNT 120
+#define FBR_NODE_LATENCY_LOG_INTERVAL 600
+// how far the compositor camera can move from the node frame's pose before the mesh grid gets denser,
+// a still camera reprojects to the same pixels so the coarsest grid does
+#define FBR_NODE_MESH_LOW_MAX_METERS 0.001f
+#define FBR_NODE_MESH_LOW_MAX_DEGREES 0.1f
+#define FBR_NODE_MESH_MEDIUM_MAX_METERS 0.02f
+#define FBR_NODE_MESH_MEDIUM_MAX_DEGREES 1.0f
+
+// Identifies the pose a node frame was rendered with
+typedef struct FbrNodeFrameStamp {
+    // starts at 1, 0 means no frame yet
+    uint64_t frameID;
+    // trace clock, when the compositor wrote the pose
+    int64_t poseTimestamp;
+    // compositor presents done when the pose was written
+    uint64_t presentCount;
+} FbrNodeFrameStamp;
 
 typedef struct FbrNodeCamera {
     mat4 view;
@@ -18,10 +37,36 @@ typedef struct FbrNodeCamera {
     mat4 model;
     uint32_t width;
     uint32_t height;
+    FbrNodeFrameStamp stamp;
 } FbrNodeCamera;
 
+// Layout of the camera IPC buffer. The compositor writes camera, the node writes the stamp of the
+// camera each framebuffer was rendered with before signaling it.
+typedef struct FbrNodeCameraIPC {
+    FbrNodeCamera camera;
+    FbrNodeFrameStamp pRenderedStamps[FBR_NODE_FRAMEBUFFER_COUNT];
+} FbrNodeCameraIPC;
+
+typedef struct FbrNodeLatency {
+    // id of the last pose written to the node
+    uint64_t cameraFrameID;
+    // stamp of the node frame the compositor is reprojecting
+    FbrNodeFrameStamp compositingStamp;
+    uint64_t presentCount;
+    // rings of the last FBR_NODE_LATENCY_HISTORY_COUNT presents
+    float pPoseToPresentMs[FBR_NODE_LATENCY_HISTORY_COUNT];
+    // compositor presents since the reprojected frame's pose was written. 2 is the freshest a frame can be,
+    // its pose goes out at one frame's poll and the frame comes back at the next one's
+    uint32_t pFrameAges[FBR_NODE_LATENCY_HISTORY_COUNT];
+    uint32_t historyCount;
+    uint32_t historyIndex;
+    int64_t traceFrequency;
+} FbrNodeLatency;
+
 typedef struct FbrNode {
     FbrTransform *pTransform;
+    // single quad patch the tessellation composite draws the node's frame onto
+    FbrMesh *pMesh;
 
     char *pName;
 
@@ -41,15 +86,43 @@ typedef struct FbrNode {
     FbrTimelineSemaphore *pChildSemaphore;
 
     FbrFramebuffer *pFramebuffers[FBR_NODE_FRAMEBUFFER_COUNT];
+    // bindless slots of each framebuffer's textures
+    FbrTextureIndices pTextureIndices[FBR_NODE_FRAMEBUFFER_COUNT];
+
+    // Kept on the node rather than in a main loop so switching loops carries on from the same node frame.
+    // Child timeline value last acquired, and which framebuffer it was in.
+    uint64_t acquiredTimelineValue;
+    uint8_t acquiredFramebufferIndex;
+    // queue family the acquired framebuffer is owned by, VK_QUEUE_FAMILY_IGNORED before the first acquire
+    uint32_t acquiredQueueFamilyIndex;
+
+    // picked each frame by fbrNodeUpdateMeshDensity, trades grid resolution against mesh shader cost
+    FbrNodeMeshDensity meshDensity;
+
+    FbrNodeLatency latency;
 
 } FbrNode;
 
+// Also stamps the pose with the next frame id and the current time.
 void fbrNodeUpdateCameraIPCFromCamera(const FbrVulkan *pVulkan, FbrNode *pNode, FbrCamera *pFromCamera);
 
+// Call when the compositor acquires a node framebuffer, picks up the stamp the node rendered it with.
+void fbrNodeAcquireFrameStamp(FbrNode *pNode, uint8_t framebufferIndex);
+
+// Call after the compositor presents, records how old the reprojected node frame is.
+void fbrNodeRecordPresent(FbrNode *pNode, int64_t presentTimestamp);
+
+void fbrGetNodeLatencyStats(const FbrNode *pNode, float *pMinMs, float *pAvgMs, float *pMaxMs, float *pAvgFrameAge);
+
+void fbrLogNodeLatency(const FbrNode *pNode);
+
 void fbrNodeUpdateCompositingCameraFromRenderingCamera(FbrNode *pNode);
 
+// Denser the further pCamera has moved from the pose the reprojected node frame was rendered with.
+void fbrNodeUpdateMeshDensity(FbrNode *pNode, const FbrCamera *pCamera);
+
 FBR_RESULT fbrCreateNode(const FbrApp *pApp, const char *pName, FbrNode **ppAllocNode);
 
-void fbrDestroyNode(const FbrVulkan *pVulkan, FbrNode *pNode);
+void fbrDestroyNode(const FbrVulkan *pVulkan, FbrDescriptors *pDescriptors, FbrNode *pNode);
 
 #endif //FABRIC_NODE_H
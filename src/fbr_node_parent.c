@@ -6,6 +6,7 @@
 #include "fbr_ipc.h"
 #include "fbr_log.h"
 #include "fbr_swap.h"
+#include "fbr_descriptors.h"
 
 void fbrCreateNodeParent(const FbrVulkan *pVulkan, FbrNodeParent **ppAllocNodeParent) {
     *ppAllocNodeParent = calloc(1, sizeof(FbrNodeParent));
@@ -31,7 +32,7 @@ void fbrIPCTargetImportNodeParent(FbrApp *pApp, FbrIPCParamImportNodeParent *pPa
     FBR_LOG_MESSAGE("Importing Node Parent");
 
     fbrImportIPCBuffer(&pNodeParent->pCameraIPCBuffer,
-                       sizeof(FbrCameraBuffer));
+                       sizeof(FbrNodeCameraIPC));
 
     FBR_LOG_DEBUG(pParam->colorFramebuffer0ExternalHandle, pParam->framebufferWidth, pParam->framebufferHeight);
     FBR_LOG_DEBUG(pParam->normalFramebuffer0ExternalHandle, pParam->framebufferWidth, pParam->framebufferHeight);
@@ -57,6 +58,8 @@ void fbrIPCTargetImportNodeParent(FbrApp *pApp, FbrIPCParamImportNodeParent *pPa
                          swapFormat,
                          (VkExtent2D) {pParam->framebufferWidth, pParam->framebufferHeight},
                          &pApp->pFramebuffers[1]);
+    // the new image views can reuse the handles of destroyed ones
+    fbrInvalidateSetsComputeComposite(pApp->pDescriptors);
 
     FBR_LOG_DEBUG(pParam->parentSemaphoreExternalHandle);
     fbrImportTimelineSemaphore(pVulkan,
@@ -0,0 +1,185 @@
+#include "fbr_pipeline_cache.h"
+#include "fbr_vulkan.h"
+#include "fbr_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static void getCachePath(const FbrVulkan *pVulkan, char *pPath, size_t pathSize) {
+    const VkPhysicalDeviceProperties *pProperties = &pVulkan->physicalDeviceProperties.properties;
+    snprintf(pPath, pathSize, FBR_PIPELINE_CACHE_PATH_FORMAT, pProperties->vendorID, pProperties->deviceID);
+}
+
+static bool validateHeader(const FbrVulkan *pVulkan, const FbrPipelineCacheFileHeader *pHeader) {
+    const VkPhysicalDeviceProperties *pProperties = &pVulkan->physicalDeviceProperties.properties;
+    return pHeader->magic == FBR_PIPELINE_CACHE_MAGIC &&
+           pHeader->vendorID == pProperties->vendorID &&
+           pHeader->deviceID == pProperties->deviceID &&
+           pHeader->driverVersion == pProperties->driverVersion &&
+           memcmp(pHeader->pipelineCacheUUID, pProperties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// Also check the driver's own header, a mismatch there means the data is from somewhere else entirely
+static bool validateData(const FbrVulkan *pVulkan, const void *pData, size_t dataSize) {
+    const VkPhysicalDeviceProperties *pProperties = &pVulkan->physicalDeviceProperties.properties;
+    if (dataSize < sizeof(VkPipelineCacheHeaderVersionOne))
+        return false;
+    const VkPipelineCacheHeaderVersionOne *pDriverHeader = pData;
+    return pDriverHeader->headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           pDriverHeader->vendorID == pProperties->vendorID &&
+           pDriverHeader->deviceID == pProperties->deviceID &&
+           memcmp(pDriverHeader->pipelineCacheUUID, pProperties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// Returns NULL if the file is missing, truncated or for a different device or driver
+static void *allocReadCacheFile(const FbrVulkan *pVulkan, const char *pPath, size_t *pDataSize) {
+    FILE *file = fopen(pPath, "rb");
+    if (file == NULL)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    const long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    // the size comes from the file, don't trust it past what the file holds
+    FbrPipelineCacheFileHeader header;
+    if (fileSize < (long) sizeof(header) ||
+        fread(&header, sizeof(header), 1, file) != 1 ||
+        !validateHeader(pVulkan, &header) ||
+        header.dataSize > (size_t) fileSize - sizeof(header)) {
+        FBR_LOG_MESSAGE("Pipeline cache stale, ignoring.", pPath);
+        fclose(file);
+        return NULL;
+    }
+
+    void *pData = malloc(header.dataSize);
+    if (pData == NULL) {
+        FBR_LOG_MESSAGE("Pipeline cache too large, ignoring.", pPath, header.dataSize);
+        fclose(file);
+        return NULL;
+    }
+    if (fread(pData, header.dataSize, 1, file) != 1 || !validateData(pVulkan, pData, header.dataSize)) {
+        FBR_LOG_MESSAGE("Pipeline cache corrupt, ignoring.", pPath);
+        free(pData);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    *pDataSize = header.dataSize;
+    return pData;
+}
+
+static bool replaceFile(const char *pTempPath, const char *pPath) {
+#ifdef WIN32
+    return MoveFileExA(pTempPath, pPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    return rename(pTempPath, pPath) == 0;
+#endif
+}
+
+static unsigned long getProcessID() {
+#ifdef WIN32
+    return GetCurrentProcessId();
+#else
+    return (unsigned long) getpid();
+#endif
+}
+
+VkResult fbrCreatePipelineCache(const FbrVulkan *pVulkan, VkPipelineCache *pPipelineCache) {
+    char pPath[64];
+    getCachePath(pVulkan, pPath, sizeof(pPath));
+
+    size_t dataSize = 0;
+    void *pData = allocReadCacheFile(pVulkan, pPath, &dataSize);
+    FBR_LOG_MESSAGE("Loading pipeline cache.", pPath, dataSize);
+
+    const VkPipelineCacheCreateInfo cacheInfo = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .initialDataSize = dataSize,
+            .pInitialData = pData,
+    };
+    const VkResult result = vkCreatePipelineCache(pVulkan->device, &cacheInfo, FBR_ALLOCATOR, pPipelineCache);
+    free(pData);
+    FBR_ACK(result);
+
+    return FBR_SUCCESS;
+}
+
+void fbrSavePipelineCache(const FbrVulkan *pVulkan, VkPipelineCache pipelineCache) {
+    char pPath[64];
+    getCachePath(pVulkan, pPath, sizeof(pPath));
+
+    // another process may have written pipelines this one never built
+    size_t diskDataSize = 0;
+    void *pDiskData = allocReadCacheFile(pVulkan, pPath, &diskDataSize);
+    if (pDiskData != NULL) {
+        const VkPipelineCacheCreateInfo diskCacheInfo = {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+                .initialDataSize = diskDataSize,
+                .pInitialData = pDiskData,
+        };
+        VkPipelineCache diskCache;
+        if (vkCreatePipelineCache(pVulkan->device, &diskCacheInfo, FBR_ALLOCATOR, &diskCache) == VK_SUCCESS) {
+            FBR_VK_CHECK(vkMergePipelineCaches(pVulkan->device, pipelineCache, 1, &diskCache));
+            vkDestroyPipelineCache(pVulkan->device, diskCache, FBR_ALLOCATOR);
+        }
+        free(pDiskData);
+    }
+
+    size_t dataSize = 0;
+    FBR_VK_CHECK(vkGetPipelineCacheData(pVulkan->device, pipelineCache, &dataSize, NULL));
+    if (dataSize == 0)
+        return;
+    void *pData = malloc(dataSize);
+    if (vkGetPipelineCacheData(pVulkan->device, pipelineCache, &dataSize, pData) != VK_SUCCESS) {
+        FBR_LOG_ERROR("Failed to get pipeline cache data!");
+        free(pData);
+        return;
+    }
+
+    const VkPhysicalDeviceProperties *pProperties = &pVulkan->physicalDeviceProperties.properties;
+    FbrPipelineCacheFileHeader header = {
+            .magic = FBR_PIPELINE_CACHE_MAGIC,
+            .dataSize = dataSize,
+            .vendorID = pProperties->vendorID,
+            .deviceID = pProperties->deviceID,
+            .driverVersion = pProperties->driverVersion,
+    };
+    memcpy(header.pipelineCacheUUID, pProperties->pipelineCacheUUID, VK_UUID_SIZE);
+
+    // written beside the real file then swapped in, so a crash or the other process never sees half a cache
+    char pTempPath[96];
+    snprintf(pTempPath, sizeof(pTempPath), "%s.%lu.tmp", pPath, getProcessID());
+    FILE *file = fopen(pTempPath, "wb");
+    if (file == NULL) {
+        FBR_LOG_MESSAGE("Can't open pipeline cache for writing!", pTempPath);
+        free(pData);
+        return;
+    }
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                         fwrite(pData, dataSize, 1, file) == 1;
+    const bool closed = fclose(file) == 0;
+    free(pData);
+
+    if (!written || !closed || !replaceFile(pTempPath, pPath)) {
+        FBR_LOG_MESSAGE("Failed to write pipeline cache!", pPath);
+        remove(pTempPath);
+        return;
+    }
+
+    FBR_LOG_MESSAGE("Saved pipeline cache.", pPath, dataSize);
+}
+
+void fbrDestroyPipelineCache(const FbrVulkan *pVulkan, VkPipelineCache pipelineCache) {
+    fbrSavePipelineCache(pVulkan, pipelineCache);
+    vkDestroyPipelineCache(pVulkan->device, pipelineCache, FBR_ALLOCATOR);
+}
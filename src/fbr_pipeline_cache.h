@@ -0,0 +1,28 @@
+#ifndef FABRIC_PIPELINE_CACHE_H
+#define FABRIC_PIPELINE_CACHE_H
+
+#include "fbr_app.h"
+
+// One file per physical device, shared by the compositor and every node process.
+#define FBR_PIPELINE_CACHE_PATH_FORMAT "./pipeline_cache_%04x_%04x.bin"
+#define FBR_PIPELINE_CACHE_MAGIC 0x43505246
+
+// Prepended to the driver's data, Vulkan's own header has no driver version.
+typedef struct FbrPipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t dataSize;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint32_t driverVersion;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+} FbrPipelineCacheFileHeader;
+
+// Seeded from the cache file if it matches this device and driver, otherwise starts empty.
+VkResult fbrCreatePipelineCache(const FbrVulkan *pVulkan, VkPipelineCache *pPipelineCache);
+
+// Merges anything another process saved in the meantime then replaces the file atomically.
+void fbrSavePipelineCache(const FbrVulkan *pVulkan, VkPipelineCache pipelineCache);
+
+void fbrDestroyPipelineCache(const FbrVulkan *pVulkan, VkPipelineCache pipelineCache);
+
+#endif //FABRIC_PIPELINE_CACHE_H
@@ -4,6 +4,38 @@
 #include "fbr_log.h"
 #include "fbr_mesh.h"
 
+#include "stb_ds.h"
+
+#include <stddef.h>
+
+static const VkSpecializationMapEntry compositeSpecializationEntries[] = {
+        {0, offsetof(FbrCompositeSpecialization, frameWidth), sizeof(uint32_t)},
+        {1, offsetof(FbrCompositeSpecialization, frameHeight), sizeof(uint32_t)},
+        {2, offsetof(FbrCompositeSpecialization, localSizeX), sizeof(uint32_t)},
+        {3, offsetof(FbrCompositeSpecialization, localSizeY), sizeof(uint32_t)},
+};
+
+// the mesh workgroup is VERTEX_DIMENSION_COUNT square so ids 2 and 3 read the same value as 0
+static const VkSpecializationMapEntry nodeMeshSpecializationEntries[] = {
+        {0, offsetof(FbrNodeMeshSpecialization, vertexDimensionCount), sizeof(uint32_t)},
+        {1, offsetof(FbrNodeMeshSpecialization, scale), sizeof(uint32_t)},
+        {2, offsetof(FbrNodeMeshSpecialization, vertexDimensionCount), sizeof(uint32_t)},
+        {3, offsetof(FbrNodeMeshSpecialization, vertexDimensionCount), sizeof(uint32_t)},
+};
+
+// vertexDimensionCount is capped at 10 by MAX_VERTEX_COUNT in node_mesh_constants.glsl
+static const FbrNodeMeshSpecialization nodeMeshDensities[FBR_NODE_MESH_DENSITY_COUNT] = {
+        [FBR_NODE_MESH_DENSITY_LOW] = {.vertexDimensionCount = 4, .scale = 8},
+        [FBR_NODE_MESH_DENSITY_MEDIUM] = {.vertexDimensionCount = 8, .scale = 4},
+        [FBR_NODE_MESH_DENSITY_HIGH] = {.vertexDimensionCount = 10, .scale = 2},
+};
+
+static const VkPushConstantRange textureIndicesRange = {
+        .stageFlags = FBR_TEXTURE_INDICES_STAGES,
+        .offset = 0,
+        .size = sizeof(FbrTextureIndices),
+};
+
 static FBR_RESULT createPipeLayoutStandard(const FbrVulkan *pVulkan,
                                          const FbrDescriptors *pDescriptors,
                                          FbrPipeLayoutStandard *pipelineLayout)
@@ -11,7 +43,7 @@ static FBR_RESULT createPipeLayoutStandard(const FbrVulkan *pVulkan,
     const VkDescriptorSetLayout pSetLayouts[] = {
             pDescriptors->setLayoutGlobal.layout,
             pDescriptors->setLayoutPass.layout,
-            pDescriptors->setLayoutMaterial.layout,
+            pDescriptors->setLayoutTextures.layout,
             pDescriptors->setLayoutObject.layout
     };
     const VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
@@ -19,8 +51,8 @@ static FBR_RESULT createPipeLayoutStandard(const FbrVulkan *pVulkan,
             .pNext = NULL,
             .setLayoutCount = COUNT(pSetLayouts),
             .pSetLayouts = pSetLayouts,
-            .pPushConstantRanges = NULL,
-            .pushConstantRangeCount  = 0
+            .pPushConstantRanges = &textureIndicesRange,
+            .pushConstantRangeCount  = 1
     };
     FBR_ACK(vkCreatePipelineLayout(pVulkan->device,
                                    &pipelineLayoutInfo,
@@ -37,7 +69,7 @@ static FBR_RESULT createPipeLayoutNodeTess(const FbrVulkan *pVulkan,
     const VkDescriptorSetLayout pSetLayouts[] = {
             pDescriptors->setLayoutGlobal.layout,
             pDescriptors->setLayoutPass.layout,
-            pDescriptors->setLayoutMaterial.layout,
+            pDescriptors->setLayoutTextures.layout,
             pDescriptors->setLayoutNode.layout
     };
     const VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
@@ -45,8 +77,8 @@ static FBR_RESULT createPipeLayoutNodeTess(const FbrVulkan *pVulkan,
             .pNext = NULL,
             .setLayoutCount = COUNT(pSetLayouts),
             .pSetLayouts = pSetLayouts,
-            .pPushConstantRanges = NULL,
-            .pushConstantRangeCount  = 0
+            .pPushConstantRanges = &textureIndicesRange,
+            .pushConstantRangeCount  = 1
     };
     FBR_ACK(vkCreatePipelineLayout(pVulkan->device,
                                    &pipelineLayoutInfo,
@@ -63,14 +95,15 @@ static FBR_RESULT createPipeLayoutNodeMesh(const FbrVulkan *pVulkan,
     const VkDescriptorSetLayout pSetLayouts[] = {
             pDescriptors->setLayoutGlobal.layout,
             pDescriptors->setLayoutMeshComposite.layout,
+            pDescriptors->setLayoutTextures.layout,
     };
     const VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
             .pNext = NULL,
             .setLayoutCount = COUNT(pSetLayouts),
             .pSetLayouts = pSetLayouts,
-            .pPushConstantRanges = NULL,
-            .pushConstantRangeCount  = 0
+            .pPushConstantRanges = &textureIndicesRange,
+            .pushConstantRangeCount  = 1
     };
     FBR_ACK(vkCreatePipelineLayout(pVulkan->device,
                                    &pipelineLayoutInfo,
@@ -124,53 +157,29 @@ static FBR_RESULT createPipelineLayouts(const FbrVulkan *pVulkan,
 }
 
 
-static FBR_RESULT allocReadFile(const char *filename,
-                                uint32_t *length,
-                                char **ppContents)
-{
-    FILE *file = fopen(filename, "rb");
-
-    if (file == NULL) {
-        FBR_LOG_DEBUG("File can't be opened!", filename);
-        return VK_ERROR_UNKNOWN;
-    }
-
-    fseek(file, 0, SEEK_END);
-    *length = ftell(file);
-    rewind(file);
-    *ppContents = calloc(1 + *length, sizeof(char));
-    size_t readCount = fread(*ppContents, *length, 1, file);
-    if (readCount == 0) {
-        FBR_LOG_DEBUG("Failed to read file!", filename);
-        return VK_ERROR_UNKNOWN;
-    }
-    fclose(file);
-
-    return FBR_SUCCESS;
-}
-
 static FBR_RESULT createShaderModule(const FbrVulkan *pVulkan,
-                                     const char *pShaderPath,
+                                     const FbrShaderBundle *pShaderBundle,
+                                     const char *pShaderName,
                                      VkShaderModule *pShaderModule)
 {
-    uint32_t codeLength;
-    char *pShaderCode;
-    FBR_ACK(allocReadFile(pShaderPath,
-                           &codeLength,
-                           &pShaderCode));
+    // points into the mapped bundle, nothing to free
+    const uint32_t *pShaderCode;
+    size_t codeSize;
+    FBR_ACK(fbrGetShaderCode(pShaderBundle,
+                             pShaderName,
+                             &pShaderCode,
+                             &codeSize));
 
     VkShaderModuleCreateInfo createInfo = {
             .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-            .codeSize = codeLength,
-            .pCode = (const uint32_t *) pShaderCode,
+            .codeSize = codeSize,
+            .pCode = pShaderCode,
     };
     FBR_ACK(vkCreateShaderModule(pVulkan->device,
                                   &createInfo,
                                   FBR_ALLOCATOR,
                                   pShaderModule));
 
-    free(pShaderCode);
-
     return FBR_SUCCESS;
 }
 
@@ -309,7 +318,7 @@ static FBR_RESULT createOpaquePipe(const FbrVulkan *pVulkan,
             .basePipelineIndex = 0,
     };
     FBR_ACK(vkCreateGraphicsPipelines(pVulkan->device,
-                                      VK_NULL_HANDLE,
+                                      pVulkan->pipelineCache,
                                       1,
                                       &pipelineInfo,
                                       FBR_ALLOCATOR,
@@ -381,17 +390,19 @@ static FBR_RESULT createVertexInputOpaquePipe(const FbrVulkan *pVulkan,
 
 FBR_RESULT createPipeStandard(const FbrVulkan *pVulkan,
                               const FbrPipelines *pPipes,
-                              const char *pVertShaderPath,
-                              const char *pFragShaderPath,
+                              const char *pVertShaderName,
+                              const char *pFragShaderName,
                               FbrPipeStandard *pPipe)
 {
     VkShaderModule vertShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               pVertShaderPath,
+                               pPipes->pShaderBundle,
+                               pVertShaderName,
                                &vertShaderModule));
     VkShaderModule fragShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               pFragShaderPath,
+                               pPipes->pShaderBundle,
+                               pFragShaderName,
                                &fragShaderModule));
     const VkPipelineShaderStageCreateInfo pStages[] = {
             {
@@ -426,19 +437,23 @@ FBR_RESULT createGraphicsPipeNodeTess(const FbrVulkan *pVulkan,
 {
     VkShaderModule vertShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               "./shaders/node_tess_vert.spv",
+                               pPipes->pShaderBundle,
+                               "node_tess_vert.spv",
                                 &vertShaderModule));
     VkShaderModule fragShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               "./shaders/node_tess_frag.spv",
+                               pPipes->pShaderBundle,
+                               "node_tess_frag.spv",
                                 &fragShaderModule));
     VkShaderModule tessCShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               "./shaders/node_tess_tesc.spv",
+                               pPipes->pShaderBundle,
+                               "node_tess_tesc.spv",
                                 &tessCShaderModule));
     VkShaderModule tessEShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               "./shaders/node_tess_tese.spv",
+                               pPipes->pShaderBundle,
+                               "node_tess_tese.spv",
                                 &tessEShaderModule));
     const VkPipelineShaderStageCreateInfo pStages[] = {
             {
@@ -489,32 +504,45 @@ FBR_RESULT createGraphicsPipeNodeTess(const FbrVulkan *pVulkan,
 
 FBR_RESULT createGraphicsPipeNodeMesh(const FbrVulkan *pVulkan,
                                        const FbrPipelines *pPipes,
-                                       FbrPipeNodeTess *pPipe)
+                                       FbrNodeMeshDensity density,
+                                       FbrPipeNodeMesh *pPipe)
 {
     VkShaderModule taskShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               "./shaders/node_mesh_task.spv",
+                               pPipes->pShaderBundle,
+                               "node_mesh_task.spv",
                                &taskShaderModule));
     VkShaderModule meshShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               "./shaders/node_mesh_mesh.spv",
+                               pPipes->pShaderBundle,
+                               "node_mesh_mesh.spv",
                                &meshShaderModule));
     VkShaderModule fragShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               "./shaders/node_mesh_frag.spv",
+                               pPipes->pShaderBundle,
+                               "node_mesh_frag.spv",
                                &fragShaderModule));
+    // task and mesh stage must agree on the grid
+    const VkSpecializationInfo specializationInfo = {
+            .mapEntryCount = COUNT(nodeMeshSpecializationEntries),
+            .pMapEntries = nodeMeshSpecializationEntries,
+            .dataSize = sizeof(FbrNodeMeshSpecialization),
+            .pData = &nodeMeshDensities[density],
+    };
     const VkPipelineShaderStageCreateInfo pStages[] = {
             {
                     .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
                     .stage = VK_SHADER_STAGE_TASK_BIT_EXT,
                     .module = taskShaderModule,
                     .pName = "main",
+                    .pSpecializationInfo = &specializationInfo,
             },
             {
                     .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
                     .stage = VK_SHADER_STAGE_MESH_BIT_EXT,
                     .module = meshShaderModule,
                     .pName = "main",
+                    .pSpecializationInfo = &specializationInfo,
             },
             {
                     .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -540,18 +568,34 @@ FBR_RESULT createGraphicsPipeNodeMesh(const FbrVulkan *pVulkan,
 
 FBR_RESULT createComputePipeComposite(const FbrVulkan *pVulkan,
                                       const FbrPipelines *pPipes,
-                                      const char *pCompositeShaderPath,
+                                      const char *pCompositeShaderName,
+                                      VkExtent2D extent,
+                                      VkExtent2D localSize,
                                       FbrComputePipeComposite *pPipe)
 {
     VkShaderModule compositeShaderModule;
     FBR_ACK(createShaderModule(pVulkan,
-                               pCompositeShaderPath,
+                               pPipes->pShaderBundle,
+                               pCompositeShaderName,
                                &compositeShaderModule));
+    const FbrCompositeSpecialization specialization = {
+            .frameWidth = extent.width,
+            .frameHeight = extent.height,
+            .localSizeX = localSize.width,
+            .localSizeY = localSize.height,
+    };
+    const VkSpecializationInfo specializationInfo = {
+            .mapEntryCount = COUNT(compositeSpecializationEntries),
+            .pMapEntries = compositeSpecializationEntries,
+            .dataSize = sizeof(FbrCompositeSpecialization),
+            .pData = &specialization,
+    };
     const VkPipelineShaderStageCreateInfo stage = {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .stage = VK_SHADER_STAGE_COMPUTE_BIT,
             .module = compositeShaderModule,
             .pName = "main",
+            .pSpecializationInfo = &specializationInfo,
     };
     const VkComputePipelineCreateInfo pipelineInfo = {
             .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
@@ -559,39 +603,221 @@ FBR_RESULT createComputePipeComposite(const FbrVulkan *pVulkan,
             .stage = stage,
     };
     FBR_ACK(vkCreateComputePipelines(pVulkan->device,
-                                     VK_NULL_HANDLE,
+                                     pVulkan->pipelineCache,
                                      1,
                                      &pipelineInfo,
                                      FBR_ALLOCATOR,
                                      pPipe));
+    vkDestroyShaderModule(pVulkan->device, compositeShaderModule, FBR_ALLOCATOR);
+
+    FBR_LOG_MESSAGE("Created composite variant.", extent.width, extent.height, localSize.width, localSize.height);
 
     return FBR_SUCCESS;
 }
 
-static FBR_RESULT createPipes(const FbrVulkan *pVulkan,
-                              FbrPipelines *pPipes)
+static FBR_RESULT createJobPipeStandard(const FbrVulkan *pVulkan,
+                                        const FbrPipelines *pPipes,
+                                        VkPipeline *pPipe)
 {
-    FBR_ACK(createPipeStandard(pVulkan,
-                               pPipes,
-                               "./shaders/vert.spv",
+    return createPipeStandard(pVulkan,
+                              pPipes,
+                              "vert.spv",
 //                                  pVulkan->isChild ?
-//                                  "./shaders/frag_crasher.spv":
-                               "./shaders/frag.spv",
-                               &pPipes->graphicsPipeStandard));
-    FBR_ACK(createGraphicsPipeNodeTess(pVulkan,
-                                       pPipes,
-                                       &pPipes->graphicsPipeNodeTess));
-    FBR_ACK(createGraphicsPipeNodeMesh(pVulkan,
-                                       pPipes,
-                                       &pPipes->graphicsPipeNodeMesh));
+//                                  "frag_crasher.spv":
+                              "frag.spv",
+                              pPipe);
+}
+
+static FBR_RESULT createJobComputePipeComposite(const FbrVulkan *pVulkan,
+                                                const FbrPipelines *pPipes,
+                                                VkPipeline *pPipe)
+{
+    return createComputePipeComposite(pVulkan,
+                                      pPipes,
+                                      FBR_COMPOSITE_SHADER_NAME,
+                                      pPipes->compositeExtent,
+                                      pPipes->compositeLocalSize,
+                                      pPipe);
+}
+
+static FBR_RESULT createJobPipeNodeMeshLow(const FbrVulkan *pVulkan,
+                                           const FbrPipelines *pPipes,
+                                           VkPipeline *pPipe)
+{
+    return createGraphicsPipeNodeMesh(pVulkan, pPipes, FBR_NODE_MESH_DENSITY_LOW, pPipe);
+}
+
+static FBR_RESULT createJobPipeNodeMeshMedium(const FbrVulkan *pVulkan,
+                                              const FbrPipelines *pPipes,
+                                              VkPipeline *pPipe)
+{
+    return createGraphicsPipeNodeMesh(pVulkan, pPipes, FBR_NODE_MESH_DENSITY_MEDIUM, pPipe);
+}
+
+static FBR_RESULT createJobPipeNodeMeshHigh(const FbrVulkan *pVulkan,
+                                            const FbrPipelines *pPipes,
+                                            VkPipeline *pPipe)
+{
+    return createGraphicsPipeNodeMesh(pVulkan, pPipes, FBR_NODE_MESH_DENSITY_HIGH, pPipe);
+}
+
+static const FbrCreatePipeFunc createJobPipeNodeMesh[FBR_NODE_MESH_DENSITY_COUNT] = {
+        [FBR_NODE_MESH_DENSITY_LOW] = createJobPipeNodeMeshLow,
+        [FBR_NODE_MESH_DENSITY_MEDIUM] = createJobPipeNodeMeshMedium,
+        [FBR_NODE_MESH_DENSITY_HIGH] = createJobPipeNodeMeshHigh,
+};
+
+#ifdef WIN32
+static DWORD WINAPI runPipeJob(LPVOID pParam)
+{
+    FbrPipeJob *pJob = pParam;
+    pJob->result = pJob->createPipe(pJob->pVulkan, pJob->pPipes, pJob->pPipe);
+    return 0;
+}
+#endif
+
+static void startPipeJob(const FbrVulkan *pVulkan,
+                         FbrPipelines *pPipes,
+                         FbrPipeJobType type,
+                         FbrCreatePipeFunc createPipe,
+                         VkPipeline *pPipe)
+{
+    FbrPipeJob *pJob = &pPipes->pJobs[type];
+    *pJob = (FbrPipeJob) {
+            .pVulkan = pVulkan,
+            .pPipes = pPipes,
+            .createPipe = createPipe,
+            .pPipe = pPipe,
+            .result = FBR_SUCCESS,
+    };
+#ifdef WIN32
+    pJob->thread = CreateThread(NULL, 0, runPipeJob, pJob, 0, NULL);
+    if (pJob->thread != NULL)
+        return;
+    FBR_LOG_ERROR("Failed to start pipeline thread, creating inline!");
+#endif
+    pJob->result = createPipe(pVulkan, pPipes, pPipe);
+}
+
+// Layouts are created up front on the calling thread, jobs only read them.
+// The pipeline cache is internally synchronized so all jobs can share it.
+static void startPipeJobs(const FbrVulkan *pVulkan,
+                          FbrPipelines *pPipes)
+{
+    startPipeJob(pVulkan,
+                 pPipes,
+                 FBR_PIPE_JOB_STANDARD,
+                 createJobPipeStandard,
+                 &pPipes->graphicsPipeStandard);
+    startPipeJob(pVulkan,
+                 pPipes,
+                 FBR_PIPE_JOB_NODE_TESS,
+                 createGraphicsPipeNodeTess,
+                 &pPipes->graphicsPipeNodeTess);
+    startPipeJob(pVulkan,
+                 pPipes,
+                 FBR_PIPE_JOB_COMPOSITE,
+                 createJobComputePipeComposite,
+                 &pPipes->computePipeComposite);
+    for (int i = 0; i < FBR_NODE_MESH_DENSITY_COUNT; ++i) {
+        startPipeJob(pVulkan,
+                     pPipes,
+                     FBR_PIPE_JOB_NODE_MESH + i,
+                     createJobPipeNodeMesh[i],
+                     &pPipes->pGraphicsPipeNodeMesh[i]);
+    }
+}
+
+// Largest square power of two up to FBR_COMPOSITE_MAX_LOCAL_SIZE the device can run in one group
+static VkExtent2D getDefaultCompositeLocalSize(const FbrVulkan *pVulkan)
+{
+    const VkPhysicalDeviceLimits *pLimits = &pVulkan->physicalDeviceProperties.properties.limits;
+    uint32_t size = FBR_COMPOSITE_MAX_LOCAL_SIZE;
+    while (size > 1 &&
+           (size * size > pLimits->maxComputeWorkGroupInvocations ||
+            size > pLimits->maxComputeWorkGroupSize[0] ||
+            size > pLimits->maxComputeWorkGroupSize[1])) {
+        size /= 2;
+    }
+    return (VkExtent2D) {size, size};
+}
+
+static bool extentEqual(VkExtent2D a, VkExtent2D b)
+{
+    return a.width == b.width && a.height == b.height;
+}
+
+FBR_RESULT fbrGetPipeNodeMesh(FbrPipelines *pPipelines,
+                              FbrNodeMeshDensity density,
+                              FbrPipeNodeMesh *pPipe)
+{
+    FBR_ACK(fbrWaitPipeline(pPipelines, FBR_PIPE_JOB_NODE_MESH + density));
+    *pPipe = pPipelines->pGraphicsPipeNodeMesh[density];
+    return FBR_SUCCESS;
+}
+
+FBR_RESULT fbrGetComputePipeComposite(const FbrVulkan *pVulkan,
+                                      FbrPipelines *pPipelines,
+                                      VkExtent2D extent,
+                                      VkExtent2D localSize,
+                                      FbrComputePipeComposite *pPipe)
+{
+    if (extentEqual(extent, pPipelines->compositeExtent) && extentEqual(localSize, pPipelines->compositeLocalSize)) {
+        FBR_ACK(fbrWaitPipeline(pPipelines, FBR_PIPE_JOB_COMPOSITE));
+        *pPipe = pPipelines->computePipeComposite;
+        return FBR_SUCCESS;
+    }
+
+    for (int i = 0; i < arrlen(pPipelines->pCompositeVariants); ++i) {
+        const FbrComputePipeCompositeVariant *pVariant = &pPipelines->pCompositeVariants[i];
+        if (extentEqual(extent, pVariant->extent) && extentEqual(localSize, pVariant->localSize)) {
+            *pPipe = pVariant->pipe;
+            return FBR_SUCCESS;
+        }
+    }
+
+    // only hit when the output changes size or the shape is retuned, the pipeline cache keeps it cheap
+    FbrComputePipeCompositeVariant variant = {
+            .extent = extent,
+            .localSize = localSize,
+    };
     FBR_ACK(createComputePipeComposite(pVulkan,
-                                       pPipes,
-                                       "./shaders/composite_depthoffset_comp.spv",
-                                       &pPipes->computePipeComposite));
+                                       pPipelines,
+                                       FBR_COMPOSITE_SHADER_NAME,
+                                       extent,
+                                       localSize,
+                                       &variant.pipe));
+    arrput(pPipelines->pCompositeVariants, variant);
+    *pPipe = variant.pipe;
 
     return FBR_SUCCESS;
 }
 
+FBR_RESULT fbrWaitPipeline(FbrPipelines *pPipelines,
+                           FbrPipeJobType type)
+{
+    FbrPipeJob *pJob = &pPipelines->pJobs[type];
+#ifdef WIN32
+    if (pJob->thread != NULL) {
+        WaitForSingleObject(pJob->thread, INFINITE);
+        CloseHandle(pJob->thread);
+        pJob->thread = NULL;
+    }
+#endif
+    return pJob->result;
+}
+
+FBR_RESULT fbrWaitPipelines(FbrPipelines *pPipelines)
+{
+    FBR_RESULT result = FBR_SUCCESS;
+    for (int i = 0; i < FBR_PIPE_JOB_COUNT; ++i) {
+        const FBR_RESULT jobResult = fbrWaitPipeline(pPipelines, i);
+        if (jobResult != FBR_SUCCESS)
+            result = jobResult;
+    }
+    return result;
+}
+
 FBR_RESULT fbrCreatePipelines(const FbrVulkan *pVulkan,
                             const FbrDescriptors *pDescriptors,
                             FbrPipelines **ppAllocPipes)
@@ -599,8 +825,21 @@ FBR_RESULT fbrCreatePipelines(const FbrVulkan *pVulkan,
     *ppAllocPipes = calloc(1, sizeof(FbrPipelines));
     FbrPipelines *pPipes = *ppAllocPipes;
 
+    FBR_ACK(fbrCreateShaderBundle(FBR_SHADER_BUNDLE_PATH, &pPipes->pShaderBundle));
     FBR_ACK(createPipelineLayouts(pVulkan, pDescriptors, pPipes));
-    FBR_ACK(createPipes(pVulkan, pPipes));
+
+    // the swap usually matches the screen, anything else becomes a variant on first use
+    pPipes->compositeExtent = (VkExtent2D) {pVulkan->screenWidth, pVulkan->screenHeight};
+    pPipes->compositeLocalSize = getDefaultCompositeLocalSize(pVulkan);
+
+    startPipeJobs(pVulkan, pPipes);
+
+    // only block on what the first frame binds, the rest finish in the background
+    FBR_ACK(fbrWaitPipeline(pPipes, FBR_PIPE_JOB_STANDARD));
+    if (!pVulkan->isChild) {
+        FBR_ACK(fbrWaitPipeline(pPipes, FBR_PIPE_JOB_NODE_MESH + FBR_NODE_MESH_DENSITY_MEDIUM));
+        FBR_ACK(fbrWaitPipeline(pPipes, FBR_PIPE_JOB_COMPOSITE));
+    }
 
     return FBR_SUCCESS;
 }
@@ -608,13 +847,26 @@ FBR_RESULT fbrCreatePipelines(const FbrVulkan *pVulkan,
 void fbrDestroyPipelines(const FbrVulkan *pVulkan,
                          FbrPipelines *pPipelines)
 {
+    // jobs still running in the background would otherwise outlive their layouts
+    fbrWaitPipelines(pPipelines);
+
     vkDestroyPipelineLayout(pVulkan->device, pPipelines->graphicsPipeLayoutStandard, FBR_ALLOCATOR);
     vkDestroyPipelineLayout(pVulkan->device, pPipelines->graphicsPipeLayoutNodeTess, FBR_ALLOCATOR);
+    vkDestroyPipelineLayout(pVulkan->device, pPipelines->graphicsPipeLayoutNodeMesh, FBR_ALLOCATOR);
     vkDestroyPipelineLayout(pVulkan->device, pPipelines->computePipeLayoutComposite, FBR_ALLOCATOR);
 
     vkDestroyPipeline(pVulkan->device, pPipelines->graphicsPipeStandard, FBR_ALLOCATOR);
     vkDestroyPipeline(pVulkan->device, pPipelines->graphicsPipeNodeTess, FBR_ALLOCATOR);
+    for (int i = 0; i < FBR_NODE_MESH_DENSITY_COUNT; ++i) {
+        vkDestroyPipeline(pVulkan->device, pPipelines->pGraphicsPipeNodeMesh[i], FBR_ALLOCATOR);
+    }
     vkDestroyPipeline(pVulkan->device, pPipelines->computePipeComposite, FBR_ALLOCATOR);
+    for (int i = 0; i < arrlen(pPipelines->pCompositeVariants); ++i) {
+        vkDestroyPipeline(pVulkan->device, pPipelines->pCompositeVariants[i].pipe, FBR_ALLOCATOR);
+    }
+    arrfree(pPipelines->pCompositeVariants);
+
+    fbrDestroyShaderBundle(pPipelines->pShaderBundle);
 
     free(pPipelines);
 }
\ No newline at end of file
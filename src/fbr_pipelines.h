@@ -3,6 +3,7 @@
 
 #include "fbr_app.h"
 #include "fbr_vulkan.h"
+#include "fbr_shader_bundle.h"
 
 typedef VkPipelineLayout FbrPipeLayoutStandard;
 typedef VkPipeline FbrPipeStandard;
@@ -16,6 +17,54 @@ typedef VkPipeline FbrPipeNodeMesh;
 typedef VkPipelineLayout FbrComputePipeLayoutComposite;
 typedef VkPipeline FbrComputePipeComposite;
 
+#define FBR_COMPOSITE_SHADER_NAME "composite_depthoffset_comp.spv"
+#define FBR_COMPOSITE_MAX_LOCAL_SIZE 32
+
+// Matches the constant_ids in composite_depthoffset.comp
+typedef struct FbrCompositeSpecialization {
+    uint32_t frameWidth;
+    uint32_t frameHeight;
+    uint32_t localSizeX;
+    uint32_t localSizeY;
+} FbrCompositeSpecialization;
+
+typedef struct FbrComputePipeCompositeVariant {
+    VkExtent2D extent;
+    VkExtent2D localSize;
+    FbrComputePipeComposite pipe;
+} FbrComputePipeCompositeVariant;
+
+// Matches the constant_ids in node_mesh_constants.glsl
+typedef struct FbrNodeMeshSpecialization {
+    uint32_t vertexDimensionCount;
+    uint32_t scale;
+} FbrNodeMeshSpecialization;
+
+typedef enum FbrPipeJobType {
+    FBR_PIPE_JOB_STANDARD,
+    FBR_PIPE_JOB_NODE_TESS,
+    FBR_PIPE_JOB_COMPOSITE,
+    // one job per FbrNodeMeshDensity
+    FBR_PIPE_JOB_NODE_MESH,
+    FBR_PIPE_JOB_COUNT = FBR_PIPE_JOB_NODE_MESH + FBR_NODE_MESH_DENSITY_COUNT,
+} FbrPipeJobType;
+
+typedef FBR_RESULT (*FbrCreatePipeFunc)(const FbrVulkan *pVulkan,
+                                        const FbrPipelines *pPipes,
+                                        VkPipeline *pPipe);
+
+// Each pipeline is built on its own worker thread against the shared pipeline cache.
+typedef struct FbrPipeJob {
+    const FbrVulkan *pVulkan;
+    const FbrPipelines *pPipes;
+    FbrCreatePipeFunc createPipe;
+    VkPipeline *pPipe;
+    FBR_RESULT result;
+#ifdef WIN32
+    HANDLE thread;
+#endif
+} FbrPipeJob;
+
 typedef struct FbrPipelines {
     VkPipelineLayout graphicsPipeLayoutStandard;
     FbrPipeStandard graphicsPipeStandard;
@@ -24,16 +73,44 @@ typedef struct FbrPipelines {
     FbrPipeNodeTess graphicsPipeNodeTess;
 
     VkPipelineLayout graphicsPipeLayoutNodeMesh;
-    FbrPipeNodeMesh graphicsPipeNodeMesh;
+    FbrPipeNodeMesh pGraphicsPipeNodeMesh[FBR_NODE_MESH_DENSITY_COUNT];
 
     VkPipelineLayout computePipeLayoutComposite;
     FbrComputePipeComposite computePipeComposite;
+    // key of computePipeComposite, other keys go in pCompositeVariants
+    VkExtent2D compositeExtent;
+    VkExtent2D compositeLocalSize;
+    // stb_ds array
+    FbrComputePipeCompositeVariant *pCompositeVariants;
+
+    // mapped for as long as pipelines can still be created from it
+    FbrShaderBundle *pShaderBundle;
+
+    FbrPipeJob pJobs[FBR_PIPE_JOB_COUNT];
 } FbrPipelines;
 
 FBR_RESULT fbrCreatePipelines(const FbrVulkan *pVulkan,
                               const FbrDescriptors *pDescriptors,
                               FbrPipelines **ppAllocPipes);
 
+// Blocks until the pipeline of the job has been created, must be called before first use unless fbrCreatePipelines already waited on it.
+FBR_RESULT fbrWaitPipeline(FbrPipelines *pPipelines,
+                           FbrPipeJobType type);
+
+FBR_RESULT fbrWaitPipelines(FbrPipelines *pPipelines);
+
+// Waits if the variant is still being built in the background.
+FBR_RESULT fbrGetPipeNodeMesh(FbrPipelines *pPipelines,
+                              FbrNodeMeshDensity density,
+                              FbrPipeNodeMesh *pPipe);
+
+// Looks up or creates the composite pipeline specialized for this output extent and workgroup shape.
+FBR_RESULT fbrGetComputePipeComposite(const FbrVulkan *pVulkan,
+                                      FbrPipelines *pPipelines,
+                                      VkExtent2D extent,
+                                      VkExtent2D localSize,
+                                      FbrComputePipeComposite *pPipe);
+
 void fbrDestroyPipelines(const FbrVulkan *pVulkan,
                                  FbrPipelines *pPipelines);
 
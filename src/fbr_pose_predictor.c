@@ -0,0 +1,84 @@
+#include "fbr_pose_predictor.h"
+
+static double ticksToSeconds(const FbrPosePredictor *pPredictor, int64_t ticks) {
+    return (double) ticks / (double) pPredictor->traceFrequency;
+}
+
+// age 0 is the newest
+static const FbrPoseSample *getSample(const FbrPosePredictor *pPredictor, uint32_t age) {
+    const uint32_t index = (pPredictor->historyIndex + FBR_POSE_PREDICTOR_HISTORY_COUNT - 1 - age) % FBR_POSE_PREDICTOR_HISTORY_COUNT;
+    return &pPredictor->pHistory[index];
+}
+
+void fbrInitPosePredictor(FbrPosePredictor *pPredictor, int64_t traceFrequency) {
+    pPredictor->historyCount = 0;
+    pPredictor->historyIndex = 0;
+    pPredictor->traceFrequency = traceFrequency;
+}
+
+void fbrPushPoseSample(FbrPosePredictor *pPredictor, int64_t timestamp, vec3 pos, versor rot) {
+    if (pPredictor->historyCount > 0 && timestamp <= getSample(pPredictor, 0)->timestamp)
+        return;
+
+    FbrPoseSample *pSample = &pPredictor->pHistory[pPredictor->historyIndex];
+    pSample->timestamp = timestamp;
+    glm_vec3_copy(pos, pSample->pos);
+    glm_quat_copy(rot, pSample->rot);
+    pPredictor->historyIndex = (pPredictor->historyIndex + 1) % FBR_POSE_PREDICTOR_HISTORY_COUNT;
+    if (pPredictor->historyCount < FBR_POSE_PREDICTOR_HISTORY_COUNT)
+        pPredictor->historyCount++;
+}
+
+bool fbrPredictPose(const FbrPosePredictor *pPredictor, int64_t targetTimestamp, vec3 pos, versor rot) {
+    if (pPredictor->historyCount == 0) {
+        glm_vec3_zero(pos);
+        glm_quat_identity(rot);
+        return false;
+    }
+
+    const FbrPoseSample *pNewest = getSample(pPredictor, 0);
+    glm_vec3_copy((float *) pNewest->pos, pos);
+    glm_quat_copy((float *) pNewest->rot, rot);
+    if (pPredictor->historyCount < 2)
+        return false;
+
+    // the previous sample always counts so a slow frame still predicts, older ones only inside the window
+    const FbrPoseSample *pOldest = getSample(pPredictor, 1);
+    for (uint32_t age = 2; age < pPredictor->historyCount; ++age) {
+        const FbrPoseSample *pSample = getSample(pPredictor, age);
+        if (ticksToSeconds(pPredictor, pNewest->timestamp - pSample->timestamp) * 1000.0 > FBR_POSE_PREDICTOR_VELOCITY_WINDOW_MS)
+            break;
+        pOldest = pSample;
+    }
+
+    const double span = ticksToSeconds(pPredictor, pNewest->timestamp - pOldest->timestamp);
+    double horizon = ticksToSeconds(pPredictor, targetTimestamp - pNewest->timestamp);
+    if (horizon > FBR_POSE_PREDICTOR_MAX_HORIZON_MS / 1000.0)
+        horizon = FBR_POSE_PREDICTOR_MAX_HORIZON_MS / 1000.0;
+    if (horizon <= 0)
+        return true;
+    const float scale = (float) (horizon / span);
+
+    vec3 deltaPos;
+    glm_vec3_sub((float *) pNewest->pos, (float *) pOldest->pos, deltaPos);
+    glm_vec3_muladds(deltaPos, scale, pos);
+
+    // world space rotation from the oldest to the newest, q and -q are the same so take the short way
+    versor inverseRot;
+    versor deltaRot;
+    glm_quat_inv((float *) pOldest->rot, inverseRot);
+    glm_quat_mul((float *) pNewest->rot, inverseRot, deltaRot);
+    if (deltaRot[3] < 0)
+        glm_vec4_negate(deltaRot);
+    const float angle = glm_quat_angle(deltaRot);
+    if (angle > GLM_FLT_EPSILON) {
+        vec3 axis;
+        versor stepRot;
+        glm_quat_axis(deltaRot, axis);
+        glm_quatv(stepRot, angle * scale, axis);
+        glm_quat_mul(stepRot, rot, rot);
+        glm_quat_normalize(rot);
+    }
+
+    return true;
+}
@@ -0,0 +1,38 @@
+#ifndef FABRIC_POSE_PREDICTOR_H
+#define FABRIC_POSE_PREDICTOR_H
+
+#include "fbr_cglm.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FBR_POSE_PREDICTOR_HISTORY_COUNT 16
+// velocities are taken across the samples this recent, longer smooths jitter but reacts later to a stop
+#define FBR_POSE_PREDICTOR_VELOCITY_WINDOW_MS 50.0
+// never extrapolate further than this, errors grow with the square of the horizon on curved paths
+#define FBR_POSE_PREDICTOR_MAX_HORIZON_MS 100.0
+
+typedef struct FbrPoseSample {
+    // trace clock
+    int64_t timestamp;
+    vec3 pos;
+    versor rot;
+} FbrPoseSample;
+
+// Keeps recent poses and extrapolates them, position linearly and rotation by constant angular velocity
+typedef struct FbrPosePredictor {
+    FbrPoseSample pHistory[FBR_POSE_PREDICTOR_HISTORY_COUNT];
+    uint32_t historyCount;
+    uint32_t historyIndex;
+    int64_t traceFrequency;
+} FbrPosePredictor;
+
+void fbrInitPosePredictor(FbrPosePredictor *pPredictor, int64_t traceFrequency);
+
+// Samples must come in increasing time, one no newer than the last is dropped.
+void fbrPushPoseSample(FbrPosePredictor *pPredictor, int64_t timestamp, vec3 pos, versor rot);
+
+// Pose expected at targetTimestamp. Returns false with the latest pose, or identity, if there isn't enough history.
+bool fbrPredictPose(const FbrPosePredictor *pPredictor, int64_t targetTimestamp, vec3 pos, versor rot);
+
+#endif //FABRIC_POSE_PREDICTOR_H
@@ -3,9 +3,10 @@
 #include <stdio.h>
 #include <tchar.h>
 
-void fbrCreateProcess(FbrProcess **ppAllocProcess) {
+void fbrCreateProcess(bool headless, FbrProcess **ppAllocProcess) {
     *ppAllocProcess = calloc(1, sizeof(FbrProcess));
     FbrProcess *pProcess = *ppAllocProcess;
+    pProcess->headless = headless;
 
     STARTUPINFO si;
     PROCESS_INFORMATION pi;
@@ -17,7 +18,7 @@ void fbrCreateProcess(FbrProcess **ppAllocProcess) {
 
     char buf[256];
 
-    snprintf(buf, sizeof(buf), "fabric.exe -child");
+    snprintf(buf, sizeof(buf), headless ? "fabric.exe -child -headless" : "fabric.exe -child");
     FBR_LOG_MESSAGE("Process Command", buf);
 
     if (!CreateProcess(NULL,   // No module name (use command line)
@@ -39,6 +40,11 @@ void fbrCreateProcess(FbrProcess **ppAllocProcess) {
 }
 
 void fbrDestroyProcess(FbrProcess *pProcess) {
+    // child blocks on the parent timeline which has stopped advancing
+    if (pProcess->headless) {
+        TerminateProcess(pProcess->pi.hProcess, 0);
+    }
+
     // TODO this is probably bad
     // Wait until child process exits.
     WaitForSingleObject(pProcess->pi.hProcess, INFINITE);
@@ -10,9 +10,11 @@
 typedef struct FbrProcess {
     STARTUPINFO si;
     PROCESS_INFORMATION pi;
+    // no window to close a headless child, it is terminated on destroy
+    bool headless;
 } FbrProcess;
 
-void fbrCreateProcess(FbrProcess **ppAllocProcess);
+void fbrCreateProcess(bool headless, FbrProcess **ppAllocProcess);
 
 void fbrDestroyProcess(FbrProcess *pProcess);
 
@@ -0,0 +1,233 @@
+#include "fbr_profiler.h"
+#include "fbr_vulkan.h"
+#include "fbr_log.h"
+#include "fbr_trace.h"
+
+#include <float.h>
+
+#define FBR_PROFILER_QUERIES_PER_FRAME (FBR_PROFILER_ZONE_COUNT * 2)
+
+// must be the clock fbrGetTraceTimestamp reads
+#ifdef WIN32
+#define FBR_PROFILER_TRACE_TIME_DOMAIN VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT
+#else
+#define FBR_PROFILER_TRACE_TIME_DOMAIN VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT
+#endif
+
+static const char *pZoneNames[FBR_PROFILER_ZONE_COUNT] = {
+        [FBR_PROFILER_ZONE_CHILD_RENDER] = "child render",
+        [FBR_PROFILER_ZONE_BARRIERS] = "barriers",
+        [FBR_PROFILER_ZONE_COMPOSITE] = "composite",
+        [FBR_PROFILER_ZONE_BLIT] = "blit",
+        [FBR_PROFILER_ZONE_PRESENT_TRANSITION] = "present transition",
+};
+
+static uint32_t getQueryIndex(const FbrProfiler *pProfiler, FbrProfilerZone zone, bool end) {
+    return pProfiler->frameSlot * FBR_PROFILER_QUERIES_PER_FRAME + zone * 2 + end;
+}
+
+static void pushZoneReading(FbrProfilerZoneStats *pStats, float ms) {
+    pStats->pHistory[pStats->historyIndex] = ms;
+    pStats->historyIndex = (pStats->historyIndex + 1) % FBR_PROFILER_HISTORY_COUNT;
+    if (pStats->historyCount < FBR_PROFILER_HISTORY_COUNT)
+        pStats->historyCount++;
+}
+
+static void calibrate(const FbrVulkan *pVulkan, FbrProfiler *pProfiler) {
+    if (!pVulkan->calibratedTimestampsSupported)
+        return;
+
+    const VkCalibratedTimestampInfoEXT pTimestampInfos[] = {
+            {
+                    .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+                    .timeDomain = VK_TIME_DOMAIN_DEVICE_EXT,
+            },
+            {
+                    .sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT,
+                    .timeDomain = FBR_PROFILER_TRACE_TIME_DOMAIN,
+            },
+    };
+    uint64_t pTimestamps[COUNT(pTimestampInfos)];
+    uint64_t maxDeviation;
+    if (pVulkan->functions.getCalibratedTimestamps(pVulkan->device,
+                                                   COUNT(pTimestampInfos),
+                                                   pTimestampInfos,
+                                                   pTimestamps,
+                                                   &maxDeviation) != VK_SUCCESS)
+        return;
+    pProfiler->calibrationDeviceTimestamp = pTimestamps[0];
+    pProfiler->calibrationTraceTimestamp = (int64_t) pTimestamps[1];
+}
+
+static int64_t deviceToTraceTicks(const FbrProfiler *pProfiler, double deviceTicks) {
+    return (int64_t) (deviceTicks * pProfiler->timestampPeriod * (double) pProfiler->traceFrequency / 1000000000.0);
+}
+
+// Zones are in the past so the distance to the calibration is usually negative, and may wrap the valid bits
+static int64_t deviceToTraceTimestamp(const FbrProfiler *pProfiler, uint64_t deviceTimestamp, uint64_t timestampMask) {
+    const uint64_t delta = (deviceTimestamp - pProfiler->calibrationDeviceTimestamp) & timestampMask;
+    const double signedDelta = delta > (timestampMask >> 1) ?
+                               -(double) ((pProfiler->calibrationDeviceTimestamp - deviceTimestamp) & timestampMask) :
+                               (double) delta;
+    return pProfiler->calibrationTraceTimestamp + deviceToTraceTicks(pProfiler, signedDelta);
+}
+
+// Only takes results which are already available, a zone still in flight just misses this sample
+static void collectFrameSlot(const FbrVulkan *pVulkan, FbrProfiler *pProfiler) {
+    pProfiler->collectedZones = 0;
+    const uint32_t writtenZones = pProfiler->pWrittenZones[pProfiler->frameSlot];
+    const uint32_t computeZones = pProfiler->pComputeZones[pProfiler->frameSlot];
+    if (writtenZones == 0)
+        return;
+
+    // value and availability pairs
+    uint64_t pResults[FBR_PROFILER_QUERIES_PER_FRAME][2];
+    vkGetQueryPoolResults(pVulkan->device,
+                          pProfiler->queryPool,
+                          pProfiler->frameSlot * FBR_PROFILER_QUERIES_PER_FRAME,
+                          FBR_PROFILER_QUERIES_PER_FRAME,
+                          sizeof(pResults),
+                          pResults,
+                          sizeof(pResults[0]),
+                          VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    for (int zone = 0; zone < FBR_PROFILER_ZONE_COUNT; ++zone) {
+        if ((writtenZones & (1u << zone)) == 0)
+            continue;
+        const uint64_t *pBegin = pResults[zone * 2];
+        const uint64_t *pEnd = pResults[zone * 2 + 1];
+        if (pBegin[1] == 0 || pEnd[1] == 0)
+            continue;
+        const uint64_t timestampMask = (computeZones & (1u << zone)) != 0 ?
+                                       pProfiler->computeTimestampMask :
+                                       pProfiler->graphicsTimestampMask;
+        const uint64_t ticks = (pEnd[0] - pBegin[0]) & timestampMask;
+        const float ms = (float) ((double) ticks * pProfiler->timestampPeriod / 1000000.0);
+        pushZoneReading(&pProfiler->pZoneStats[zone], ms);
+        pProfiler->collectedZones |= 1u << zone;
+        pProfiler->pCollectedMs[zone] = ms;
+
+        if (pProfiler->calibrationDeviceTimestamp != 0)
+            fbrTraceComplete(FBR_TRACE_CATEGORY_GPU,
+                             pZoneNames[zone],
+                             FBR_TRACE_GPU_THREAD_ID,
+                             deviceToTraceTimestamp(pProfiler, pBegin[0], timestampMask),
+                             deviceToTraceTicks(pProfiler, (double) ticks));
+    }
+}
+
+static uint64_t getTimestampMask(uint32_t validBits) {
+    return validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+}
+
+VkResult fbrCreateProfiler(const FbrVulkan *pVulkan, FbrProfiler **ppAllocProfiler) {
+    *ppAllocProfiler = calloc(1, sizeof(FbrProfiler));
+    FbrProfiler *pProfiler = *ppAllocProfiler;
+
+    pProfiler->timestampPeriod = pVulkan->physicalDeviceProperties.properties.limits.timestampPeriod;
+    pProfiler->traceFrequency = fbrGetTraceFrequency();
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(pVulkan->physicalDevice, &queueFamilyCount, NULL);
+    VkQueueFamilyProperties queueFamilies[queueFamilyCount];
+    vkGetPhysicalDeviceQueueFamilyProperties(pVulkan->physicalDevice, &queueFamilyCount, queueFamilies);
+    // each family can have its own width, a zone is masked with that of the queue it ran on
+    const uint32_t graphicsValidBits = queueFamilies[pVulkan->graphicsQueueFamilyIndex].timestampValidBits;
+    const uint32_t computeValidBits = queueFamilies[pVulkan->computeQueueFamilyIndex].timestampValidBits;
+    pProfiler->graphicsTimestampMask = getTimestampMask(graphicsValidBits);
+    pProfiler->computeTimestampMask = getTimestampMask(computeValidBits);
+    if (graphicsValidBits == 0)
+        FBR_LOG_ERROR("Graphics queue has no timestamp support!");
+    if (computeValidBits == 0)
+        FBR_LOG_ERROR("Compute queue has no timestamp support!");
+
+    const VkQueryPoolCreateInfo queryPoolCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .pNext = NULL,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = FBR_PROFILER_FRAME_COUNT * FBR_PROFILER_QUERIES_PER_FRAME,
+    };
+    FBR_ACK(vkCreateQueryPool(pVulkan->device, &queryPoolCreateInfo, FBR_ALLOCATOR, &pProfiler->queryPool));
+    // hostQueryReset, queries must be reset once before first use
+    vkResetQueryPool(pVulkan->device, pProfiler->queryPool, 0, queryPoolCreateInfo.queryCount);
+
+    return FBR_SUCCESS;
+}
+
+void fbrDestroyProfiler(const FbrVulkan *pVulkan, FbrProfiler *pProfiler) {
+    fbrLogProfiler(pVulkan);
+    vkDestroyQueryPool(pVulkan->device, pProfiler->queryPool, FBR_ALLOCATOR);
+    free(pProfiler);
+}
+
+void fbrBeginProfilerFrame(const FbrVulkan *pVulkan) {
+    FbrProfiler *pProfiler = pVulkan->pProfiler;
+    pProfiler->frameSlot = (pProfiler->frameSlot + 1) % FBR_PROFILER_FRAME_COUNT;
+    pProfiler->frameCount++;
+
+    calibrate(pVulkan, pProfiler);
+    collectFrameSlot(pVulkan, pProfiler);
+
+    vkResetQueryPool(pVulkan->device,
+                     pProfiler->queryPool,
+                     pProfiler->frameSlot * FBR_PROFILER_QUERIES_PER_FRAME,
+                     FBR_PROFILER_QUERIES_PER_FRAME);
+    pProfiler->pWrittenZones[pProfiler->frameSlot] = 0;
+    pProfiler->pComputeZones[pProfiler->frameSlot] = 0;
+
+    if (pProfiler->frameCount % FBR_PROFILER_LOG_INTERVAL == 0)
+        fbrLogProfiler(pVulkan);
+}
+
+void fbrBeginProfilerZone(const FbrVulkan *pVulkan, VkCommandBuffer commandBuffer, FbrProfilerZone zone) {
+    FbrProfiler *pProfiler = pVulkan->pProfiler;
+    vkCmdWriteTimestamp(commandBuffer,
+                        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                        pProfiler->queryPool,
+                        getQueryIndex(pProfiler, zone, false));
+}
+
+void fbrEndProfilerZone(const FbrVulkan *pVulkan, VkCommandBuffer commandBuffer, FbrProfilerZone zone) {
+    FbrProfiler *pProfiler = pVulkan->pProfiler;
+    vkCmdWriteTimestamp(commandBuffer,
+                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                        pProfiler->queryPool,
+                        getQueryIndex(pProfiler, zone, true));
+    pProfiler->pWrittenZones[pProfiler->frameSlot] |= 1u << zone;
+    // the compute command buffer is only ever submitted to the compute queue
+    if (commandBuffer == pVulkan->computeCommandBuffer)
+        pProfiler->pComputeZones[pProfiler->frameSlot] |= 1u << zone;
+}
+
+void fbrGetProfilerZoneStats(const FbrProfiler *pProfiler, FbrProfilerZone zone, float *pMin, float *pAvg, float *pMax) {
+    const FbrProfilerZoneStats *pStats = &pProfiler->pZoneStats[zone];
+    float min = FLT_MAX;
+    float max = 0;
+    float sum = 0;
+    for (uint32_t i = 0; i < pStats->historyCount; ++i) {
+        const float ms = pStats->pHistory[i];
+        if (ms < min)
+            min = ms;
+        if (ms > max)
+            max = ms;
+        sum += ms;
+    }
+    *pMin = pStats->historyCount > 0 ? min : 0;
+    *pAvg = pStats->historyCount > 0 ? sum / (float) pStats->historyCount : 0;
+    *pMax = max;
+}
+
+const char *fbrGetProfilerZoneName(FbrProfilerZone zone) {
+    return pZoneNames[zone];
+}
+
+void fbrLogProfiler(const FbrVulkan *pVulkan) {
+    const FbrProfiler *pProfiler = pVulkan->pProfiler;
+    for (int zone = 0; zone < FBR_PROFILER_ZONE_COUNT; ++zone) {
+        if (pProfiler->pZoneStats[zone].historyCount == 0)
+            continue;
+        float min, avg, max;
+        fbrGetProfilerZoneStats(pProfiler, zone, &min, &avg, &max);
+        FBR_LOG_MESSAGE("GPU zone ms.", fbrGetProfilerZoneName(zone), min, avg, max);
+    }
+}
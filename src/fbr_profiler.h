@@ -0,0 +1,71 @@
+#ifndef FABRIC_PROFILER_H
+#define FABRIC_PROFILER_H
+
+#include "fbr_app.h"
+
+// Results are read back this many frames after they were recorded, every loop waits on its frame before
+// starting the next so the oldest slot in the ring is always complete by the time it is reused
+#define FBR_PROFILER_FRAME_COUNT 3
+// rolling window min/avg/max are taken over
+#define FBR_PROFILER_HISTORY_COUNT 120
+#define FBR_PROFILER_LOG_INTERVAL 600
+
+typedef enum FbrProfilerZone {
+    FBR_PROFILER_ZONE_CHILD_RENDER,
+    FBR_PROFILER_ZONE_BARRIERS,
+    FBR_PROFILER_ZONE_COMPOSITE,
+    FBR_PROFILER_ZONE_BLIT,
+    // only the swap image's transition to its present layout, the present itself happens on the queue
+    FBR_PROFILER_ZONE_PRESENT_TRANSITION,
+    FBR_PROFILER_ZONE_COUNT,
+} FbrProfilerZone;
+
+typedef struct FbrProfilerZoneStats {
+    // ring of the last FBR_PROFILER_HISTORY_COUNT readings in milliseconds
+    float pHistory[FBR_PROFILER_HISTORY_COUNT];
+    uint32_t historyCount;
+    uint32_t historyIndex;
+} FbrProfilerZoneStats;
+
+typedef struct FbrProfiler {
+    // two queries per zone per frame slot
+    VkQueryPool queryPool;
+    // zones written in each slot, only those are read back
+    uint32_t pWrittenZones[FBR_PROFILER_FRAME_COUNT];
+    // zones of each slot recorded into the compute command buffer, masked with the compute family's valid bits
+    uint32_t pComputeZones[FBR_PROFILER_FRAME_COUNT];
+    uint32_t frameSlot;
+    uint64_t frameCount;
+    float timestampPeriod;
+    uint64_t graphicsTimestampMask;
+    uint64_t computeTimestampMask;
+    // device and trace clock sampled together each frame, zones are placed on the trace timeline from this
+    uint64_t calibrationDeviceTimestamp;
+    int64_t calibrationTraceTimestamp;
+    int64_t traceFrequency;
+    FbrProfilerZoneStats pZoneStats[FBR_PROFILER_ZONE_COUNT];
+    // zones read back by the last fbrBeginProfilerFrame, for anything that samples every frame
+    uint32_t collectedZones;
+    float pCollectedMs[FBR_PROFILER_ZONE_COUNT];
+} FbrProfiler;
+
+VkResult fbrCreateProfiler(const FbrVulkan *pVulkan, FbrProfiler **ppAllocProfiler);
+
+void fbrDestroyProfiler(const FbrVulkan *pVulkan, FbrProfiler *pProfiler);
+
+// Collects the slot recorded FBR_PROFILER_FRAME_COUNT frames ago without waiting and resets it for this frame.
+// Collected zones also go to the trace if one is open.
+void fbrBeginProfilerFrame(const FbrVulkan *pVulkan);
+
+// Each zone can be recorded once per frame, on any queue that supports timestamps.
+void fbrBeginProfilerZone(const FbrVulkan *pVulkan, VkCommandBuffer commandBuffer, FbrProfilerZone zone);
+
+void fbrEndProfilerZone(const FbrVulkan *pVulkan, VkCommandBuffer commandBuffer, FbrProfilerZone zone);
+
+void fbrGetProfilerZoneStats(const FbrProfiler *pProfiler, FbrProfilerZone zone, float *pMin, float *pAvg, float *pMax);
+
+const char *fbrGetProfilerZoneName(FbrProfilerZone zone);
+
+void fbrLogProfiler(const FbrVulkan *pVulkan);
+
+#endif //FABRIC_PROFILER_H
@@ -0,0 +1,139 @@
+#include "fbr_shader_bundle.h"
+#include "fbr_vulkan.h"
+#include "fbr_log.h"
+
+#include <string.h>
+
+#if !WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static VkResult mapFile(const char *pPath, FbrShaderBundle *pShaderBundle) {
+#if WIN32
+    pShaderBundle->file = CreateFileA(pPath,
+                                      GENERIC_READ,
+                                      FILE_SHARE_READ,
+                                      NULL,
+                                      OPEN_EXISTING,
+                                      FILE_ATTRIBUTE_NORMAL,
+                                      NULL);
+    if (pShaderBundle->file == INVALID_HANDLE_VALUE) {
+        FBR_LOG_MESSAGE("Shader bundle can't be opened!", pPath);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(pShaderBundle->file, &fileSize);
+    pShaderBundle->size = fileSize.QuadPart;
+
+    pShaderBundle->mapping = CreateFileMappingA(pShaderBundle->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (pShaderBundle->mapping == NULL) {
+        FBR_LOG_MESSAGE("Shader bundle can't be mapped!", pPath);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    pShaderBundle->pMapped = MapViewOfFile(pShaderBundle->mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    const int file = open(pPath, O_RDONLY);
+    if (file < 0) {
+        FBR_LOG_MESSAGE("Shader bundle can't be opened!", pPath);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    struct stat fileStat;
+    fstat(file, &fileStat);
+    pShaderBundle->size = fileStat.st_size;
+
+    void *pMapped = mmap(NULL, pShaderBundle->size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping keeps its own reference to the file
+    close(file);
+    pShaderBundle->pMapped = pMapped == MAP_FAILED ? NULL : pMapped;
+#endif
+    if (pShaderBundle->pMapped == NULL) {
+        FBR_LOG_MESSAGE("Shader bundle can't be mapped!", pPath);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    return FBR_SUCCESS;
+}
+
+static VkResult validateBundle(const FbrShaderBundle *pShaderBundle) {
+    if (pShaderBundle->size < sizeof(FbrShaderBundleHeader)) {
+        FBR_LOG_ERROR("Shader bundle truncated!");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    const FbrShaderBundleHeader *pHeader = pShaderBundle->pHeader;
+    if (pHeader->magic != FBR_SHADER_BUNDLE_MAGIC || pHeader->version != FBR_SHADER_BUNDLE_VERSION) {
+        FBR_LOG_MESSAGE("Shader bundle version mismatch!", pHeader->magic, pHeader->version);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    const size_t entriesEnd = sizeof(FbrShaderBundleHeader) + (size_t) pHeader->entryCount * sizeof(FbrShaderBundleEntry);
+    if (entriesEnd > pShaderBundle->size) {
+        FBR_LOG_ERROR("Shader bundle index truncated!");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    for (uint32_t i = 0; i < pHeader->entryCount; ++i) {
+        const FbrShaderBundleEntry *pEntry = &pShaderBundle->pEntries[i];
+        if ((size_t) pEntry->offset + pEntry->size > pShaderBundle->size ||
+            pEntry->offset % FBR_SHADER_BUNDLE_ALIGNMENT != 0 ||
+            pEntry->size % sizeof(uint32_t) != 0) {
+            FBR_LOG_MESSAGE("Shader bundle entry invalid!", i, pEntry->offset, pEntry->size);
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+    }
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrCreateShaderBundle(const char *pPath, FbrShaderBundle **ppAllocShaderBundle) {
+    *ppAllocShaderBundle = calloc(1, sizeof(FbrShaderBundle));
+    FbrShaderBundle *pShaderBundle = *ppAllocShaderBundle;
+
+    FBR_ACK(mapFile(pPath, pShaderBundle));
+
+    pShaderBundle->pHeader = (const FbrShaderBundleHeader *) pShaderBundle->pMapped;
+    pShaderBundle->pEntries = (const FbrShaderBundleEntry *) (pShaderBundle->pMapped + sizeof(FbrShaderBundleHeader));
+    FBR_ACK(validateBundle(pShaderBundle));
+
+    FBR_LOG_MESSAGE("Mapped shader bundle.", pPath, pShaderBundle->pHeader->entryCount);
+
+    return FBR_SUCCESS;
+}
+
+void fbrDestroyShaderBundle(FbrShaderBundle *pShaderBundle) {
+#if WIN32
+    if (pShaderBundle->pMapped != NULL)
+        UnmapViewOfFile(pShaderBundle->pMapped);
+    if (pShaderBundle->mapping != NULL)
+        CloseHandle(pShaderBundle->mapping);
+    if (pShaderBundle->file != NULL && pShaderBundle->file != INVALID_HANDLE_VALUE)
+        CloseHandle(pShaderBundle->file);
+#else
+    if (pShaderBundle->pMapped != NULL)
+        munmap((void *) pShaderBundle->pMapped, pShaderBundle->size);
+#endif
+    free(pShaderBundle);
+}
+
+VkResult fbrGetShaderCode(const FbrShaderBundle *pShaderBundle,
+                          const char *pName,
+                          const uint32_t **ppCode,
+                          size_t *pCodeSize) {
+    for (uint32_t i = 0; i < pShaderBundle->pHeader->entryCount; ++i) {
+        const FbrShaderBundleEntry *pEntry = &pShaderBundle->pEntries[i];
+        if (strncmp(pEntry->pName, pName, FBR_SHADER_BUNDLE_NAME_SIZE) != 0)
+            continue;
+        *ppCode = (const uint32_t *) (pShaderBundle->pMapped + pEntry->offset);
+        *pCodeSize = pEntry->size;
+        return FBR_SUCCESS;
+    }
+
+    FBR_LOG_MESSAGE("Shader not in bundle!", pName);
+    return VK_ERROR_UNKNOWN;
+}
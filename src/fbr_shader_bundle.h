@@ -0,0 +1,36 @@
+#ifndef FABRIC_SHADER_BUNDLE_H
+#define FABRIC_SHADER_BUNDLE_H
+
+#include "fbr_app.h"
+#include "fbr_shader_bundle_format.h"
+
+#if WIN32
+#include <windows.h>
+#endif
+
+// Packed at build time by tools/fbr_pack_shaders.c
+#define FBR_SHADER_BUNDLE_PATH "./shaders/shaders.pak"
+
+// The whole bundle stays mapped, shader code is handed to vulkan straight out of the mapping.
+typedef struct FbrShaderBundle {
+    const uint8_t *pMapped;
+    size_t size;
+    const FbrShaderBundleHeader *pHeader;
+    const FbrShaderBundleEntry *pEntries;
+#if WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} FbrShaderBundle;
+
+VkResult fbrCreateShaderBundle(const char *pPath, FbrShaderBundle **ppAllocShaderBundle);
+
+void fbrDestroyShaderBundle(FbrShaderBundle *pShaderBundle);
+
+// pName is the file name the shader was packed from, e.g. "vert.spv".
+VkResult fbrGetShaderCode(const FbrShaderBundle *pShaderBundle,
+                          const char *pName,
+                          const uint32_t **ppCode,
+                          size_t *pCodeSize);
+
+#endif //FABRIC_SHADER_BUNDLE_H
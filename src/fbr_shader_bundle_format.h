@@ -0,0 +1,28 @@
+#ifndef FABRIC_SHADER_BUNDLE_FORMAT_H
+#define FABRIC_SHADER_BUNDLE_FORMAT_H
+
+#include <stdint.h>
+
+// Shared with tools/fbr_pack_shaders.c so it must not pull in vulkan or glfw.
+
+#define FBR_SHADER_BUNDLE_MAGIC 0x4B505346
+#define FBR_SHADER_BUNDLE_VERSION 1
+#define FBR_SHADER_BUNDLE_NAME_SIZE 56
+// SPIR-V only needs 4 byte words, but keep every blob on its own 16 bytes
+#define FBR_SHADER_BUNDLE_ALIGNMENT 16
+
+// Layout is header, entryCount entries, then each shader's code at its aligned offset.
+typedef struct FbrShaderBundleHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+} FbrShaderBundleHeader;
+
+typedef struct FbrShaderBundleEntry {
+    char pName[FBR_SHADER_BUNDLE_NAME_SIZE];
+    uint32_t offset;
+    uint32_t size;
+} FbrShaderBundleEntry;
+
+#endif //FABRIC_SHADER_BUNDLE_FORMAT_H
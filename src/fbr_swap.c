@@ -2,9 +2,24 @@
 #include "fbr_vulkan.h"
 #include "fbr_log.h"
 #include "fbr_buffer.h"
+#include "fbr_texture.h"
+#include "fbr_trace.h"
+
+#include <math.h>
+#ifndef WIN32
+#include <time.h>
+#endif
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
 
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(const FbrVulkan *pVulkan)
 {
+    if (pVulkan->headless) {
+        return (VkSurfaceFormatKHR) {FBR_SWAP_HEADLESS_FORMAT, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+    }
+
     uint32_t formatCount;
     FBR_VK_CHECK(vkGetPhysicalDeviceSurfaceFormatsKHR(pVulkan->physicalDevice, pVulkan->surface, &formatCount, NULL));
     VkSurfaceFormatKHR formats[formatCount];
@@ -157,11 +172,12 @@ static FBR_RESULT createSwapChain(const FbrVulkan *pVulkan, FbrSwap *pSwap)
     }
 
     FBR_VK_CHECK(vkGetSwapchainImagesKHR(pVulkan->device, pSwap->swapChain, &swapCount, pSwap->pSwapImages));
+    pSwap->presentLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     for (int i = 0; i < FBR_SWAP_COUNT; ++i) {
         fbrTransitionImageLayoutImmediate(pVulkan,
                                           pSwap->pSwapImages[i],
-                                          VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                                          VK_IMAGE_LAYOUT_UNDEFINED, pSwap->presentLayout,
                                           VK_ACCESS_NONE, VK_ACCESS_NONE,
                                           VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
                                           VK_IMAGE_ASPECT_COLOR_BIT);
@@ -189,6 +205,38 @@ static FBR_RESULT createSwapChain(const FbrVulkan *pVulkan, FbrSwap *pSwap)
     return VK_SUCCESS;
 }
 
+static FBR_RESULT createOffscreenImages(const FbrVulkan *pVulkan, FbrSwap *pSwap)
+{
+    pSwap->format = FBR_SWAP_HEADLESS_FORMAT;
+    // transfer src so frames can be read back
+    pSwap->usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    // no swapchain to present to, finished frames wait ready to be read back
+    pSwap->presentLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    for (int i = 0; i < FBR_SWAP_COUNT; ++i) {
+        fbrCreateTexture(pVulkan,
+                         pSwap->format,
+                         pSwap->extent,
+                         pSwap->usage,
+                         VK_IMAGE_ASPECT_COLOR_BIT,
+                         false,
+                         &pSwap->pOffscreenTextures[i]);
+        pSwap->pSwapImages[i] = pSwap->pOffscreenTextures[i]->image;
+        pSwap->pSwapImageViews[i] = pSwap->pOffscreenTextures[i]->imageView;
+
+        fbrTransitionImageLayoutImmediate(pVulkan,
+                                          pSwap->pSwapImages[i],
+                                          VK_IMAGE_LAYOUT_UNDEFINED, pSwap->presentLayout,
+                                          VK_ACCESS_NONE, VK_ACCESS_NONE,
+                                          VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                          VK_IMAGE_ASPECT_COLOR_BIT);
+    }
+
+    FBR_LOG_MESSAGE("Created offscreen swap.", pSwap->format, pSwap->extent.width, pSwap->extent.height);
+
+    return VK_SUCCESS;
+}
+
 static VkResult createSyncObjects(const FbrVulkan *pVulkan, FbrSwap *pSwap)
 { // todo move to swap sync objects?
     const VkSemaphoreCreateInfo swapchainSemaphoreCreateInfo = {
@@ -205,9 +253,24 @@ void fbrCreateSwap(const FbrVulkan *pVulkan,
     *ppAllocSwap = calloc(1, sizeof(FbrSwap));
     FbrSwap *pSwap = *ppAllocSwap;
     pSwap->extent = extent;
+    pSwap->headless = pVulkan->headless;
 
-    createSwapChain(pVulkan, pSwap);
+    if (pSwap->headless) {
+        createOffscreenImages(pVulkan, pSwap);
+    } else {
+        createSwapChain(pVulkan, pSwap);
+    }
     createSyncObjects(pVulkan, pSwap);
+
+    pSwap->pacing.traceFrequency = fbrGetTraceFrequency();
+#ifdef WIN32
+    if (pVulkan->presentWaitSupported) {
+        // Sleep is only as fine as the scheduler tick, far too coarse to hit a vblank
+        pSwap->pacing.timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (pSwap->pacing.timer == NULL)
+            pSwap->pacing.timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+    }
+#endif
 }
 
 void fbrDestroySwap(const FbrVulkan *pVulkan, FbrSwap *pSwap)
@@ -215,5 +278,164 @@ void fbrDestroySwap(const FbrVulkan *pVulkan, FbrSwap *pSwap)
     vkDestroySemaphore(pVulkan->device, pSwap->renderCompleteSemaphore, NULL);
     vkDestroySemaphore(pVulkan->device, pSwap->acquireCompleteSemaphore, NULL);
 
+    if (pSwap->headless) {
+        for (int i = 0; i < FBR_SWAP_COUNT; ++i) {
+            fbrDestroyTexture(pVulkan, pSwap->pOffscreenTextures[i]);
+        }
+    }
+
+#ifdef WIN32
+    if (pSwap->pacing.timer != NULL)
+        CloseHandle(pSwap->pacing.timer);
+#endif
+
     free(pSwap);
 }
+
+VkResult fbrAcquireSwap(const FbrVulkan *pVulkan, FbrSwap *pSwap, uint32_t *pSwapIndex)
+{
+    if (!pSwap->headless) {
+        return vkAcquireNextImageKHR(pVulkan->device,
+                                     pSwap->swapChain,
+                                     UINT64_MAX,
+                                     pSwap->acquireCompleteSemaphore,
+                                     VK_NULL_HANDLE,
+                                     pSwapIndex);
+    }
+
+    // every loop waits on its frame before the next acquire, so the image is never still in use
+    pSwap->offscreenIndex = (pSwap->offscreenIndex + 1) % FBR_SWAP_COUNT;
+    *pSwapIndex = pSwap->offscreenIndex;
+    const VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &pSwap->acquireCompleteSemaphore,
+    };
+    return vkQueueSubmit(pVulkan->graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+}
+
+VkResult fbrPresentSwap(const FbrVulkan *pVulkan, FbrSwap *pSwap, VkQueue queue, uint32_t swapIndex)
+{
+    if (!pSwap->headless) {
+        const uint64_t presentID = pSwap->pacing.presentID + 1;
+        const VkPresentIdKHR presentId = {
+                .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+                .swapchainCount = 1,
+                .pPresentIds = &presentID,
+        };
+        const VkPresentInfoKHR presentInfo = {
+                .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+                .pNext = pVulkan->presentWaitSupported ? &presentId : NULL,
+                .waitSemaphoreCount = 1,
+                .pWaitSemaphores = &pSwap->renderCompleteSemaphore,
+                .swapchainCount = 1,
+                .pSwapchains = &pSwap->swapChain,
+                .pImageIndices = &swapIndex,
+        };
+        const VkResult result = vkQueuePresentKHR(queue, &presentInfo);
+        if (pVulkan->presentWaitSupported && (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR))
+            pSwap->pacing.presentID = presentID;
+        return result;
+    }
+
+    const VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    const VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &pSwap->renderCompleteSemaphore,
+            .pWaitDstStageMask = &waitDstStageMask,
+    };
+    return vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+}
+
+static void sleepUntil(const FbrSwapPacing *pPacing, int64_t timestamp)
+{
+    const int64_t remaining = timestamp - fbrGetTraceTimestamp();
+    if (remaining <= 0)
+        return;
+#ifdef WIN32
+    if (pPacing->timer != NULL) {
+        // relative due time in 100ns units
+        const LARGE_INTEGER dueTime = {.QuadPart = -(remaining * 10000000 / pPacing->traceFrequency)};
+        if (SetWaitableTimer(pPacing->timer, &dueTime, 0, NULL, NULL, FALSE)) {
+            WaitForSingleObject(pPacing->timer, INFINITE);
+            return;
+        }
+    }
+    Sleep((DWORD) (remaining * 1000 / pPacing->traceFrequency));
+#else
+    const int64_t nanoseconds = remaining * 1000000000 / pPacing->traceFrequency;
+    const struct timespec duration = {.tv_sec = nanoseconds / 1000000000, .tv_nsec = nanoseconds % 1000000000};
+    nanosleep(&duration, NULL);
+#endif
+}
+
+static double smooth(double average, double sample)
+{
+    return average == 0 ? sample : average + (sample - average) * FBR_SWAP_PACING_SMOOTHING;
+}
+
+void fbrBeginSwapFrame(const FbrVulkan *pVulkan, FbrSwap *pSwap)
+{
+    FbrSwapPacing *pPacing = &pSwap->pacing;
+    if (!pVulkan->presentWaitSupported || pPacing->disabled || pPacing->presentID == 0) {
+        pPacing->frameStartTimestamp = fbrGetTraceTimestamp();
+        return;
+    }
+
+    fbrTraceBegin("present wait");
+    const VkResult result = pVulkan->functions.waitForPresent(pVulkan->device,
+                                                              pSwap->swapChain,
+                                                              pPacing->presentID,
+                                                              FBR_SWAP_PRESENT_WAIT_TIMEOUT_NS);
+    fbrTraceEnd("present wait");
+    if (result != VK_SUCCESS && result != VK_TIMEOUT && result != VK_SUBOPTIMAL_KHR) {
+        FBR_LOG_MESSAGE("Present wait failed, frames won't be paced.", result);
+        pPacing->disabled = true;
+        pPacing->frameStartTimestamp = fbrGetTraceTimestamp();
+        return;
+    }
+
+    if (result != VK_TIMEOUT) {
+        const int64_t displayedTimestamp = fbrGetTraceTimestamp();
+        fbrTraceInstant(FBR_TRACE_CATEGORY_CPU, "present displayed", pPacing->presentID);
+        // back to back presents only, and skip missed vblanks which would read as a longer period
+        if (pPacing->displayedPresentID != 0 && pPacing->presentID == pPacing->displayedPresentID + 1) {
+            const double interval = (double) (displayedTimestamp - pPacing->displayedTimestamp);
+            if (pPacing->refreshPeriod == 0 || interval < pPacing->refreshPeriod * 1.5)
+                pPacing->refreshPeriod = smooth(pPacing->refreshPeriod, interval);
+        }
+        pPacing->displayedPresentID = pPacing->presentID;
+        pPacing->displayedTimestamp = displayedTimestamp;
+
+        if (pPacing->refreshPeriod > 0 && pPacing->frameDuration > 0) {
+            const double margin = FBR_SWAP_PACING_MARGIN_MS * (double) pPacing->traceFrequency / 1000.0;
+            const int64_t startTimestamp = pPacing->displayedTimestamp +
+                                           (int64_t) (pPacing->refreshPeriod - pPacing->frameDuration - margin);
+            fbrTraceBegin("pacing sleep");
+            sleepUntil(pPacing, startTimestamp);
+            fbrTraceEnd("pacing sleep");
+        }
+    }
+
+    pPacing->frameStartTimestamp = fbrGetTraceTimestamp();
+}
+
+int64_t fbrGetSwapDisplayTimestamp(const FbrSwap *pSwap)
+{
+    const FbrSwapPacing *pPacing = &pSwap->pacing;
+    const int64_t timestamp = fbrGetTraceTimestamp();
+    const int64_t readyTimestamp = pPacing->frameStartTimestamp + (int64_t) pPacing->frameDuration;
+    if (pPacing->displayedTimestamp == 0 || pPacing->refreshPeriod == 0)
+        return readyTimestamp > timestamp ? readyTimestamp : timestamp;
+
+    // first vblank after the frame is ready
+    const double vblanks = ceil((double) (readyTimestamp - pPacing->displayedTimestamp) / pPacing->refreshPeriod);
+    return pPacing->displayedTimestamp + (int64_t) ((vblanks < 1 ? 1 : vblanks) * pPacing->refreshPeriod);
+}
+
+void fbrEndSwapFrame(FbrSwap *pSwap)
+{
+    FbrSwapPacing *pPacing = &pSwap->pacing;
+    pPacing->frameDuration = smooth(pPacing->frameDuration, (double) (fbrGetTraceTimestamp() - pPacing->frameStartTimestamp));
+}
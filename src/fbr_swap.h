@@ -4,18 +4,56 @@
 #include "fbr_app.h"
 #include "fbr_framebuffer.h"
 
+#ifdef WIN32
+#include <windows.h>
+#endif
+
 // Want to always force 2 for minimal latency
 #define FBR_SWAP_COUNT 2
+// No surface to ask when headless, nodes pick the same format for their framebuffers
+#define FBR_SWAP_HEADLESS_FORMAT VK_FORMAT_B8G8R8A8_SRGB
+// Frames start this much earlier than the estimate says they need to, absorbs frame time jitter
+#define FBR_SWAP_PACING_MARGIN_MS 1.5
+// weight of the newest sample in the pacing running averages
+#define FBR_SWAP_PACING_SMOOTHING 0.1
+#define FBR_SWAP_PRESENT_WAIT_TIMEOUT_NS 100000000
+
+// Only used with presentWaitSupported, otherwise frames are throttled by the main timeline alone
+typedef struct FbrSwapPacing {
+    // id given to the last present, 0 before the first
+    uint64_t presentID;
+    // last present known to be on screen, and the trace time it was seen
+    uint64_t displayedPresentID;
+    int64_t displayedTimestamp;
+    // running averages in trace ticks, 0 until measured
+    double refreshPeriod;
+    double frameDuration;
+    int64_t frameStartTimestamp;
+    int64_t traceFrequency;
+    // set if present wait ever fails, falls back to unpaced
+    bool disabled;
+#ifdef WIN32
+    HANDLE timer;
+#endif
+} FbrSwapPacing;
 
 typedef struct FbrSwap {
+    bool headless;
+    // headless only, cycled in place of vkAcquireNextImageKHR
+    uint32_t offscreenIndex;
+    FbrTexture *pOffscreenTextures[FBR_SWAP_COUNT];
+
     VkSwapchainKHR swapChain;
     VkFormat format;
     VkImageUsageFlags usage;
+    // layout images are left in between frames, PRESENT_SRC_KHR is only valid with VK_KHR_swapchain
+    VkImageLayout presentLayout;
     VkExtent2D extent;
     VkSemaphore acquireCompleteSemaphore;
     VkSemaphore renderCompleteSemaphore;
     VkImage pSwapImages[FBR_SWAP_COUNT];
     VkImageView pSwapImageViews[FBR_SWAP_COUNT];
+    FbrSwapPacing pacing;
 } FbrSwap;
 
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(const FbrVulkan *pVulkan);
@@ -26,4 +64,21 @@ void fbrCreateSwap(const FbrVulkan *pVulkan,
 
 void fbrDestroySwap(const FbrVulkan *pVulkan, FbrSwap *pSwap);
 
+// Headless signals acquireCompleteSemaphore with an empty submit so the composite submits wait the same way.
+VkResult fbrAcquireSwap(const FbrVulkan *pVulkan, FbrSwap *pSwap, uint32_t *pSwapIndex);
+
+// Headless consumes renderCompleteSemaphore with an empty submit on the same queue instead of presenting.
+VkResult fbrPresentSwap(const FbrVulkan *pVulkan, FbrSwap *pSwap, VkQueue queue, uint32_t swapIndex);
+
+// Call first thing in a frame. With present wait, blocks until the last present is on screen and then sleeps
+// so the frame finishes just ahead of the following vblank, input and poses sampled after are that much fresher.
+void fbrBeginSwapFrame(const FbrVulkan *pVulkan, FbrSwap *pSwap);
+
+// Trace time the frame begun with fbrBeginSwapFrame is expected on screen. Without present wait it's only
+// the frame start plus the measured frame duration.
+int64_t fbrGetSwapDisplayTimestamp(const FbrSwap *pSwap);
+
+// Call once the frame's gpu work is complete, measures how long frames take to be ready.
+void fbrEndSwapFrame(FbrSwap *pSwap);
+
 #endif //FABRIC_SWAP_H
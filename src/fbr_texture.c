@@ -1,6 +1,8 @@
 #include "fbr_texture.h"
 #include "fbr_buffer.h"
 #include "fbr_vulkan.h"
+#include "fbr_upload.h"
+#include "fbr_asset_loader.h"
 #include "fbr_log.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -14,37 +16,6 @@
 #include <vulkan/vulkan_xlib.h>
 #endif
 
-static VkResult copyBufferToImage(const FbrVulkan *pVulkan,
-                       VkBuffer buffer,
-                       VkImage image,
-                       VkExtent2D extent) {
-    VkCommandBuffer commandBuffer;
-    FBR_ACK(fbrBeginImmediateCommandBuffer(pVulkan, &commandBuffer));
-
-    VkBufferImageCopy region = {
-            .bufferOffset = 0,
-            .bufferRowLength = 0,
-            .bufferImageHeight = 0,
-            .imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .imageSubresource.mipLevel = 0,
-            .imageSubresource.baseArrayLayer = 0,
-            .imageSubresource.layerCount = 1,
-            .imageOffset = {0, 0, 0},
-            .imageExtent = {extent.width, extent.height, 1},
-    };
-
-    vkCmdCopyBufferToImage(
-            commandBuffer,
-            buffer,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region
-    );
-
-    FBR_ACK(fbrEndImmediateCommandBuffer(pVulkan, &commandBuffer));
-}
-
 static void importTexture(const FbrVulkan *pVulkan,
                           VkExtent2D extent,
                           VkFormat format,
@@ -106,9 +77,9 @@ static void importTexture(const FbrVulkan *pVulkan,
             .memoryTypeIndex = memTypeIndex,
             .pNext = &importMemoryInfo
     };
-    FBR_VK_CHECK(vkAllocateMemory(pVulkan->device, &allocInfo, NULL, &pTexture->deviceMemory));
+    FBR_VK_CHECK(fbrAllocateDedicatedMemory(pVulkan, &allocInfo, &pTexture->allocation));
 
-    FBR_VK_CHECK(vkBindImageMemory(pVulkan->device, pTexture->image, pTexture->deviceMemory, 0));
+    FBR_VK_CHECK(vkBindImageMemory(pVulkan->device, pTexture->image, pTexture->allocation.memory, 0));
 
     pTexture->externalMemory = externalMemory;
     pTexture->extent = extent;
@@ -192,15 +163,15 @@ static void createExternalTexture(const FbrVulkan *pVulkan,
             .memoryTypeIndex = memTypeIndex,
             .pNext = &exportAllocInfo
     };
-    FBR_VK_CHECK(vkAllocateMemory(pVulkan->device, &allocInfo, NULL, &pTexture->deviceMemory));
+    FBR_VK_CHECK(fbrAllocateDedicatedMemory(pVulkan, &allocInfo, &pTexture->allocation));
 
-    FBR_VK_CHECK(vkBindImageMemory(pVulkan->device, pTexture->image, pTexture->deviceMemory, 0));
+    FBR_VK_CHECK(vkBindImageMemory(pVulkan->device, pTexture->image, pTexture->allocation.memory, 0));
 
 #if WIN32
     VkMemoryGetWin32HandleInfoKHR memoryInfo = {
             .sType = VK_STRUCTURE_TYPE_MEMORY_GET_WIN32_HANDLE_INFO_KHR,
             .pNext = NULL,
-            .memory = pTexture->deviceMemory,
+            .memory = pTexture->allocation.memory,
             .handleType = externalHandleType
     };
 
@@ -242,22 +213,7 @@ static void createTexture(const FbrVulkan *pVulkan,
     };
     FBR_VK_CHECK(vkCreateImage(pVulkan->device, &imageCreateInfo, FBR_ALLOCATOR, &pTexture->image));
 
-    VkMemoryRequirements memRequirements = {};
-    uint32_t memTypeIndex;
-    FBR_VK_CHECK(fbrImageMemoryTypeFromProperties(pVulkan,
-                                                  pTexture->image,
-                                                  properties,
-                                                  &memRequirements,
-                                                  &memTypeIndex));
-
-    VkMemoryAllocateInfo allocInfo = {
-            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-            .allocationSize = memRequirements.size,
-            .memoryTypeIndex = memTypeIndex,
-    };
-    FBR_VK_CHECK(vkAllocateMemory(pVulkan->device, &allocInfo, NULL, &pTexture->deviceMemory));
-
-    vkBindImageMemory(pVulkan->device, pTexture->image, pTexture->deviceMemory, 0);
+    FBR_VK_CHECK(fbrAllocateBindImageMemory(pVulkan, pTexture->image, properties, &pTexture->allocation));
 
     pTexture->extent = extent;
 }
@@ -284,33 +240,76 @@ static void createTextureView(const FbrVulkan *pVulkan, VkFormat format, VkImage
     }
 }
 
+// Batched, goes out with the next fbrSubmitUploads. Frames can sample it from then until the real pixels replace it.
+static void clearToPlaceholder(const FbrVulkan *pVulkan, FbrTexture *pTexture) {
+    VkCommandBuffer commandBuffer;
+    FBR_VK_CHECK(fbrGetUploadGraphicsCommandBuffer(pVulkan, &commandBuffer, &pTexture->uploadToken));
+
+    const VkImageMemoryBarrier transferDstBarrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_NONE,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = pTexture->image,
+            FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+    };
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, NULL,
+                         0, NULL,
+                         1, &transferDstBarrier);
+
+    const VkClearColorValue clearColor = FBR_TEXTURE_PLACEHOLDER_COLOR;
+    vkCmdClearColorImage(commandBuffer,
+                         pTexture->image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         &clearColor,
+                         1,
+                         &transferDstBarrier.subresourceRange);
+
+    const VkImageMemoryBarrier readBarrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = pTexture->image,
+            FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+    };
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0,
+                         0, NULL,
+                         0, NULL,
+                         1, &readBarrier);
+}
+
 static void createTextureFromFile(const FbrVulkan *pVulkan, FbrTexture *pTexture, char const *filename, const bool external) {
-    int texChannels;
-    int width;
-    int height;
-    stbi_uc *pixels = stbi_load(filename, &width, &height, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageBufferSize = width * height * 4;
+    int texChannels = 0;
+    int width = 0;
+    int height = 0;
+    // header only, the asset loader decodes the pixels
+    const bool validHeader = stbi_info(filename, &width, &height, &texChannels);
 
     FBR_LOG_MESSAGE("Loading pTestTexture from file.");
     FBR_LOG_DEBUG(filename, width, height, texChannels);
 
-    if (!pixels) {
+    if (!validHeader) {
         FBR_LOG_ERROR("Failed to load pTestTexture image!");
+        width = 1;
+        height = 1;
     }
 
     VkExtent2D extent = {width, height};
 
-    // TODO this staging buffer needs to be recycled
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    fbrCreateStagingBuffer(pVulkan,
-                           pixels,
-                           &stagingBuffer,
-                           &stagingBufferMemory,
-                           imageBufferSize);
-
-    stbi_image_free(pixels);
-
     if (external) {
         createExternalTexture(pVulkan,
                               extent,
@@ -329,22 +328,10 @@ static void createTextureFromFile(const FbrVulkan *pVulkan, FbrTexture *pTexture
                       pTexture);
     }
 
-    fbrTransitionImageLayoutImmediate(pVulkan,
-                                      pTexture->image,
-                                      VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                      VK_ACCESS_NONE, VK_ACCESS_MEMORY_WRITE_BIT,
-                                      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                      VK_IMAGE_ASPECT_COLOR_BIT);
-    copyBufferToImage(pVulkan, stagingBuffer, pTexture->image, extent);
-    fbrTransitionImageLayoutImmediate(pVulkan,
-                                      pTexture->image,
-                                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                      VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-                                      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                      VK_IMAGE_ASPECT_COLOR_BIT);
-
-    vkDestroyBuffer(pVulkan->device, stagingBuffer, NULL);
-    vkFreeMemory(pVulkan->device, stagingBufferMemory, NULL);
+    clearToPlaceholder(pVulkan, pTexture);
+
+    if (validHeader)
+        fbrQueueTextureDecode(pVulkan, pTexture, filename);
 }
 
 void fbrCreateTextureFromImage(const FbrVulkan *pVulkan,
@@ -419,11 +406,18 @@ void fbrCreateTexture(const FbrVulkan *pVulkan,
 }
 
 void fbrDestroyTexture(const FbrVulkan *pVulkan, FbrTexture *pTexture) {
+    // a worker may still be writing into its job
+    if (pTexture->loading)
+        fbrFinishAssetLoads(pVulkan);
+    // the placeholder clear or the pixels may still be recording, submits them first if so
+    if (pTexture->uploadToken != 0)
+        FBR_VK_CHECK(fbrWaitUpload(pVulkan, pTexture->uploadToken));
+
     if (pTexture->externalMemory != NULL)
         CloseHandle(pTexture->externalMemory);
 
     vkDestroyImage(pVulkan->device, pTexture->image, NULL);
-    vkFreeMemory(pVulkan->device, pTexture->deviceMemory, NULL);
+    fbrFreeMemory(pVulkan, &pTexture->allocation);
     vkDestroyImageView(pVulkan->device, pTexture->imageView, NULL);
     free(pTexture);
 }
\ No newline at end of file
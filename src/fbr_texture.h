@@ -2,6 +2,8 @@
 #define FABRIC_TEXTURE_H
 
 #include "fbr_app.h"
+#include "fbr_upload.h"
+#include "fbr_memory.h"
 
 #ifdef WIN32
 #include <windows.h>
@@ -11,11 +13,16 @@
 #include <X11/Xlib.h>
 #endif
 
+#define FBR_TEXTURE_PLACEHOLDER_COLOR {{0.5f, 0.5f, 0.5f, 1.0f}}
+
 typedef struct FbrTexture {
     VkImage image;
     VkImageView imageView;
-    VkDeviceMemory deviceMemory;
+    FbrAllocation allocation;
     VkExtent2D extent;
+    FbrUploadToken uploadToken;
+    // pixels are still being decoded, sampling it shows the placeholder
+    bool loading;
 #ifdef WIN32
     HANDLE externalMemory;
 #endif
@@ -27,6 +34,8 @@ void fbrCreateTextureFromImage(const FbrVulkan *pVulkan,
                                VkImage image,
                                FbrTexture **ppAllocTexture);
 
+// Returns once the image exists and is cleared to FBR_TEXTURE_PLACEHOLDER_COLOR, the asset loader decodes and
+// uploads the file's pixels behind it.
 void fbrCreateTextureFromFile(const FbrVulkan *pVulkan,
                               bool external,
                               char const *filename,
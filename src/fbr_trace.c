@@ -0,0 +1,276 @@
+#include "fbr_trace.h"
+#include "fbr_ipc.h"
+#include "fbr_log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#endif
+
+static const char *pCategoryNames[FBR_TRACE_CATEGORY_COUNT] = {
+        [FBR_TRACE_CATEGORY_CPU] = "cpu",
+        [FBR_TRACE_CATEGORY_GPU] = "gpu",
+        [FBR_TRACE_CATEGORY_IPC] = "ipc",
+        [FBR_TRACE_CATEGORY_SEMAPHORE] = "semaphore",
+};
+
+// Every write site in a process goes to the one trace it opened, NULL until then
+static FbrTraceBuffer *pTraceBuffer;
+
+static uint32_t getProcessID() {
+#ifdef WIN32
+    return GetCurrentProcessId();
+#else
+    return (uint32_t) getpid();
+#endif
+}
+
+static uint32_t getThreadID() {
+#ifdef WIN32
+    return GetCurrentThreadId();
+#else
+    return (uint32_t) (uintptr_t) pthread_self();
+#endif
+}
+
+int64_t fbrGetTraceFrequency() {
+#ifdef WIN32
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return frequency.QuadPart;
+#else
+    return 1000000000;
+#endif
+}
+
+int64_t fbrGetTraceTimestamp() {
+#ifdef WIN32
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+#else
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (int64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+static void writeEvent(FbrTracePhase phase,
+                       FbrTraceCategory category,
+                       const char *pName,
+                       uint32_t threadID,
+                       int64_t timestamp,
+                       int64_t duration,
+                       uint64_t value) {
+    FbrTraceBuffer *pBuffer = pTraceBuffer;
+    if (pBuffer == NULL)
+        return;
+
+    const uint64_t index = __atomic_fetch_add(&pBuffer->writeCount, 1, __ATOMIC_RELAXED);
+    FbrTraceEvent *pEvent = &pBuffer->pEvents[index % pBuffer->capacity];
+    // invalidate first so a reader never pairs the old sequence with new data
+    __atomic_store_n(&pEvent->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    pEvent->timestamp = timestamp;
+    pEvent->duration = duration;
+    pEvent->value = value;
+    pEvent->processID = getProcessID();
+    pEvent->threadID = threadID;
+    pEvent->phase = phase;
+    pEvent->category = category;
+    strncpy(pEvent->pName, pName, FBR_TRACE_NAME_SIZE - 1);
+    pEvent->pName[FBR_TRACE_NAME_SIZE - 1] = '\0';
+
+    __atomic_store_n(&pEvent->sequence, (uint32_t) (index + 1), __ATOMIC_RELEASE);
+}
+
+static void registerProcess(FbrTraceBuffer *pBuffer, const char *pName) {
+    const uint32_t index = __atomic_fetch_add(&pBuffer->processCount, 1, __ATOMIC_RELAXED);
+    if (index >= FBR_TRACE_MAX_PROCESS_COUNT)
+        return;
+
+    FbrTraceProcess *pProcess = &pBuffer->pProcesses[index];
+    pProcess->processID = getProcessID();
+    strncpy(pProcess->pName, pName, FBR_TRACE_NAME_SIZE - 1);
+    pProcess->pName[FBR_TRACE_NAME_SIZE - 1] = '\0';
+    __atomic_store_n(&pProcess->ready, 1, __ATOMIC_RELEASE);
+}
+
+int fbrCreateTrace(FbrTrace **ppAllocTrace) {
+    *ppAllocTrace = calloc(1, sizeof(FbrTrace));
+    FbrTrace *pTrace = *ppAllocTrace;
+    pTrace->isProducer = true;
+
+    if (fbrCreateNamedIPCBuffer(&pTrace->pIPCBuffer, FBR_TRACE_SHARED_MEMORY_NAME, sizeof(FbrTraceBuffer)) != 0) {
+        FBR_LOG_ERROR("Failed to create trace buffer!");
+        return 1;
+    }
+
+    FbrTraceBuffer *pBuffer = pTrace->pIPCBuffer->pBuffer;
+    pBuffer->magic = FBR_TRACE_MAGIC;
+    pBuffer->capacity = FBR_TRACE_EVENT_CAPACITY;
+    pBuffer->frequency = fbrGetTraceFrequency();
+    pBuffer->baseTimestamp = fbrGetTraceTimestamp();
+    pBuffer->writeCount = 0;
+    pBuffer->processCount = 0;
+    memset(pBuffer->pProcesses, 0, sizeof(pBuffer->pProcesses));
+    pTraceBuffer = pBuffer;
+
+    registerProcess(pBuffer, "compositor");
+
+    return 0;
+}
+
+int fbrImportTrace(FbrTrace **ppAllocTrace) {
+    *ppAllocTrace = calloc(1, sizeof(FbrTrace));
+    FbrTrace *pTrace = *ppAllocTrace;
+    pTrace->isProducer = false;
+
+    if (fbrImportNamedIPCBuffer(&pTrace->pIPCBuffer, FBR_TRACE_SHARED_MEMORY_NAME, sizeof(FbrTraceBuffer)) != 0) {
+        FBR_LOG_ERROR("Failed to import trace buffer!");
+        return 1;
+    }
+
+    FbrTraceBuffer *pBuffer = pTrace->pIPCBuffer->pBuffer;
+    if (pBuffer->magic != FBR_TRACE_MAGIC || pBuffer->capacity != FBR_TRACE_EVENT_CAPACITY) {
+        FBR_LOG_ERROR("Trace buffer layout mismatch!");
+        return 1;
+    }
+    pTraceBuffer = pBuffer;
+
+    registerProcess(pBuffer, "node");
+
+    return 0;
+}
+
+void fbrDestroyTrace(FbrTrace *pTrace) {
+    if (pTrace->pIPCBuffer != NULL && pTrace->pIPCBuffer->pBuffer != NULL) {
+        if (pTrace->isProducer)
+            fbrExportTrace(FBR_TRACE_EXPORT_PATH);
+        if (pTraceBuffer == pTrace->pIPCBuffer->pBuffer)
+            pTraceBuffer = NULL;
+        fbrDestroyIPCBuffer(pTrace->pIPCBuffer);
+    }
+    free(pTrace);
+}
+
+void fbrWriteJSONString(FILE *file, const char *pString) {
+    fputc('"', file);
+    for (const char *c = pString; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', file);
+        if ((unsigned char) *c >= 0x20)
+            fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+static void writeJSONMetadata(FILE *file, const char *pKind, uint32_t processID, uint32_t threadID, const char *pName) {
+    fprintf(file, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":",
+            pKind,
+            processID,
+            threadID);
+    fbrWriteJSONString(file, pName);
+    fputs("}}", file);
+}
+
+// Seqlock read, false if the event is still being written or was overwritten before or during the copy
+static bool copyEvent(const FbrTraceBuffer *pBuffer, uint64_t index, FbrTraceEvent *pEvent) {
+    const FbrTraceEvent *pSource = &pBuffer->pEvents[index % pBuffer->capacity];
+    const uint32_t sequence = (uint32_t) (index + 1);
+    if (__atomic_load_n(&pSource->sequence, __ATOMIC_ACQUIRE) != sequence)
+        return false;
+
+    memcpy(pEvent, pSource, sizeof(FbrTraceEvent));
+    // a writer starting on the slot during the copy has cleared the sequence by the time its data lands
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&pSource->sequence, __ATOMIC_RELAXED) != sequence)
+        return false;
+
+    return true;
+}
+
+void fbrExportTrace(const char *pPath) {
+    const FbrTraceBuffer *pBuffer = pTraceBuffer;
+    if (pBuffer == NULL)
+        return;
+
+    FILE *file = fopen(pPath, "w");
+    if (file == NULL) {
+        FBR_LOG_MESSAGE("Can't open trace for writing!", pPath);
+        return;
+    }
+
+    const uint64_t writeCount = __atomic_load_n(&pBuffer->writeCount, __ATOMIC_ACQUIRE);
+    const uint64_t firstIndex = writeCount > pBuffer->capacity ? writeCount - pBuffer->capacity : 0;
+    // Chrome trace timestamps are microseconds
+    const double ticksToMicroseconds = 1000000.0 / (double) pBuffer->frequency;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+
+    // names first, the events that once carried them may have been overwritten
+    const uint32_t processCount = __atomic_load_n(&pBuffer->processCount, __ATOMIC_RELAXED);
+    uint32_t namedCount = 0;
+    for (uint32_t i = 0; i < processCount && i < FBR_TRACE_MAX_PROCESS_COUNT; ++i) {
+        const FbrTraceProcess *pProcess = &pBuffer->pProcesses[i];
+        if (__atomic_load_n(&pProcess->ready, __ATOMIC_ACQUIRE) == 0)
+            continue;
+        if (namedCount++ > 0)
+            fputs(",\n", file);
+        writeJSONMetadata(file, "process_name", pProcess->processID, 0, pProcess->pName);
+        fputs(",\n", file);
+        writeJSONMetadata(file, "thread_name", pProcess->processID, FBR_TRACE_GPU_THREAD_ID, "gpu");
+    }
+
+    uint64_t exportedCount = 0;
+    for (uint64_t index = firstIndex; index < writeCount; ++index) {
+        FbrTraceEvent event;
+        if (!copyEvent(pBuffer, index, &event))
+            continue;
+        const FbrTraceEvent *pEvent = &event;
+
+        if (exportedCount++ > 0 || namedCount > 0)
+            fputs(",\n", file);
+
+        fputs("{\"name\":", file);
+        fbrWriteJSONString(file, pEvent->pName);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u",
+                pEvent->category < FBR_TRACE_CATEGORY_COUNT ? pCategoryNames[pEvent->category] : "unknown",
+                pEvent->phase,
+                (double) (pEvent->timestamp - pBuffer->baseTimestamp) * ticksToMicroseconds,
+                pEvent->processID,
+                pEvent->threadID);
+        if (pEvent->phase == FBR_TRACE_PHASE_COMPLETE)
+            fprintf(file, ",\"dur\":%.3f", (double) pEvent->duration * ticksToMicroseconds);
+        if (pEvent->phase == FBR_TRACE_PHASE_INSTANT)
+            fprintf(file, ",\"s\":\"p\",\"args\":{\"value\":%llu}", (unsigned long long) pEvent->value);
+        fputs("}", file);
+    }
+    fputs("\n]}\n", file);
+    fclose(file);
+
+    FBR_LOG_MESSAGE("Exported trace.", pPath, exportedCount);
+}
+
+void fbrTraceBegin(const char *pName) {
+    writeEvent(FBR_TRACE_PHASE_BEGIN, FBR_TRACE_CATEGORY_CPU, pName, getThreadID(), fbrGetTraceTimestamp(), 0, 0);
+}
+
+void fbrTraceEnd(const char *pName) {
+    writeEvent(FBR_TRACE_PHASE_END, FBR_TRACE_CATEGORY_CPU, pName, getThreadID(), fbrGetTraceTimestamp(), 0, 0);
+}
+
+void fbrTraceInstant(FbrTraceCategory category, const char *pName, uint64_t value) {
+    writeEvent(FBR_TRACE_PHASE_INSTANT, category, pName, getThreadID(), fbrGetTraceTimestamp(), 0, value);
+}
+
+void fbrTraceComplete(FbrTraceCategory category, const char *pName, uint32_t threadID, int64_t timestamp, int64_t duration) {
+    writeEvent(FBR_TRACE_PHASE_COMPLETE, category, pName, threadID, timestamp, duration, 0);
+}
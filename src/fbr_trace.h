@@ -0,0 +1,105 @@
+#ifndef FABRIC_TRACE_H
+#define FABRIC_TRACE_H
+
+#include "fbr_app.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Compositor creates the buffer before spawning nodes, nodes open it by name so both write onto one timeline.
+#define FBR_TRACE_SHARED_MEMORY_NAME "FbrTraceBuffer"
+#define FBR_TRACE_MAGIC 0x43525446
+// oldest events are overwritten once full, at 64 bytes each this is 4mb
+#define FBR_TRACE_EVENT_CAPACITY 65536
+#define FBR_TRACE_NAME_SIZE 24
+// Chrome trace JSON, open in chrome://tracing or ui.perfetto.dev
+#define FBR_TRACE_EXPORT_PATH "./fabric_trace.json"
+// GPU zones have no CPU thread, they go on their own track in each process
+#define FBR_TRACE_GPU_THREAD_ID 0xFFFFFFFF
+// processes past this still trace but export unnamed
+#define FBR_TRACE_MAX_PROCESS_COUNT 16
+
+typedef enum FbrTracePhase {
+    FBR_TRACE_PHASE_BEGIN = 'B',
+    FBR_TRACE_PHASE_END = 'E',
+    FBR_TRACE_PHASE_COMPLETE = 'X',
+    FBR_TRACE_PHASE_INSTANT = 'i',
+} FbrTracePhase;
+
+typedef enum FbrTraceCategory {
+    FBR_TRACE_CATEGORY_CPU,
+    FBR_TRACE_CATEGORY_GPU,
+    FBR_TRACE_CATEGORY_IPC,
+    FBR_TRACE_CATEGORY_SEMAPHORE,
+    FBR_TRACE_CATEGORY_COUNT,
+} FbrTraceCategory;
+
+typedef struct FbrTraceEvent {
+    // ticks of fbrGetTraceTimestamp, the same clock in every process
+    int64_t timestamp;
+    int64_t duration;
+    // semaphore value or IPC target
+    uint64_t value;
+    uint32_t processID;
+    uint32_t threadID;
+    uint8_t phase;
+    uint8_t category;
+    uint16_t reserved;
+    // index + 1 of the write that filled this event, stored last so a reader can skip torn events
+    uint32_t sequence;
+    char pName[FBR_TRACE_NAME_SIZE];
+} FbrTraceEvent;
+
+// Names are kept outside the ring so they survive it wrapping, written out as metadata on export
+typedef struct FbrTraceProcess {
+    uint32_t processID;
+    // stored last so the exporter skips a slot still being filled
+    uint32_t ready;
+    char pName[FBR_TRACE_NAME_SIZE];
+} FbrTraceProcess;
+
+typedef struct FbrTraceBuffer {
+    uint32_t magic;
+    uint32_t capacity;
+    int64_t frequency;
+    int64_t baseTimestamp;
+    // only ever incremented, wraps into the ring by capacity
+    uint64_t writeCount;
+    uint32_t processCount;
+    FbrTraceProcess pProcesses[FBR_TRACE_MAX_PROCESS_COUNT];
+    FbrTraceEvent pEvents[FBR_TRACE_EVENT_CAPACITY];
+} FbrTraceBuffer;
+
+typedef struct FbrTrace {
+    bool isProducer;
+    FbrIPCBuffer *pIPCBuffer;
+} FbrTrace;
+
+// Compositor side, creates the shared buffer and exports it when destroyed.
+int fbrCreateTrace(FbrTrace **ppAllocTrace);
+
+// Node side, writes into the compositor's buffer.
+int fbrImportTrace(FbrTrace **ppAllocTrace);
+
+void fbrDestroyTrace(FbrTrace *pTrace);
+
+void fbrExportTrace(const char *pPath);
+
+// Quoted and escaped, control characters are dropped. Shared by everything that writes JSON reports.
+void fbrWriteJSONString(FILE *file, const char *pString);
+
+// Ticks per second of the trace clock, QueryPerformanceCounter on windows.
+int64_t fbrGetTraceFrequency();
+
+int64_t fbrGetTraceTimestamp();
+
+// Each call is lock free and a no-op when no trace is open.
+void fbrTraceBegin(const char *pName);
+
+void fbrTraceEnd(const char *pName);
+
+void fbrTraceInstant(FbrTraceCategory category, const char *pName, uint64_t value);
+
+void fbrTraceComplete(FbrTraceCategory category, const char *pName, uint32_t threadID, int64_t timestamp, int64_t duration);
+
+#endif //FABRIC_TRACE_H
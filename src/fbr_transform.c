@@ -9,7 +9,7 @@ void fbrInitTransform(FbrTransform *pTransform) {
 void fbrUpdateTransformUBO(FbrTransform *pTransform) {
     glm_translate_to(GLM_MAT4_IDENTITY, pTransform->pos, pTransform->uboData.model);
     glm_quat_rotate(pTransform->uboData.model, pTransform->rot, pTransform->uboData.model);
-    memcpy(pTransform->pUBO->pUniformBufferMapped, &pTransform->uboData, sizeof(FbrTransform));
+    memcpy(pTransform->uboSlot.pData, &pTransform->uboData, sizeof(FbrTransformUBO));
 }
 
 void fbrTransformUp(FbrTransform *pTransform, vec3 dest) {
@@ -31,19 +31,17 @@ VkResult fbrCreateTransform(const FbrVulkan *pVulkan, FbrTransform **ppAllocTran
     *ppAllocTransform = calloc(1, sizeof(FbrTransform));
     FbrTransform *pTransform = *ppAllocTransform;
 
-    FBR_ACK(fbrCreateUBO(pVulkan,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                         sizeof(FbrTransform),
-                         false,
-                         &pTransform->pUBO));
+    FBR_ACK(fbrAcquireDynamicUBOSlot(pVulkan->pDynamicUBO,
+                                     sizeof(FbrTransformUBO),
+                                     &pTransform->uboSlot));
 
     fbrInitTransform(pTransform);
     fbrUpdateTransformUBO(pTransform);
+    return FBR_SUCCESS;
 }
 
 void fbrDestroyTransform(const FbrVulkan *pVulkan, FbrTransform *pTransform)
 {
-    fbrDestroyUBO(pVulkan, pTransform->pUBO);
+    fbrReleaseDynamicUBOSlot(pVulkan->pDynamicUBO, &pTransform->uboSlot);
     free(pTransform);
 }
\ No newline at end of file
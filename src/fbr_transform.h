@@ -17,7 +17,7 @@ typedef struct FbrTransform {
     vec3 pos;
     versor rot;
     FbrTransformUBO uboData;
-    FbrUniformBufferObject *pUBO;
+    FbrDynamicSlot uboSlot;
 } FbrTransform;
 
 typedef struct FbrEntity {
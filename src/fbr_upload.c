@@ -0,0 +1,625 @@
+#include "fbr_upload.h"
+#include "fbr_vulkan.h"
+#include "fbr_buffer.h"
+#include "fbr_log.h"
+
+#include "stb_ds.h"
+
+#include <string.h>
+
+static VkResult createCommandPool(const FbrVulkan *pVulkan, uint32_t queueFamilyIndex, VkCommandPool *pCommandPool) {
+    const VkCommandPoolCreateInfo poolInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = queueFamilyIndex,
+    };
+    FBR_ACK(vkCreateCommandPool(pVulkan->device, &poolInfo, FBR_ALLOCATOR, pCommandPool));
+    return FBR_SUCCESS;
+}
+
+static VkResult allocateCommandBuffer(const FbrVulkan *pVulkan, VkCommandPool commandPool, VkCommandBuffer *pCommandBuffer) {
+    const VkCommandBufferAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandPool = commandPool,
+            .commandBufferCount = 1,
+    };
+    FBR_ACK(vkAllocateCommandBuffers(pVulkan->device, &allocInfo, pCommandBuffer));
+    return FBR_SUCCESS;
+}
+
+// Begins the next batch in the ring if one isn't already recording. Only blocks if the ring has wrapped onto a batch still in flight.
+static VkResult beginBatch(const FbrVulkan *pVulkan, FbrUploadQueue *pUploadQueue, FbrUploadBatch **ppBatch) {
+    FbrUploadBatch *pBatch = &pUploadQueue->pBatches[pUploadQueue->batchIndex];
+    *ppBatch = pBatch;
+    if (pUploadQueue->recording)
+        return FBR_SUCCESS;
+
+    if (pBatch->token != 0)
+        FBR_ACK(fbrWaitUpload(pVulkan, pBatch->token));
+
+    // two timeline steps when dedicated, one for the transfer submit and one for the graphics acquire
+    pBatch->token = pUploadQueue->pTimelineSemaphore->waitValue + (pUploadQueue->dedicatedTransfer ? 2 : 1);
+
+    const VkCommandBufferBeginInfo beginInfo = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+    FBR_ACK(vkResetCommandBuffer(pBatch->graphicsCommandBuffer, 0));
+    FBR_ACK(vkBeginCommandBuffer(pBatch->graphicsCommandBuffer, &beginInfo));
+    if (pUploadQueue->dedicatedTransfer) {
+        FBR_ACK(vkResetCommandBuffer(pBatch->transferCommandBuffer, 0));
+        FBR_ACK(vkBeginCommandBuffer(pBatch->transferCommandBuffer, &beginInfo));
+    }
+
+    pUploadQueue->recording = true;
+
+    return FBR_SUCCESS;
+}
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static VkResult createStagingRing(const FbrVulkan *pVulkan, FbrStagingRing *pRing) {
+    const VkDeviceSize optimalAlignment = pVulkan->physicalDeviceProperties.properties.limits.optimalBufferCopyOffsetAlignment;
+    pRing->size = FBR_STAGING_RING_SIZE;
+    // 16 keeps any color format texel size happy for buffer to image copies
+    pRing->alignment = optimalAlignment > 16 ? optimalAlignment : 16;
+
+    const VkBufferCreateInfo bufferCreateInfo = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = pRing->size,
+            .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+    FBR_ACK(vkCreateBuffer(pVulkan->device, &bufferCreateInfo, FBR_ALLOCATOR, &pRing->buffer));
+
+    VkMemoryRequirements memRequirements;
+    uint32_t memTypeIndex;
+    FBR_ACK(fbrBufferMemoryTypeFromProperties(pVulkan,
+                                              pRing->buffer,
+                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                              &memRequirements,
+                                              &memTypeIndex));
+    const VkMemoryAllocateInfo allocInfo = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .allocationSize = memRequirements.size,
+            .memoryTypeIndex = memTypeIndex,
+    };
+    FBR_ACK(vkAllocateMemory(pVulkan->device, &allocInfo, FBR_ALLOCATOR, &pRing->memory));
+    FBR_ACK(vkBindBufferMemory(pVulkan->device, pRing->buffer, pRing->memory, 0));
+    FBR_ACK(vkMapMemory(pVulkan->device, pRing->memory, 0, pRing->size, 0, (void **) &pRing->pMapped));
+
+    return FBR_SUCCESS;
+}
+
+static void destroyStagingRing(const FbrVulkan *pVulkan, FbrStagingRing *pRing) {
+    arrfree(pRing->pRegions);
+    vkUnmapMemory(pVulkan->device, pRing->memory);
+    vkDestroyBuffer(pVulkan->device, pRing->buffer, FBR_ALLOCATOR);
+    vkFreeMemory(pVulkan->device, pRing->memory, FBR_ALLOCATOR);
+}
+
+static void retireStaging(const FbrVulkan *pVulkan, FbrUploadQueue *pUploadQueue) {
+    FbrStagingRing *pRing = &pUploadQueue->stagingRing;
+    if (arrlen(pRing->pRegions) == 0)
+        return;
+
+    uint64_t completedValue;
+    vkGetSemaphoreCounterValue(pVulkan->device, pUploadQueue->pTimelineSemaphore->semaphore, &completedValue);
+
+    int retiredCount = 0;
+    while (retiredCount < arrlen(pRing->pRegions) && pRing->pRegions[retiredCount].token <= completedValue)
+        retiredCount++;
+
+    if (retiredCount == 0)
+        return;
+
+    arrdeln(pRing->pRegions, 0, retiredCount);
+    if (arrlen(pRing->pRegions) == 0) {
+        pRing->head = 0;
+        pRing->tail = 0;
+    } else {
+        pRing->tail = pRing->pRegions[0].offset;
+    }
+}
+
+// Free space is [head, size) + [0, tail) when unwrapped, [head, tail) once head has wrapped behind tail.
+static bool tryStagingAlloc(FbrStagingRing *pRing, VkDeviceSize size, VkDeviceSize *pOffset) {
+    const VkDeviceSize offset = alignUp(pRing->head, pRing->alignment);
+    const bool unwrapped = arrlen(pRing->pRegions) == 0 || pRing->tail < pRing->head;
+    if (unwrapped) {
+        if (offset + size <= pRing->size) {
+            *pOffset = offset;
+            return true;
+        }
+        if (size <= pRing->tail) {
+            *pOffset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    if (offset + size <= pRing->tail) {
+        *pOffset = offset;
+        return true;
+    }
+    return false;
+}
+
+// Sub-allocates from the staging ring under the current batch. If the ring is full the batch is pushed out and this
+// blocks on the oldest region, so the returned batch may not be the one the caller previously recorded into.
+static VkResult stagingAlloc(const FbrVulkan *pVulkan,
+                             FbrUploadQueue *pUploadQueue,
+                             const void *pSrcData,
+                             VkDeviceSize size,
+                             FbrUploadBatch **ppBatch,
+                             VkDeviceSize *pOffset) {
+    FbrStagingRing *pRing = &pUploadQueue->stagingRing;
+    for (;;) {
+        FBR_ACK(beginBatch(pVulkan, pUploadQueue, ppBatch));
+        retireStaging(pVulkan, pUploadQueue);
+
+        if (tryStagingAlloc(pRing, size, pOffset))
+            break;
+
+        if (arrlen(pRing->pRegions) == 0) {
+            FBR_LOG_ERROR("Staging allocation larger than staging ring!");
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+
+        FBR_ACK(fbrWaitUpload(pVulkan, pRing->pRegions[0].token));
+    }
+
+    const FbrUploadToken token = (*ppBatch)->token;
+    const VkDeviceSize end = *pOffset + size;
+    const ptrdiff_t lastIndex = arrlen(pRing->pRegions) - 1;
+    if (lastIndex >= 0 && pRing->pRegions[lastIndex].token == token && pRing->pRegions[lastIndex].end <= *pOffset) {
+        pRing->pRegions[lastIndex].end = end;
+    } else {
+        const FbrStagingRegion region = {
+                .token = token,
+                .offset = *pOffset,
+                .end = end,
+        };
+        arrput(pRing->pRegions, region);
+    }
+    pRing->head = end;
+
+    memcpy(pRing->pMapped + *pOffset, pSrcData, size);
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrCreateUploadQueue(const FbrVulkan *pVulkan, FbrUploadQueue **ppAllocUploadQueue) {
+    *ppAllocUploadQueue = calloc(1, sizeof(FbrUploadQueue));
+    FbrUploadQueue *pUploadQueue = *ppAllocUploadQueue;
+
+    pUploadQueue->dedicatedTransfer = pVulkan->transferQueueFamilyIndex != pVulkan->graphicsQueueFamilyIndex;
+    FBR_LOG_MESSAGE("Creating upload queue.", pUploadQueue->dedicatedTransfer, pVulkan->transferQueueFamilyIndex);
+
+    FBR_ACK(createCommandPool(pVulkan, pVulkan->graphicsQueueFamilyIndex, &pUploadQueue->graphicsCommandPool));
+    if (pUploadQueue->dedicatedTransfer) {
+        FBR_ACK(createCommandPool(pVulkan, pVulkan->transferQueueFamilyIndex, &pUploadQueue->transferCommandPool));
+    }
+
+    for (int i = 0; i < FBR_UPLOAD_RING_COUNT; ++i) {
+        FbrUploadBatch *pBatch = &pUploadQueue->pBatches[i];
+        FBR_ACK(allocateCommandBuffer(pVulkan, pUploadQueue->graphicsCommandPool, &pBatch->graphicsCommandBuffer));
+        if (pUploadQueue->dedicatedTransfer) {
+            FBR_ACK(allocateCommandBuffer(pVulkan, pUploadQueue->transferCommandPool, &pBatch->transferCommandBuffer));
+        } else {
+            pBatch->transferCommandBuffer = pBatch->graphicsCommandBuffer;
+        }
+    }
+
+    FBR_ACK(fbrCreateTimelineSemaphore(pVulkan, false, false, &pUploadQueue->pTimelineSemaphore));
+
+    FBR_ACK(createStagingRing(pVulkan, &pUploadQueue->stagingRing));
+
+    return FBR_SUCCESS;
+}
+
+void fbrDestroyUploadQueue(const FbrVulkan *pVulkan, FbrUploadQueue *pUploadQueue) {
+    fbrSubmitUploads(pVulkan, NULL);
+    fbrWaitUpload(pVulkan, pUploadQueue->pTimelineSemaphore->waitValue);
+
+    destroyStagingRing(pVulkan, &pUploadQueue->stagingRing);
+
+    fbrDestroyTimelineSemaphore(pVulkan, pUploadQueue->pTimelineSemaphore);
+
+    vkDestroyCommandPool(pVulkan->device, pUploadQueue->graphicsCommandPool, FBR_ALLOCATOR);
+    if (pUploadQueue->dedicatedTransfer)
+        vkDestroyCommandPool(pVulkan->device, pUploadQueue->transferCommandPool, FBR_ALLOCATOR);
+
+    free(pUploadQueue);
+}
+
+VkResult fbrUploadBuffer(const FbrVulkan *pVulkan,
+                         const void *pSrcData,
+                         VkBuffer dstBuffer,
+                         VkDeviceSize size,
+                         VkPipelineStageFlags dstStageMask,
+                         VkAccessFlags dstAccessMask,
+                         FbrUploadToken *pToken) {
+    FbrUploadQueue *pUploadQueue = pVulkan->pUploadQueue;
+    FbrUploadBatch *pBatch;
+
+    for (VkDeviceSize dstOffset = 0; dstOffset < size; dstOffset += FBR_STAGING_CHUNK_SIZE) {
+        const VkDeviceSize chunkSize = size - dstOffset < FBR_STAGING_CHUNK_SIZE ? size - dstOffset : FBR_STAGING_CHUNK_SIZE;
+        VkDeviceSize stagingOffset;
+        FBR_ACK(stagingAlloc(pVulkan, pUploadQueue, (const uint8_t *) pSrcData + dstOffset, chunkSize, &pBatch, &stagingOffset));
+
+        const VkBufferCopy copyRegion = {
+                .srcOffset = stagingOffset,
+                .dstOffset = dstOffset,
+                .size = chunkSize,
+        };
+        vkCmdCopyBuffer(pBatch->transferCommandBuffer, pUploadQueue->stagingRing.buffer, dstBuffer, 1, &copyRegion);
+    }
+
+    // https://github.com/KhronosGroup/Vulkan-Docs/wiki/Synchronization-Examples#upload-data-from-the-cpu-to-a-vertex-buffer
+    if (pUploadQueue->dedicatedTransfer) {
+        const VkBufferMemoryBarrier releaseBarrier = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = 0,
+                .srcQueueFamilyIndex = pVulkan->transferQueueFamilyIndex,
+                .dstQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
+                .buffer = dstBuffer,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+        };
+        vkCmdPipelineBarrier(pBatch->transferCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0,
+                             0, NULL,
+                             1, &releaseBarrier,
+                             0, NULL);
+        const VkBufferMemoryBarrier acquireBarrier = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = dstAccessMask,
+                .srcQueueFamilyIndex = pVulkan->transferQueueFamilyIndex,
+                .dstQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
+                .buffer = dstBuffer,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+        };
+        vkCmdPipelineBarrier(pBatch->graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             dstStageMask,
+                             0,
+                             0, NULL,
+                             1, &acquireBarrier,
+                             0, NULL);
+    } else {
+        const VkBufferMemoryBarrier barrier = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = dstAccessMask,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .buffer = dstBuffer,
+                .offset = 0,
+                .size = VK_WHOLE_SIZE,
+        };
+        vkCmdPipelineBarrier(pBatch->graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             dstStageMask,
+                             0,
+                             0, NULL,
+                             1, &barrier,
+                             0, NULL);
+    }
+
+    if (pToken != NULL)
+        *pToken = pBatch->token;
+
+    return FBR_SUCCESS;
+}
+
+// Stream in bands of rows so a large image never needs more than a chunk of the ring at once.
+// Later bands may land in a later batch, the image just stays in TRANSFER_DST until the final barrier.
+static VkResult copyImageBands(const FbrVulkan *pVulkan,
+                               FbrUploadQueue *pUploadQueue,
+                               const void *pSrcData,
+                               VkDeviceSize size,
+                               VkImage dstImage,
+                               VkExtent2D extent,
+                               bool graphics,
+                               FbrUploadBatch **ppBatch) {
+    const VkDeviceSize rowSize = size / extent.height;
+    uint32_t rowsPerChunk = (uint32_t) (FBR_STAGING_CHUNK_SIZE / rowSize);
+    if (rowsPerChunk == 0)
+        rowsPerChunk = 1;
+
+    for (uint32_t row = 0; row < extent.height; row += rowsPerChunk) {
+        const uint32_t rowCount = extent.height - row < rowsPerChunk ? extent.height - row : rowsPerChunk;
+        VkDeviceSize stagingOffset;
+        FBR_ACK(stagingAlloc(pVulkan, pUploadQueue, (const uint8_t *) pSrcData + row * rowSize, rowCount * rowSize, ppBatch, &stagingOffset));
+
+        const VkBufferImageCopy region = {
+                .bufferOffset = stagingOffset,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .imageSubresource.mipLevel = 0,
+                .imageSubresource.baseArrayLayer = 0,
+                .imageSubresource.layerCount = 1,
+                .imageOffset = {0, (int32_t) row, 0},
+                .imageExtent = {extent.width, rowCount, 1},
+        };
+        vkCmdCopyBufferToImage(graphics ? (*ppBatch)->graphicsCommandBuffer : (*ppBatch)->transferCommandBuffer,
+                               pUploadQueue->stagingRing.buffer,
+                               dstImage,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               1,
+                               &region);
+    }
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrUploadImage(const FbrVulkan *pVulkan,
+                        const void *pSrcData,
+                        VkDeviceSize size,
+                        VkImage dstImage,
+                        VkExtent2D extent,
+                        VkImageLayout dstLayout,
+                        VkPipelineStageFlags dstStageMask,
+                        VkAccessFlags dstAccessMask,
+                        FbrUploadToken *pToken) {
+    FbrUploadQueue *pUploadQueue = pVulkan->pUploadQueue;
+    FbrUploadBatch *pBatch;
+    FBR_ACK(beginBatch(pVulkan, pUploadQueue, &pBatch));
+
+    const VkImageMemoryBarrier transferDstBarrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_NONE,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = dstImage,
+            FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+    };
+    vkCmdPipelineBarrier(pBatch->transferCommandBuffer,
+                         VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, NULL,
+                         0, NULL,
+                         1, &transferDstBarrier);
+
+    FBR_ACK(copyImageBands(pVulkan, pUploadQueue, pSrcData, size, dstImage, extent, false, &pBatch));
+
+    // https://github.com/KhronosGroup/Vulkan-Docs/wiki/Synchronization-Examples#multiple-queues
+    if (pUploadQueue->dedicatedTransfer) {
+        const VkImageMemoryBarrier releaseBarrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = 0,
+                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .newLayout = dstLayout,
+                .srcQueueFamilyIndex = pVulkan->transferQueueFamilyIndex,
+                .dstQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
+                .image = dstImage,
+                FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+        };
+        vkCmdPipelineBarrier(pBatch->transferCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0,
+                             0, NULL,
+                             0, NULL,
+                             1, &releaseBarrier);
+        const VkImageMemoryBarrier acquireBarrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = 0,
+                .dstAccessMask = dstAccessMask,
+                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .newLayout = dstLayout,
+                .srcQueueFamilyIndex = pVulkan->transferQueueFamilyIndex,
+                .dstQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex,
+                .image = dstImage,
+                FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+        };
+        vkCmdPipelineBarrier(pBatch->graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                             dstStageMask,
+                             0,
+                             0, NULL,
+                             0, NULL,
+                             1, &acquireBarrier);
+    } else {
+        const VkImageMemoryBarrier barrier = {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask = dstAccessMask,
+                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .newLayout = dstLayout,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = dstImage,
+                FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+        };
+        vkCmdPipelineBarrier(pBatch->graphicsCommandBuffer,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             dstStageMask,
+                             0,
+                             0, NULL,
+                             0, NULL,
+                             1, &barrier);
+    }
+
+    if (pToken != NULL)
+        *pToken = pBatch->token;
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrReuploadImage(const FbrVulkan *pVulkan,
+                          const void *pSrcData,
+                          VkDeviceSize size,
+                          VkImage dstImage,
+                          VkExtent2D extent,
+                          VkPipelineStageFlags srcStageMask,
+                          VkImageLayout dstLayout,
+                          VkPipelineStageFlags dstStageMask,
+                          VkAccessFlags dstAccessMask,
+                          FbrUploadToken *pToken) {
+    FbrUploadQueue *pUploadQueue = pVulkan->pUploadQueue;
+    FbrUploadBatch *pBatch;
+    FBR_ACK(beginBatch(pVulkan, pUploadQueue, &pBatch));
+
+    // Earlier reads only need an execution dependency as their contents are discarded, an earlier transfer like a
+    // placeholder clear still has its writes ordered. Graphics queue submission order is what keeps the copy behind
+    // frames already submitted.
+    const VkImageMemoryBarrier transferDstBarrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = dstImage,
+            FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+    };
+    vkCmdPipelineBarrier(pBatch->graphicsCommandBuffer,
+                         srcStageMask | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0,
+                         0, NULL,
+                         0, NULL,
+                         1, &transferDstBarrier);
+
+    FBR_ACK(copyImageBands(pVulkan, pUploadQueue, pSrcData, size, dstImage, extent, true, &pBatch));
+
+    const VkImageMemoryBarrier barrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = dstAccessMask,
+            .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout = dstLayout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = dstImage,
+            FBR_DEFAULT_COLOR_SUBRESOURCE_RANGE
+    };
+    vkCmdPipelineBarrier(pBatch->graphicsCommandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         dstStageMask,
+                         0,
+                         0, NULL,
+                         0, NULL,
+                         1, &barrier);
+
+    if (pToken != NULL)
+        *pToken = pBatch->token;
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrGetUploadGraphicsCommandBuffer(const FbrVulkan *pVulkan, VkCommandBuffer *pCommandBuffer, FbrUploadToken *pToken) {
+    FbrUploadBatch *pBatch;
+    FBR_ACK(beginBatch(pVulkan, pVulkan->pUploadQueue, &pBatch));
+    *pCommandBuffer = pBatch->graphicsCommandBuffer;
+
+    if (pToken != NULL)
+        *pToken = pBatch->token;
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrSubmitUploads(const FbrVulkan *pVulkan, FbrUploadToken *pToken) {
+    FbrUploadQueue *pUploadQueue = pVulkan->pUploadQueue;
+    FbrTimelineSemaphore *pTimelineSemaphore = pUploadQueue->pTimelineSemaphore;
+
+    if (!pUploadQueue->recording) {
+        if (pToken != NULL)
+            *pToken = pTimelineSemaphore->waitValue;
+        return FBR_SUCCESS;
+    }
+
+    FbrUploadBatch *pBatch = &pUploadQueue->pBatches[pUploadQueue->batchIndex];
+
+    if (pUploadQueue->dedicatedTransfer) {
+        FBR_ACK(vkEndCommandBuffer(pBatch->transferCommandBuffer));
+        const uint64_t transferSignalValue = pBatch->token - 1;
+        const VkTimelineSemaphoreSubmitInfo transferTimelineSubmitInfo = {
+                .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+                .signalSemaphoreValueCount = 1,
+                .pSignalSemaphoreValues = &transferSignalValue,
+        };
+        const VkSubmitInfo transferSubmitInfo = {
+                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+                .pNext = &transferTimelineSubmitInfo,
+                .commandBufferCount = 1,
+                .pCommandBuffers = &pBatch->transferCommandBuffer,
+                .signalSemaphoreCount = 1,
+                .pSignalSemaphores = &pTimelineSemaphore->semaphore,
+        };
+        FBR_ACK_EXIT(vkQueueSubmit(pVulkan->transferQueue, 1, &transferSubmitInfo, VK_NULL_HANDLE));
+    }
+
+    FBR_ACK(vkEndCommandBuffer(pBatch->graphicsCommandBuffer));
+    const uint64_t graphicsWaitValue = pBatch->token - 1;
+    const uint64_t graphicsSignalValue = pBatch->token;
+    const VkTimelineSemaphoreSubmitInfo graphicsTimelineSubmitInfo = {
+            .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+            .waitSemaphoreValueCount = pUploadQueue->dedicatedTransfer ? 1 : 0,
+            .pWaitSemaphoreValues = &graphicsWaitValue,
+            .signalSemaphoreValueCount = 1,
+            .pSignalSemaphoreValues = &graphicsSignalValue,
+    };
+    const VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    const VkSubmitInfo graphicsSubmitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .pNext = &graphicsTimelineSubmitInfo,
+            .waitSemaphoreCount = pUploadQueue->dedicatedTransfer ? 1 : 0,
+            .pWaitSemaphores = &pTimelineSemaphore->semaphore,
+            .pWaitDstStageMask = &waitDstStageMask,
+            .commandBufferCount = 1,
+            .pCommandBuffers = &pBatch->graphicsCommandBuffer,
+            .signalSemaphoreCount = 1,
+            .pSignalSemaphores = &pTimelineSemaphore->semaphore,
+    };
+    FBR_ACK_EXIT(vkQueueSubmit(pVulkan->graphicsQueue, 1, &graphicsSubmitInfo, VK_NULL_HANDLE));
+
+    pTimelineSemaphore->waitValue = pBatch->token;
+    pUploadQueue->recording = false;
+    pUploadQueue->batchIndex = (pUploadQueue->batchIndex + 1) % FBR_UPLOAD_RING_COUNT;
+
+    if (pToken != NULL)
+        *pToken = pBatch->token;
+
+    return FBR_SUCCESS;
+}
+
+VkResult fbrWaitUpload(const FbrVulkan *pVulkan, FbrUploadToken token) {
+    const FbrUploadQueue *pUploadQueue = pVulkan->pUploadQueue;
+
+    // token of the batch still recording, nothing to wait on until it goes out
+    if (token > pUploadQueue->pTimelineSemaphore->waitValue)
+        FBR_ACK(fbrSubmitUploads(pVulkan, NULL));
+
+    const VkSemaphoreWaitInfo semaphoreWaitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &pUploadQueue->pTimelineSemaphore->semaphore,
+            .pValues = &token,
+    };
+    FBR_ACK(vkWaitSemaphores(pVulkan->device, &semaphoreWaitInfo, UINT64_MAX));
+    return FBR_SUCCESS;
+}
+
+bool fbrUploadComplete(const FbrVulkan *pVulkan, FbrUploadToken token) {
+    uint64_t completedValue;
+    vkGetSemaphoreCounterValue(pVulkan->device, pVulkan->pUploadQueue->pTimelineSemaphore->semaphore, &completedValue);
+    return completedValue >= token;
+}
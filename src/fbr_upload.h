@@ -0,0 +1,103 @@
+#ifndef FABRIC_UPLOAD_H
+#define FABRIC_UPLOAD_H
+
+#include "fbr_app.h"
+#include "fbr_timeline_semaphore.h"
+
+#define FBR_UPLOAD_RING_COUNT 4
+#define FBR_STAGING_RING_SIZE (16 * 1024 * 1024)
+// Uploads larger than this are streamed through the ring in pieces
+#define FBR_STAGING_CHUNK_SIZE (FBR_STAGING_RING_SIZE / 4)
+
+// Value on the upload timeline semaphore. Once reached the upload has been acquired on the graphics queue.
+typedef uint64_t FbrUploadToken;
+
+typedef struct FbrStagingRegion {
+    FbrUploadToken token;
+    VkDeviceSize offset;
+    VkDeviceSize end;
+} FbrStagingRegion;
+
+// Persistently mapped host coherent ring. Regions are handed back once their token is reached.
+typedef struct FbrStagingRing {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint8_t *pMapped;
+    VkDeviceSize size;
+    VkDeviceSize alignment;
+    VkDeviceSize head;
+    VkDeviceSize tail;
+    // stb_ds array, oldest first
+    FbrStagingRegion *pRegions;
+} FbrStagingRing;
+
+typedef struct FbrUploadBatch {
+    // transfer is the same command buffer as graphics when there is no dedicated transfer queue
+    VkCommandBuffer transferCommandBuffer;
+    VkCommandBuffer graphicsCommandBuffer;
+    FbrUploadToken token;
+} FbrUploadBatch;
+
+typedef struct FbrUploadQueue {
+    bool dedicatedTransfer;
+    bool recording;
+
+    VkCommandPool transferCommandPool;
+    VkCommandPool graphicsCommandPool;
+
+    FbrUploadBatch pBatches[FBR_UPLOAD_RING_COUNT];
+    uint32_t batchIndex;
+
+    FbrTimelineSemaphore *pTimelineSemaphore;
+
+    FbrStagingRing stagingRing;
+} FbrUploadQueue;
+
+VkResult fbrCreateUploadQueue(const FbrVulkan *pVulkan, FbrUploadQueue **ppAllocUploadQueue);
+
+void fbrDestroyUploadQueue(const FbrVulkan *pVulkan, FbrUploadQueue *pUploadQueue);
+
+// Stages pSrcData and records the copy into the current batch, nothing executes until fbrSubmitUploads.
+// May submit early and block if the staging ring is full.
+VkResult fbrUploadBuffer(const FbrVulkan *pVulkan,
+                         const void *pSrcData,
+                         VkBuffer dstBuffer,
+                         VkDeviceSize size,
+                         VkPipelineStageFlags dstStageMask,
+                         VkAccessFlags dstAccessMask,
+                         FbrUploadToken *pToken);
+
+// pSrcData is expected tightly packed, size / extent.height is taken as the row size.
+VkResult fbrUploadImage(const FbrVulkan *pVulkan,
+                        const void *pSrcData,
+                        VkDeviceSize size,
+                        VkImage dstImage,
+                        VkExtent2D extent,
+                        VkImageLayout dstLayout,
+                        VkPipelineStageFlags dstStageMask,
+                        VkAccessFlags dstAccessMask,
+                        FbrUploadToken *pToken);
+
+// For images frames may already be sampling, the copies are recorded on the graphics queue so they land after every
+// frame submitted before fbrSubmitUploads, even with a dedicated transfer queue. Prior contents are discarded.
+VkResult fbrReuploadImage(const FbrVulkan *pVulkan,
+                          const void *pSrcData,
+                          VkDeviceSize size,
+                          VkImage dstImage,
+                          VkExtent2D extent,
+                          VkPipelineStageFlags srcStageMask,
+                          VkImageLayout dstLayout,
+                          VkPipelineStageFlags dstStageMask,
+                          VkAccessFlags dstAccessMask,
+                          FbrUploadToken *pToken);
+
+// Graphics queue command buffer of the current batch for anything needing graphics stages, runs after the batch acquires.
+VkResult fbrGetUploadGraphicsCommandBuffer(const FbrVulkan *pVulkan, VkCommandBuffer *pCommandBuffer, FbrUploadToken *pToken);
+
+VkResult fbrSubmitUploads(const FbrVulkan *pVulkan, FbrUploadToken *pToken);
+
+VkResult fbrWaitUpload(const FbrVulkan *pVulkan, FbrUploadToken token);
+
+bool fbrUploadComplete(const FbrVulkan *pVulkan, FbrUploadToken token);
+
+#endif //FABRIC_UPLOAD_H
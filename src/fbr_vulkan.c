@@ -1,6 +1,13 @@
 #include "fbr_vulkan.h"
 #include "fbr_log.h"
 #include "fbr_swap.h"
+#include "fbr_upload.h"
+#include "fbr_asset_loader.h"
+#include "fbr_memory.h"
+#include "fbr_buffer.h"
+#include "fbr_descriptor_allocator.h"
+#include "fbr_pipeline_cache.h"
+#include "fbr_profiler.h"
 
 #include <string.h>
 
@@ -28,7 +35,6 @@ const char *pRequiredInstanceExtensions[] = {
 };
 
 const char *pRequiredDeviceExtensions[] = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
         VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
         VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
         VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME,
@@ -38,6 +44,7 @@ const char *pRequiredDeviceExtensions[] = {
         VK_KHR_SPIRV_1_4_EXTENSION_NAME,
         // Required by VK_KHR_spirv_1_4 - https://github.com/SaschaWillems/Vulkan/blob/master/examples/meshshader/meshshader.cpp
         VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME,
+        VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
 #ifdef WIN32
         VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME,
         VK_KHR_EXTERNAL_SEMAPHORE_WIN32_EXTENSION_NAME,
@@ -50,6 +57,22 @@ const char *pRequiredDeviceExtensions[] = {
 #endif
 };
 
+// Needs VK_KHR_surface, so not when headless
+const char *pWindowDeviceExtensions[] = {
+        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+};
+
+// Enabled together when both are available, compositor only
+const char *pOptionalPresentWaitExtensions[] = {
+        VK_KHR_PRESENT_ID_EXTENSION_NAME,
+        VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+};
+
+// Maps GPU timestamps onto the CPU trace clock
+const char *pOptionalCalibratedTimestampsExtensions[] = {
+        VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME,
+};
+
 // any other way to get this into validation layer?
 static bool isChild;
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -76,8 +99,9 @@ static VkDebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo()
 
 static void getRequiredInstanceExtensions(FbrVulkan *pVulkan, uint32_t *extensionCount, const char *pExtensions[])
 {
+    // headless has no surface so needs none of the window system extensions
     uint32_t glfwExtensionCount = 0;
-    const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    const char **glfwExtensions = pVulkan->headless ? NULL : glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
     *extensionCount = glfwExtensionCount + COUNT(pRequiredInstanceExtensions) + (pVulkan->enableValidationLayers ? 1 : 0);
 
@@ -262,6 +286,7 @@ static void findQueueFamilies(FbrVulkan *pVulkan)
 
     bool foundGraphics = false;
     bool foundCompute = false;
+    bool foundTransfer = false;
 
     // Taking a cue from SteamVR Vulkan example and just assuming graphicsQueue that supports both graphics and present is the only one we want. Don't entirely know if that's right.
     for (int i = 0; i < queueFamilyCount; ++i) {
@@ -269,8 +294,10 @@ static void findQueueFamilies(FbrVulkan *pVulkan)
         bool graphicsSupport = queueFamilies[i].queueFamilyProperties.queueFlags & VK_QUEUE_GRAPHICS_BIT;
         bool computeSupport = queueFamilies[i].queueFamilyProperties.queueFlags & VK_QUEUE_COMPUTE_BIT;
 
-        VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(pVulkan->physicalDevice, i, pVulkan->surface, &presentSupport);
+        VkBool32 presentSupport = pVulkan->headless;
+        if (!pVulkan->headless) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(pVulkan->physicalDevice, i, pVulkan->surface, &presentSupport);
+        }
 
         if (!foundGraphics && graphicsSupport && presentSupport) {
             if (!globalQueueSupport) {
@@ -289,6 +316,14 @@ static void findQueueFamilies(FbrVulkan *pVulkan)
             foundCompute = true;
             FBR_LOG_DEBUG(pVulkan->computeQueueFamilyIndex);
         }
+
+        // Transfer only family is usually the copy engine, let uploads run on it beside rendering
+        bool transferSupport = queueFamilies[i].queueFamilyProperties.queueFlags & VK_QUEUE_TRANSFER_BIT;
+        if (!foundTransfer && transferSupport && !graphicsSupport && !computeSupport) {
+            pVulkan->transferQueueFamilyIndex = i;
+            foundTransfer = true;
+            FBR_LOG_DEBUG(pVulkan->transferQueueFamilyIndex);
+        }
     }
 
     if (!foundGraphics) {
@@ -298,6 +333,24 @@ static void findQueueFamilies(FbrVulkan *pVulkan)
     if (!foundCompute) {
         FBR_LOG_ERROR("Failed to find a computeQueue!");
     }
+
+    if (!foundTransfer) {
+        FBR_LOG_MESSAGE("No dedicated transferQueue, uploading on graphicsQueue.");
+        pVulkan->transferQueueFamilyIndex = pVulkan->graphicsQueueFamilyIndex;
+    }
+}
+
+static bool isDeviceExtensionSupported(const FbrVulkan *pVulkan, const char *pExtensionName)
+{
+    uint32_t availableExtensionCount = 0;
+    FBR_VK_CHECK(vkEnumerateDeviceExtensionProperties(pVulkan->physicalDevice, NULL, &availableExtensionCount, NULL));
+    VkExtensionProperties availableExtensions[availableExtensionCount];
+    FBR_VK_CHECK(vkEnumerateDeviceExtensionProperties(pVulkan->physicalDevice, NULL, &availableExtensionCount, availableExtensions));
+    for (int i = 0; i < availableExtensionCount; ++i) {
+        if (strcmp(availableExtensions[i].extensionName, pExtensionName) == 0)
+            return true;
+    }
+    return false;
 }
 
 VkResult createLogicalDevice(FbrVulkan *pVulkan)
@@ -309,7 +362,7 @@ VkResult createLogicalDevice(FbrVulkan *pVulkan)
             .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_GLOBAL_PRIORITY_CREATE_INFO_EXT,
             .globalPriority = pVulkan->isChild ? VK_QUEUE_GLOBAL_PRIORITY_LOW_EXT : VK_QUEUE_GLOBAL_PRIORITY_MEDIUM_EXT
     };
-    const VkDeviceQueueCreateInfo pQueueCreateInfos[2] = {
+    const VkDeviceQueueCreateInfo pQueueCreateInfos[3] = {
             {
                     .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
                     .pNext = &queueGlobalPriorityCreateInfo,
@@ -323,12 +376,28 @@ VkResult createLogicalDevice(FbrVulkan *pVulkan)
                     .queueFamilyIndex = pVulkan->computeQueueFamilyIndex,
                     .queueCount = 1,
                     .pQueuePriorities = &queuePriority
+            },
+            {
+                    // no global priority, uploads shouldn't compete with compositing
+                    .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                    .queueFamilyIndex = pVulkan->transferQueueFamilyIndex,
+                    .queueCount = 1,
+                    .pQueuePriorities = &queuePriority
             }
     };
+    const uint32_t queueCreateInfoCount = pVulkan->transferQueueFamilyIndex != pVulkan->graphicsQueueFamilyIndex ? 3 : 2;
 
     // TODO come up with something better for this
+    VkPhysicalDevicePresentWaitFeaturesKHR supportedPhysicalDevicePresentWaitFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+    };
+    VkPhysicalDevicePresentIdFeaturesKHR supportedPhysicalDevicePresentIdFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+            .pNext = &supportedPhysicalDevicePresentWaitFeatures,
+    };
     VkPhysicalDeviceMeshShaderFeaturesEXT supportedPhysicalDeviceMeshShaderFeatures = {
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+            .pNext = &supportedPhysicalDevicePresentIdFeatures,
     };
     VkPhysicalDeviceGlobalPriorityQueryFeaturesEXT supportedPhysicalDeviceGlobalPriorityQueryFeatures = {
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GLOBAL_PRIORITY_QUERY_FEATURES_EXT,
@@ -365,6 +434,14 @@ VkResult createLogicalDevice(FbrVulkan *pVulkan)
         FBR_LOG_ERROR("robustBufferAccess2 no support!");
     if (!supportedPhysicalDeviceRobustness2Features.nullDescriptor)
         FBR_LOG_ERROR("nullDescriptor no support!");
+    if (!supportedPhysicalDeviceVulkan12Features.runtimeDescriptorArray)
+        FBR_LOG_ERROR("runtimeDescriptorArray no support!");
+    if (!supportedPhysicalDeviceVulkan12Features.descriptorBindingPartiallyBound)
+        FBR_LOG_ERROR("descriptorBindingPartiallyBound no support!");
+    if (!supportedPhysicalDeviceVulkan12Features.descriptorBindingSampledImageUpdateAfterBind)
+        FBR_LOG_ERROR("descriptorBindingSampledImageUpdateAfterBind no support!");
+    if (!supportedPhysicalDeviceVulkan12Features.descriptorBindingUpdateUnusedWhilePending)
+        FBR_LOG_ERROR("descriptorBindingUpdateUnusedWhilePending no support!");
     if (!supportedPhysicalDeviceVulkan13Features.synchronization2)
         FBR_LOG_ERROR("synchronization2 no support!");
     if (!supportedPhysicalDeviceVulkan13Features.robustImageAccess)
@@ -380,8 +457,31 @@ VkResult createLogicalDevice(FbrVulkan *pVulkan)
     if (!supportedPhysicalDeviceMeshShaderFeatures.meshShader)
         FBR_LOG_ERROR("meshShader no support!");
 
+    // nodes never present, headless has nothing to present to
+    pVulkan->presentWaitSupported = !pVulkan->isChild &&
+                                    !pVulkan->headless &&
+                                    isDeviceExtensionSupported(pVulkan, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+                                    isDeviceExtensionSupported(pVulkan, VK_KHR_PRESENT_WAIT_EXTENSION_NAME) &&
+                                    supportedPhysicalDevicePresentIdFeatures.presentId &&
+                                    supportedPhysicalDevicePresentWaitFeatures.presentWait;
+    FBR_LOG_DEBUG(pVulkan->presentWaitSupported);
+
+    pVulkan->calibratedTimestampsSupported = isDeviceExtensionSupported(pVulkan, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+    FBR_LOG_DEBUG(pVulkan->calibratedTimestampsSupported);
+
+    VkPhysicalDevicePresentWaitFeaturesKHR physicalDevicePresentWaitFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+            .presentWait = true,
+    };
+    VkPhysicalDevicePresentIdFeaturesKHR physicalDevicePresentIdFeatures = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+            .pNext = &physicalDevicePresentWaitFeatures,
+            .presentId = true,
+    };
+
     VkPhysicalDeviceMeshShaderFeaturesEXT physicalDeviceMeshShaderFeatures = {
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+            .pNext = pVulkan->presentWaitSupported ? &physicalDevicePresentIdFeatures : NULL,
             .meshShader = true,
             .taskShader = true,
     };
@@ -412,6 +512,11 @@ VkResult createLogicalDevice(FbrVulkan *pVulkan)
             .timelineSemaphore = true,
             .imagelessFramebuffer = true,
             .hostQueryReset = true,
+            // bindless texture array
+            .runtimeDescriptorArray = true,
+            .descriptorBindingPartiallyBound = true,
+            .descriptorBindingSampledImageUpdateAfterBind = true,
+            .descriptorBindingUpdateUnusedWhilePending = true,
     };
     VkPhysicalDeviceVulkan11Features enabledFeatures11 = {
             .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
@@ -447,18 +552,41 @@ VkResult createLogicalDevice(FbrVulkan *pVulkan)
     }
 #endif
 
+    const char *pEnabledExtensions[COUNT(pRequiredDeviceExtensions) +
+                                   COUNT(pWindowDeviceExtensions) +
+                                   COUNT(pOptionalPresentWaitExtensions) +
+                                   COUNT(pOptionalCalibratedTimestampsExtensions)];
+    uint32_t enabledExtensionCount = 0;
     for (int i = 0; i < COUNT(pRequiredDeviceExtensions); ++i){
-        FBR_LOG_DEBUG(pRequiredDeviceExtensions[i]);
+        pEnabledExtensions[enabledExtensionCount++] = pRequiredDeviceExtensions[i];
+    }
+    if (!pVulkan->headless) {
+        for (int i = 0; i < COUNT(pWindowDeviceExtensions); ++i){
+            pEnabledExtensions[enabledExtensionCount++] = pWindowDeviceExtensions[i];
+        }
+    }
+    if (pVulkan->presentWaitSupported) {
+        for (int i = 0; i < COUNT(pOptionalPresentWaitExtensions); ++i){
+            pEnabledExtensions[enabledExtensionCount++] = pOptionalPresentWaitExtensions[i];
+        }
+    }
+    if (pVulkan->calibratedTimestampsSupported) {
+        for (int i = 0; i < COUNT(pOptionalCalibratedTimestampsExtensions); ++i){
+            pEnabledExtensions[enabledExtensionCount++] = pOptionalCalibratedTimestampsExtensions[i];
+        }
+    }
+    for (int i = 0; i < enabledExtensionCount; ++i){
+        FBR_LOG_DEBUG(pEnabledExtensions[i]);
     }
 
     const VkDeviceCreateInfo createInfo = {
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
             .pNext = &enabledFeatures,
-            .queueCreateInfoCount = 2,
+            .queueCreateInfoCount = queueCreateInfoCount,
             .pQueueCreateInfos = pQueueCreateInfos,
             .pEnabledFeatures = NULL,
-            .enabledExtensionCount = COUNT(pRequiredDeviceExtensions),
-            .ppEnabledExtensionNames = pRequiredDeviceExtensions,
+            .enabledExtensionCount = enabledExtensionCount,
+            .ppEnabledExtensionNames = pEnabledExtensions,
             .ppEnabledLayerNames = pVulkan->enableValidationLayers ? pRequiredInstanceLayers : NULL,
             .enabledLayerCount = pVulkan->enableValidationLayers ? COUNT(pRequiredInstanceLayers) : 0,
 
@@ -586,35 +714,6 @@ static void createRenderPass(FbrVulkan *pVulkan)
 //                                     &pVulkan->graphicsCommandPool));
 //}
 
-static FBR_RESULT createDescriptorPool(FbrVulkan *pVulkan) {
-    const VkDescriptorPoolSize poolSizes[] = {
-            {
-                    .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                    .descriptorCount = 4,
-            },
-            {
-                    .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
-                    .descriptorCount = 4,
-            },
-            {
-                    .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                    .descriptorCount = 4,
-            }
-    };
-    const VkDescriptorPoolCreateInfo poolInfo = {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-            .pNext = NULL,
-            .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-            .poolSizeCount = 3,
-            .pPoolSizes = poolSizes,
-            .maxSets = 12,
-    };
-    FBR_ACK(vkCreateDescriptorPool(pVulkan->device,
-                                   &poolInfo,
-                                   NULL,
-                                   &pVulkan->descriptorPool));
-}
-
 static FBR_RESULT createCommandBuffers(FbrVulkan *pVulkan) {
     // Graphics + Compute
     const VkCommandPoolCreateInfo graphicsPoolInfo = {
@@ -658,6 +757,11 @@ static FBR_RESULT createCommandBuffers(FbrVulkan *pVulkan) {
 }
 
 static void createSurface(const FbrApp *pApp, FbrVulkan *pVulkan) {
+    if (pVulkan->headless) {
+        FBR_LOG_MESSAGE("headless, no surface!");
+        return;
+    }
+
     if (glfwCreateWindowSurface(pVulkan->instance, pApp->pWindow, NULL, &pVulkan->surface) != VK_SUCCESS) {
         FBR_LOG_MESSAGE("failed to create window surface!");
     }
@@ -717,6 +821,24 @@ static void loadFunctionPointers(FbrVulkan *pVulkan)
     if (pVulkan->functions.cmdDrawMeshTasks == NULL) {
         FBR_LOG_ERROR("Failed to get PFN_vkCmdDrawMeshTasksEXT!");
     }
+    pVulkan->functions.cmdPushDescriptorSet = (PFN_vkCmdPushDescriptorSetKHR) vkGetInstanceProcAddr(pVulkan->instance, "vkCmdPushDescriptorSetKHR");
+    if (pVulkan->functions.cmdPushDescriptorSet == NULL) {
+        FBR_LOG_ERROR("Failed to get PFN_vkCmdPushDescriptorSetKHR!");
+    }
+    if (pVulkan->calibratedTimestampsSupported) {
+        pVulkan->functions.getCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT) vkGetInstanceProcAddr(pVulkan->instance, "vkGetCalibratedTimestampsEXT");
+        if (pVulkan->functions.getCalibratedTimestamps == NULL) {
+            FBR_LOG_MESSAGE("Failed to get PFN_vkGetCalibratedTimestampsEXT, GPU zones won't be traced!");
+            pVulkan->calibratedTimestampsSupported = false;
+        }
+    }
+    if (pVulkan->presentWaitSupported) {
+        pVulkan->functions.waitForPresent = (PFN_vkWaitForPresentKHR) vkGetInstanceProcAddr(pVulkan->instance, "vkWaitForPresentKHR");
+        if (pVulkan->functions.waitForPresent == NULL) {
+            FBR_LOG_MESSAGE("Failed to get PFN_vkWaitForPresentKHR, presents won't be paced!");
+            pVulkan->presentWaitSupported = false;
+        }
+    }
 }
 
 static void initVulkan(const FbrApp *pApp, FbrVulkan *pVulkan)
@@ -734,6 +856,7 @@ static void initVulkan(const FbrApp *pApp, FbrVulkan *pVulkan)
 
     vkGetDeviceQueue(pVulkan->device, pVulkan->graphicsQueueFamilyIndex, 0, &pVulkan->graphicsQueue);
     vkGetDeviceQueue(pVulkan->device, pVulkan->computeQueueFamilyIndex, 0, &pVulkan->computeQueue);
+    vkGetDeviceQueue(pVulkan->device, pVulkan->transferQueueFamilyIndex, 0, &pVulkan->transferQueue);
 
 
     pVulkan->physicalDeviceMeshShaderProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT;
@@ -764,23 +887,21 @@ static void initVulkan(const FbrApp *pApp, FbrVulkan *pVulkan)
     FBR_LOG_DEBUG(pVulkan->physicalDeviceMeshShaderProperties.prefersCompactPrimitiveOutput);
     FBR_LOG_DEBUG(pVulkan->physicalDeviceMeshShaderProperties.prefersCompactVertexOutput);
 
-    const VkQueryPoolCreateInfo queryPoolCreateInfo =  {
-        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
-        .pNext = NULL,
-//        .flags = ,
-        .queryType = VK_QUERY_TYPE_TIMESTAMP,
-        .queryCount = 2,
-//        .pipelineStatistics = ,
-    };
-    vkCreateQueryPool(pVulkan->device, &queryPoolCreateInfo, FBR_ALLOCATOR, &pVulkan->queryPool);
+    fbrCreateProfiler(pVulkan, &pVulkan->pProfiler);
 
     // render
     createRenderPass(pVulkan); // todo shouldn't be here?
     createCommandBuffers(pVulkan);
-    createDescriptorPool(pVulkan);
+    fbrCreateDescriptorAllocator(pVulkan, &pVulkan->pDescriptorAllocator);
+    fbrCreatePipelineCache(pVulkan, &pVulkan->pipelineCache);
 
     createTextureSampler(pVulkan);
 
+    fbrCreateMemoryAllocator(pVulkan, &pVulkan->pMemoryAllocator);
+    fbrCreateUploadQueue(pVulkan, &pVulkan->pUploadQueue);
+    fbrCreateAssetLoader(pVulkan, &pVulkan->pAssetLoader);
+    fbrCreateDynamicUBO(pVulkan, FBR_DYNAMIC_UBO_SLOT_SIZE, FBR_DYNAMIC_UBO_SLOT_COUNT, &pVulkan->pDynamicUBO);
+
     if (!pApp->isChild) {
         fbrCreateTimelineSemaphore(pVulkan, true, true, &pVulkan->pMainTimelineSemaphore);
     }
@@ -795,6 +916,7 @@ void fbrCreateVulkan(const FbrApp *pApp, FbrVulkan **ppAllocVulkan, int screenWi
     // tf need better place for child flag
     pVulkan->isChild = pApp->isChild;
     isChild = pApp->isChild;
+    pVulkan->headless = pApp->settings.headless;
 
     pVulkan->enableValidationLayers = enableValidationLayers;
     pVulkan->screenWidth = screenWidth;
@@ -813,12 +935,19 @@ static void destroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMesse
 }
 
 void fbrCleanupVulkan(FbrVulkan *pVulkan) {
+    fbrDestroyAssetLoader(pVulkan, pVulkan->pAssetLoader);
+    fbrDestroyUploadQueue(pVulkan, pVulkan->pUploadQueue);
+    fbrDestroyDynamicUBO(pVulkan, pVulkan->pDynamicUBO);
+
     if (pVulkan->pMainTimelineSemaphore != NULL)
         fbrDestroyTimelineSemaphore(pVulkan, pVulkan->pMainTimelineSemaphore);
 
-    vkDestroyDescriptorPool(pVulkan->device, pVulkan->descriptorPool, FBR_ALLOCATOR);
+    fbrDestroyDescriptorAllocator(pVulkan, pVulkan->pDescriptorAllocator);
 
-    vkDestroyQueryPool(pVulkan->device, pVulkan->queryPool, FBR_ALLOCATOR);
+    // saved last so it holds every pipeline this process built
+    fbrDestroyPipelineCache(pVulkan, pVulkan->pipelineCache);
+
+    fbrDestroyProfiler(pVulkan, pVulkan->pProfiler);
 
     vkDestroyRenderPass(pVulkan->device, pVulkan->renderPass, FBR_ALLOCATOR);
 
@@ -827,13 +956,17 @@ void fbrCleanupVulkan(FbrVulkan *pVulkan) {
 
     vkDestroySampler(pVulkan->device, pVulkan->linearSampler, FBR_ALLOCATOR);
 
+    fbrDestroyMemoryAllocator(pVulkan, pVulkan->pMemoryAllocator);
+
     vkDestroyDevice(pVulkan->device, FBR_ALLOCATOR);
 
     if (pVulkan->enableValidationLayers) {
         destroyDebugUtilsMessengerEXT(pVulkan->instance, pVulkan->debugMessenger, FBR_ALLOCATOR);
     }
 
-    vkDestroySurfaceKHR(pVulkan->instance, pVulkan->surface, FBR_ALLOCATOR);
+    if (!pVulkan->headless) {
+        vkDestroySurfaceKHR(pVulkan->instance, pVulkan->surface, FBR_ALLOCATOR);
+    }
     vkDestroyInstance(pVulkan->instance, FBR_ALLOCATOR);
 
     free(pVulkan);
@@ -59,6 +59,11 @@ typedef enum FbrResultFlags {
 typedef struct FbrVulkanFunctions {
     PFN_vkGetMemoryWin32HandleKHR getMemoryWin32Handle;
     PFN_vkCmdDrawMeshTasksEXT cmdDrawMeshTasks;
+    PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet;
+    // NULL unless calibratedTimestampsSupported
+    PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps;
+    // NULL unless presentWaitSupported
+    PFN_vkWaitForPresentKHR waitForPresent;
 } FbrVulkanFunctions;
 
 typedef struct FbrVulkan {
@@ -67,7 +72,12 @@ typedef struct FbrVulkan {
     int screenHeight;
     float screenFOV;
     bool isChild;
+    bool headless;
     bool enableValidationLayers;
+    // VK_KHR_present_id and VK_KHR_present_wait, optional, presents are paced from their real display time when enabled
+    bool presentWaitSupported;
+    // VK_EXT_calibrated_timestamps, optional, GPU zones are left out of the trace without it
+    bool calibratedTimestampsSupported;
 
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
@@ -82,9 +92,16 @@ typedef struct FbrVulkan {
     VkQueue computeQueue;
     uint32_t computeQueueFamilyIndex;
 
+    // same as graphics if there is no dedicated transfer family
+    VkQueue transferQueue;
+    uint32_t transferQueueFamilyIndex;
+
     VkRenderPass renderPass;
 
-    VkDescriptorPool descriptorPool;
+    FbrDescriptorAllocator *pDescriptorAllocator;
+
+    // persisted to disk and shared with node processes
+    VkPipelineCache pipelineCache;
 
     VkCommandPool graphicsCommandPool;
     VkCommandBuffer graphicsCommandBuffer;
@@ -98,13 +115,18 @@ typedef struct FbrVulkan {
     VkPhysicalDeviceMeshShaderPropertiesEXT  physicalDeviceMeshShaderProperties;
     VkPhysicalDeviceProperties2  physicalDeviceProperties;
     VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
-    VkQueryPool queryPool;
+    FbrProfiler *pProfiler;
 
     FbrVulkanFunctions functions;
 
     // todo should be here?
     FbrTimelineSemaphore *pMainTimelineSemaphore;
 
+    FbrMemoryAllocator *pMemoryAllocator;
+    FbrUploadQueue *pUploadQueue;
+    FbrAssetLoader *pAssetLoader;
+    FbrDynamicUniformBufferObject *pDynamicUBO;
+
 } FbrVulkan;
 
 void fbrCreateVulkan(const FbrApp *pApp,
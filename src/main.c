@@ -1,6 +1,7 @@
 #include "fbr_app.h"
 #include "fbr_core.h"
 #include "fbr_log.h"
+#include "fbr_benchmark.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -72,29 +73,102 @@ bool setupRTPrivileges(){
     return ret;
 }
 
+// -headless renders to offscreen images with no window so needs -frames, -frames N stops the parent after N frames
+// -benchmark path|orbit drives the camera from a path for -frames frames and writes a report
+// -predict extrapolates camera poses to display time, -predictionError path|orbit only measures that offline
+// -reprojection compute|mesh|tessellation|calibrate, none has no composite loop and is rejected
+// Returns false if the mode can't be run.
+static bool parseReprojection(const char *pArg, FbrSettings *pSettings) {
+    if (strcmp(pArg, "compute") == 0) {
+        pSettings->reprojectionGeometry = ComputeSSDM;
+    } else if (strcmp(pArg, "mesh") == 0) {
+        pSettings->reprojectionGeometry = MeshShader;
+    } else if (strcmp(pArg, "tessellation") == 0) {
+        pSettings->reprojectionGeometry = TessellationShader;
+    } else if (strcmp(pArg, "calibrate") == 0) {
+        pSettings->calibrateReprojection = true;
+    } else if (strcmp(pArg, "none") == 0) {
+        FBR_LOG_MESSAGE("Reprojection unsupported!", pArg);
+        return false;
+    } else {
+        FBR_LOG_MESSAGE("Unknown reprojection", pArg);
+        return false;
+    }
+    return true;
+}
+
+// 0 would mean running until the window closes, ask for that by leaving -frames out
+// Returns false if the count isn't a positive number.
+static bool parseFrameCount(const char *pArg, FbrSettings *pSettings) {
+    pSettings->frameCount = strtoul(pArg, NULL, 10);
+    if (pSettings->frameCount == 0) {
+        FBR_LOG_MESSAGE("Frame count must be positive", pArg);
+        return false;
+    }
+    return true;
+}
 
 int main(int argc, char *argv[])
 {
 //    setupRTPrivileges();
 
-    bool isChild = false;
+    FbrSettings settings = {
+            .isChild = false,
+            .reprojectionGeometry = MeshShader,
+            .calibrateReprojection = false,
+            .headless = false,
+            .frameCount = 0,
+            .pBenchmarkPath = NULL,
+            .predictPose = false,
+    };
+    const char *pPredictionErrorPath = NULL;
     long long externalTextureTest;
     for (int i = 0; i < argc; ++i) {
         if (strcmp(argv[i], "-child") == 0) {
-            isChild = true;
+            settings.isChild = true;
         } else if (strcmp(argv[i], "-pTestTexture") == 0) {
             i++;
             externalTextureTest = strtoll(argv[i], NULL, 10);
+        } else if (strcmp(argv[i], "-reprojection") == 0 && i + 1 < argc) {
+            i++;
+            if (!parseReprojection(argv[i], &settings))
+                return 1;
+        } else if (strcmp(argv[i], "-headless") == 0) {
+            settings.headless = true;
+        } else if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc) {
+            i++;
+            if (!parseFrameCount(argv[i], &settings))
+                return 1;
+        } else if (strcmp(argv[i], "-benchmark") == 0 && i + 1 < argc) {
+            i++;
+            settings.pBenchmarkPath = argv[i];
+        } else if (strcmp(argv[i], "-predict") == 0) {
+            settings.predictPose = true;
+        } else if (strcmp(argv[i], "-predictionError") == 0 && i + 1 < argc) {
+            i++;
+            pPredictionErrorPath = argv[i];
         }
     }
 
-    if (isChild) {
+    // headless has no window to close, the child is stopped by its parent and benchmarks have a default length
+    if (settings.headless && !settings.isChild && settings.frameCount == 0 && settings.pBenchmarkPath == NULL) {
+        FBR_LOG_ERROR("Headless needs -frames!");
+        return 1;
+    }
+
+    if (pPredictionErrorPath != NULL) {
+        return fbrMeasurePredictionError(pPredictionErrorPath,
+                                         settings.frameCount,
+                                         FBR_BENCHMARK_PREDICTION_REPORT_PATH) == VK_SUCCESS ? 0 : 1;
+    }
+
+    if (settings.isChild) {
         Sleep(1000);
-        FBR_LOG_MESSAGE("Is Child Process", isChild);
+        FBR_LOG_MESSAGE("Is Child Process", settings.isChild);
     }
 
     FbrApp *pApp;
-    fbrCreateApp(&pApp, isChild, externalTextureTest);
+    fbrCreateApp(&pApp, &settings, externalTextureTest);
 
     fbrMainLoop(pApp);
 
@@ -0,0 +1,110 @@
+// Packs compiled SPIR-V into the single bundle the runtime maps, see src/fbr_shader_bundle_format.h
+// Usage: fbr_pack_shaders <bundle> <shader.spv>...
+
+#include "../src/fbr_shader_bundle_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *getFileName(const char *pPath) {
+    const char *pName = pPath;
+    for (const char *p = pPath; *p != '\0'; ++p) {
+        if (*p == '/' || *p == '\\')
+            pName = p + 1;
+    }
+    return pName;
+}
+
+static uint32_t alignOffset(uint32_t offset) {
+    return (offset + FBR_SHADER_BUNDLE_ALIGNMENT - 1) & ~(FBR_SHADER_BUNDLE_ALIGNMENT - 1);
+}
+
+static char *allocReadFile(const char *pPath, uint32_t *pSize) {
+    FILE *file = fopen(pPath, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Can't open %s\n", pPath);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *pSize = ftell(file);
+    rewind(file);
+    char *pContents = malloc(*pSize);
+    if (*pSize == 0 || fread(pContents, *pSize, 1, file) != 1) {
+        fprintf(stderr, "Can't read %s\n", pPath);
+        free(pContents);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    return pContents;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <bundle> <shader.spv>...\n", argv[0]);
+        return 1;
+    }
+
+    const uint32_t entryCount = argc - 2;
+    FbrShaderBundleEntry *pEntries = calloc(entryCount, sizeof(FbrShaderBundleEntry));
+    char **ppContents = calloc(entryCount, sizeof(char *));
+
+    uint32_t offset = alignOffset(sizeof(FbrShaderBundleHeader) + entryCount * sizeof(FbrShaderBundleEntry));
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        const char *pPath = argv[i + 2];
+        const char *pName = getFileName(pPath);
+        if (strlen(pName) >= FBR_SHADER_BUNDLE_NAME_SIZE) {
+            fprintf(stderr, "Shader name too long %s\n", pName);
+            return 1;
+        }
+
+        uint32_t size;
+        ppContents[i] = allocReadFile(pPath, &size);
+        if (ppContents[i] == NULL)
+            return 1;
+        if (size % sizeof(uint32_t) != 0) {
+            fprintf(stderr, "Not SPIR-V %s\n", pPath);
+            return 1;
+        }
+
+        strncpy(pEntries[i].pName, pName, FBR_SHADER_BUNDLE_NAME_SIZE - 1);
+        pEntries[i].offset = offset;
+        pEntries[i].size = size;
+        offset = alignOffset(offset + size);
+    }
+
+    FILE *file = fopen(argv[1], "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Can't open %s for writing\n", argv[1]);
+        return 1;
+    }
+
+    const FbrShaderBundleHeader header = {
+            .magic = FBR_SHADER_BUNDLE_MAGIC,
+            .version = FBR_SHADER_BUNDLE_VERSION,
+            .entryCount = entryCount,
+    };
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(pEntries, sizeof(FbrShaderBundleEntry), entryCount, file);
+
+    static const char pPadding[FBR_SHADER_BUNDLE_ALIGNMENT] = {0};
+    for (uint32_t i = 0; i < entryCount; ++i) {
+        const long position = ftell(file);
+        fwrite(pPadding, 1, pEntries[i].offset - position, file);
+        fwrite(ppContents[i], 1, pEntries[i].size, file);
+        free(ppContents[i]);
+    }
+
+    const int failed = ferror(file) | fclose(file);
+    if (failed) {
+        fprintf(stderr, "Failed writing %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("Packed %u shaders into %s\n", entryCount, argv[1]);
+
+    free(ppContents);
+    free(pEntries);
+    return 0;
+}